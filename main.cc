@@ -9,6 +9,17 @@
 #include <cstring>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
 
 // --------------------------------------------------------------------
 // --------------------------------------------------------------------
@@ -33,18 +44,47 @@ enum OperandKind {
     MEM_OP_IMM_OFFSET,
     MEM_OP_REGI_OFFSET,
     MEM_OP_IMM_OFFSET_PRE,
+    LITERAL,
+    VREG,       // v0.4s
+    VREG_ELEM,  // v0.s[1]
+    VREG_LIST,  // { v0.4s, v1.4s }
+    BR,         // 8bit scalar SIMD&FP register
+    HR,         // 16bit
+    SR,         // 32bit
+    DR,         // 64bit
+    QR,         // 128bit
+    FP_IMM,     // #1.5
+    ZREG,       // z0.s
+    ZREG_LIST,  // { z0.s }
+    PREG,       // p0, p0.s
+    PREG_ZERO,  // p0/z
+    PREG_MERGE, // p0/m
+    SVE_PATTERN,      // vl4, all
+    SVE_MUL,          // mul #4
+    MEM_OP_VL_OFFSET, // [ register, immediate, mul vl ]
+    LABEL,
+    BARRIER_OPT, // ish
+    PRFOP,       // pldl1keep
+    DC_OP,       // civac
+    IC_OP,       // ivau
+    SYSREG,      // cntvct_el0, s3_3_c14_c0_2, daifset
 };
 
+struct Expr;
+
+// Fields a kind does not use are zero, which keeps --emit-ir output deterministic.
 struct Operand {
-    OperandKind kind;
-    int regi_bits;
-    int imm;
-    int val; // shift|extend|cond val
-    int amount; // shift|extend amount
+    OperandKind kind = XR;
+    int regi_bits = 0;
+    int64_t imm = 0; // immediate|vector element index|label id
+    double fp_imm = 0; // floating-point immediate
+    int val = 0; // shift|extend|cond val, vector arrangement|element size
+    int amount = 0; // shift|extend amount, number of registers in a vector list, sve multiplier, pstate field
     // ref
-    Operand* base_register;
-    Operand* offset; // offset takes one of three formats { Immediate | Register }
-    Operand* extend_offset;
+    Operand* base_register = nullptr;
+    Operand* offset = nullptr; // offset takes one of three formats { Immediate | Register }
+    Operand* extend_offset = nullptr;
+    Expr* expr = nullptr; // immediate that depends on labels, see resolve_exprs
 };
 
 enum ShiftType {
@@ -66,6 +106,25 @@ enum ExtendType {
     SXTX = 0b111,
 };
 
+// (size << 1) | Q, as encoded by AdvSIMD instructions
+enum Arrangement {
+    ARR_8B  = 0b000,
+    ARR_16B = 0b001,
+    ARR_4H  = 0b010,
+    ARR_8H  = 0b011,
+    ARR_2S  = 0b100,
+    ARR_4S  = 0b101,
+    ARR_1D  = 0b110,
+    ARR_2D  = 0b111,
+};
+
+enum ElementSize {
+    ELEM_B = 0b00,
+    ELEM_H = 0b01,
+    ELEM_S = 0b10,
+    ELEM_D = 0b11,
+};
+
 enum CondType {
     EQ = 0b0000,
     NE = 0b0001,
@@ -102,6 +161,7 @@ std::unordered_map<std::string, Operand*> registers = {
     {"x20", new_regi(XR, 20)}, {"x21", new_regi(XR, 21)}, {"x22", new_regi(XR, 22)}, {"x23", new_regi(XR, 23)},
     {"x24", new_regi(XR, 24)}, {"x25", new_regi(XR, 25)}, {"x26", new_regi(XR, 26)}, {"x27", new_regi(XR, 27)},
     {"x28", new_regi(XR, 28)}, {"x29", new_regi(XR, 29)}, {"x30", new_regi(XR, 30)}, {"sp",  new_regi(XSP, 31)},
+    {"xzr", new_regi(XR, 31)},
 
     // 32bit registers
     {"w0",  new_regi(WR, 0)},  {"w1",  new_regi(WR, 1)},  {"w2",  new_regi(WR, 2)},  {"w3",  new_regi(WR, 3)},
@@ -111,15 +171,234 @@ std::unordered_map<std::string, Operand*> registers = {
     {"w16", new_regi(WR, 16)}, {"w17", new_regi(WR, 17)}, {"w18", new_regi(WR, 18)}, {"w19", new_regi(WR, 19)},
     {"w20", new_regi(WR, 20)}, {"w21", new_regi(WR, 21)}, {"w22", new_regi(WR, 22)}, {"w23", new_regi(WR, 23)},
     {"w24", new_regi(WR, 24)}, {"w25", new_regi(WR, 25)}, {"w26", new_regi(WR, 26)}, {"w27", new_regi(WR, 27)},
-    {"w28", new_regi(WR, 28)}, {"w29", new_regi(WR, 29)}, {"w30", new_regi(WR, 30)}, {"wsp", new_regi(WSP, 31) }
+    {"w28", new_regi(WR, 28)}, {"w29", new_regi(WR, 29)}, {"w30", new_regi(WR, 30)}, {"wsp", new_regi(WSP, 31) },
+    {"wzr", new_regi(WR, 31)},
+
+    // 128bit vector registers
+    {"v0",  new_regi(VREG, 0)}, {"v1",  new_regi(VREG, 1)}, {"v2",  new_regi(VREG, 2)}, {"v3",  new_regi(VREG, 3)},
+    {"v4",  new_regi(VREG, 4)}, {"v5",  new_regi(VREG, 5)}, {"v6",  new_regi(VREG, 6)}, {"v7",  new_regi(VREG, 7)},
+    {"v8",  new_regi(VREG, 8)}, {"v9",  new_regi(VREG, 9)}, {"v10", new_regi(VREG, 10)}, {"v11", new_regi(VREG, 11)},
+    {"v12", new_regi(VREG, 12)}, {"v13", new_regi(VREG, 13)}, {"v14", new_regi(VREG, 14)}, {"v15", new_regi(VREG, 15)},
+    {"v16", new_regi(VREG, 16)}, {"v17", new_regi(VREG, 17)}, {"v18", new_regi(VREG, 18)}, {"v19", new_regi(VREG, 19)},
+    {"v20", new_regi(VREG, 20)}, {"v21", new_regi(VREG, 21)}, {"v22", new_regi(VREG, 22)}, {"v23", new_regi(VREG, 23)},
+    {"v24", new_regi(VREG, 24)}, {"v25", new_regi(VREG, 25)}, {"v26", new_regi(VREG, 26)}, {"v27", new_regi(VREG, 27)},
+    {"v28", new_regi(VREG, 28)}, {"v29", new_regi(VREG, 29)}, {"v30", new_regi(VREG, 30)}, {"v31", new_regi(VREG, 31)},
+
+    // 8bit scalar SIMD&FP registers
+    {"b0",  new_regi(BR, 0)}, {"b1",  new_regi(BR, 1)}, {"b2",  new_regi(BR, 2)}, {"b3",  new_regi(BR, 3)},
+    {"b4",  new_regi(BR, 4)}, {"b5",  new_regi(BR, 5)}, {"b6",  new_regi(BR, 6)}, {"b7",  new_regi(BR, 7)},
+    {"b8",  new_regi(BR, 8)}, {"b9",  new_regi(BR, 9)}, {"b10", new_regi(BR, 10)}, {"b11", new_regi(BR, 11)},
+    {"b12", new_regi(BR, 12)}, {"b13", new_regi(BR, 13)}, {"b14", new_regi(BR, 14)}, {"b15", new_regi(BR, 15)},
+    {"b16", new_regi(BR, 16)}, {"b17", new_regi(BR, 17)}, {"b18", new_regi(BR, 18)}, {"b19", new_regi(BR, 19)},
+    {"b20", new_regi(BR, 20)}, {"b21", new_regi(BR, 21)}, {"b22", new_regi(BR, 22)}, {"b23", new_regi(BR, 23)},
+    {"b24", new_regi(BR, 24)}, {"b25", new_regi(BR, 25)}, {"b26", new_regi(BR, 26)}, {"b27", new_regi(BR, 27)},
+    {"b28", new_regi(BR, 28)}, {"b29", new_regi(BR, 29)}, {"b30", new_regi(BR, 30)}, {"b31", new_regi(BR, 31)},
+
+    // 16bit scalar SIMD&FP registers
+    {"h0",  new_regi(HR, 0)}, {"h1",  new_regi(HR, 1)}, {"h2",  new_regi(HR, 2)}, {"h3",  new_regi(HR, 3)},
+    {"h4",  new_regi(HR, 4)}, {"h5",  new_regi(HR, 5)}, {"h6",  new_regi(HR, 6)}, {"h7",  new_regi(HR, 7)},
+    {"h8",  new_regi(HR, 8)}, {"h9",  new_regi(HR, 9)}, {"h10", new_regi(HR, 10)}, {"h11", new_regi(HR, 11)},
+    {"h12", new_regi(HR, 12)}, {"h13", new_regi(HR, 13)}, {"h14", new_regi(HR, 14)}, {"h15", new_regi(HR, 15)},
+    {"h16", new_regi(HR, 16)}, {"h17", new_regi(HR, 17)}, {"h18", new_regi(HR, 18)}, {"h19", new_regi(HR, 19)},
+    {"h20", new_regi(HR, 20)}, {"h21", new_regi(HR, 21)}, {"h22", new_regi(HR, 22)}, {"h23", new_regi(HR, 23)},
+    {"h24", new_regi(HR, 24)}, {"h25", new_regi(HR, 25)}, {"h26", new_regi(HR, 26)}, {"h27", new_regi(HR, 27)},
+    {"h28", new_regi(HR, 28)}, {"h29", new_regi(HR, 29)}, {"h30", new_regi(HR, 30)}, {"h31", new_regi(HR, 31)},
+
+    // 32bit scalar SIMD&FP registers
+    {"s0",  new_regi(SR, 0)}, {"s1",  new_regi(SR, 1)}, {"s2",  new_regi(SR, 2)}, {"s3",  new_regi(SR, 3)},
+    {"s4",  new_regi(SR, 4)}, {"s5",  new_regi(SR, 5)}, {"s6",  new_regi(SR, 6)}, {"s7",  new_regi(SR, 7)},
+    {"s8",  new_regi(SR, 8)}, {"s9",  new_regi(SR, 9)}, {"s10", new_regi(SR, 10)}, {"s11", new_regi(SR, 11)},
+    {"s12", new_regi(SR, 12)}, {"s13", new_regi(SR, 13)}, {"s14", new_regi(SR, 14)}, {"s15", new_regi(SR, 15)},
+    {"s16", new_regi(SR, 16)}, {"s17", new_regi(SR, 17)}, {"s18", new_regi(SR, 18)}, {"s19", new_regi(SR, 19)},
+    {"s20", new_regi(SR, 20)}, {"s21", new_regi(SR, 21)}, {"s22", new_regi(SR, 22)}, {"s23", new_regi(SR, 23)},
+    {"s24", new_regi(SR, 24)}, {"s25", new_regi(SR, 25)}, {"s26", new_regi(SR, 26)}, {"s27", new_regi(SR, 27)},
+    {"s28", new_regi(SR, 28)}, {"s29", new_regi(SR, 29)}, {"s30", new_regi(SR, 30)}, {"s31", new_regi(SR, 31)},
+
+    // 64bit scalar SIMD&FP registers
+    {"d0",  new_regi(DR, 0)}, {"d1",  new_regi(DR, 1)}, {"d2",  new_regi(DR, 2)}, {"d3",  new_regi(DR, 3)},
+    {"d4",  new_regi(DR, 4)}, {"d5",  new_regi(DR, 5)}, {"d6",  new_regi(DR, 6)}, {"d7",  new_regi(DR, 7)},
+    {"d8",  new_regi(DR, 8)}, {"d9",  new_regi(DR, 9)}, {"d10", new_regi(DR, 10)}, {"d11", new_regi(DR, 11)},
+    {"d12", new_regi(DR, 12)}, {"d13", new_regi(DR, 13)}, {"d14", new_regi(DR, 14)}, {"d15", new_regi(DR, 15)},
+    {"d16", new_regi(DR, 16)}, {"d17", new_regi(DR, 17)}, {"d18", new_regi(DR, 18)}, {"d19", new_regi(DR, 19)},
+    {"d20", new_regi(DR, 20)}, {"d21", new_regi(DR, 21)}, {"d22", new_regi(DR, 22)}, {"d23", new_regi(DR, 23)},
+    {"d24", new_regi(DR, 24)}, {"d25", new_regi(DR, 25)}, {"d26", new_regi(DR, 26)}, {"d27", new_regi(DR, 27)},
+    {"d28", new_regi(DR, 28)}, {"d29", new_regi(DR, 29)}, {"d30", new_regi(DR, 30)}, {"d31", new_regi(DR, 31)},
+
+    // 128bit scalar SIMD&FP registers
+    {"q0",  new_regi(QR, 0)}, {"q1",  new_regi(QR, 1)}, {"q2",  new_regi(QR, 2)}, {"q3",  new_regi(QR, 3)},
+    {"q4",  new_regi(QR, 4)}, {"q5",  new_regi(QR, 5)}, {"q6",  new_regi(QR, 6)}, {"q7",  new_regi(QR, 7)},
+    {"q8",  new_regi(QR, 8)}, {"q9",  new_regi(QR, 9)}, {"q10", new_regi(QR, 10)}, {"q11", new_regi(QR, 11)},
+    {"q12", new_regi(QR, 12)}, {"q13", new_regi(QR, 13)}, {"q14", new_regi(QR, 14)}, {"q15", new_regi(QR, 15)},
+    {"q16", new_regi(QR, 16)}, {"q17", new_regi(QR, 17)}, {"q18", new_regi(QR, 18)}, {"q19", new_regi(QR, 19)},
+    {"q20", new_regi(QR, 20)}, {"q21", new_regi(QR, 21)}, {"q22", new_regi(QR, 22)}, {"q23", new_regi(QR, 23)},
+    {"q24", new_regi(QR, 24)}, {"q25", new_regi(QR, 25)}, {"q26", new_regi(QR, 26)}, {"q27", new_regi(QR, 27)},
+    {"q28", new_regi(QR, 28)}, {"q29", new_regi(QR, 29)}, {"q30", new_regi(QR, 30)}, {"q31", new_regi(QR, 31)},
+
+    // scalable vector registers
+    {"z0",  new_regi(ZREG, 0)}, {"z1",  new_regi(ZREG, 1)}, {"z2",  new_regi(ZREG, 2)}, {"z3",  new_regi(ZREG, 3)},
+    {"z4",  new_regi(ZREG, 4)}, {"z5",  new_regi(ZREG, 5)}, {"z6",  new_regi(ZREG, 6)}, {"z7",  new_regi(ZREG, 7)},
+    {"z8",  new_regi(ZREG, 8)}, {"z9",  new_regi(ZREG, 9)}, {"z10", new_regi(ZREG, 10)}, {"z11", new_regi(ZREG, 11)},
+    {"z12", new_regi(ZREG, 12)}, {"z13", new_regi(ZREG, 13)}, {"z14", new_regi(ZREG, 14)}, {"z15", new_regi(ZREG, 15)},
+    {"z16", new_regi(ZREG, 16)}, {"z17", new_regi(ZREG, 17)}, {"z18", new_regi(ZREG, 18)}, {"z19", new_regi(ZREG, 19)},
+    {"z20", new_regi(ZREG, 20)}, {"z21", new_regi(ZREG, 21)}, {"z22", new_regi(ZREG, 22)}, {"z23", new_regi(ZREG, 23)},
+    {"z24", new_regi(ZREG, 24)}, {"z25", new_regi(ZREG, 25)}, {"z26", new_regi(ZREG, 26)}, {"z27", new_regi(ZREG, 27)},
+    {"z28", new_regi(ZREG, 28)}, {"z29", new_regi(ZREG, 29)}, {"z30", new_regi(ZREG, 30)}, {"z31", new_regi(ZREG, 31)},
+
+    // scalable predicate registers
+    {"p0",  new_regi(PREG, 0)}, {"p1",  new_regi(PREG, 1)}, {"p2",  new_regi(PREG, 2)}, {"p3",  new_regi(PREG, 3)},
+    {"p4",  new_regi(PREG, 4)}, {"p5",  new_regi(PREG, 5)}, {"p6",  new_regi(PREG, 6)}, {"p7",  new_regi(PREG, 7)},
+    {"p8",  new_regi(PREG, 8)}, {"p9",  new_regi(PREG, 9)}, {"p10", new_regi(PREG, 10)}, {"p11", new_regi(PREG, 11)},
+    {"p12", new_regi(PREG, 12)}, {"p13", new_regi(PREG, 13)}, {"p14", new_regi(PREG, 14)}, {"p15", new_regi(PREG, 15)}
+};
+
+std::unordered_map<std::string, Arrangement> arrangements = {
+    {"8b", ARR_8B}, {"16b", ARR_16B}, {"4h", ARR_4H}, {"8h", ARR_8H},
+    {"2s", ARR_2S}, {"4s",  ARR_4S},  {"1d", ARR_1D}, {"2d", ARR_2D},
+};
+
+std::unordered_map<std::string, ElementSize> element_sizes = {
+    {"b", ELEM_B}, {"h", ELEM_H}, {"s", ELEM_S}, {"d", ELEM_D},
+};
+
+// predicate constraint of ptrue/cnt*/inc*
+std::unordered_map<std::string, int> sve_patterns = {
+    {"pow2", 0b00000}, {"vl1",   0b00001}, {"vl2",   0b00010}, {"vl3",  0b00011},
+    {"vl4",  0b00100}, {"vl5",   0b00101}, {"vl6",   0b00110}, {"vl7",  0b00111},
+    {"vl8",  0b01000}, {"vl16",  0b01001}, {"vl32",  0b01010}, {"vl64", 0b01011},
+    {"vl128", 0b01100}, {"vl256", 0b01101}, {"mul4", 0b11101}, {"mul3", 0b11110},
+    {"all",  0b11111},
+};
+
+// CRm of dmb/dsb/isb
+std::unordered_map<std::string, int> barrier_options = {
+    {"oshld", 0b0001}, {"oshst", 0b0010}, {"osh", 0b0011},
+    {"nshld", 0b0101}, {"nshst", 0b0110}, {"nsh", 0b0111},
+    {"ishld", 0b1001}, {"ishst", 0b1010}, {"ish", 0b1011},
+    {"ld",    0b1101}, {"st",    0b1110}, {"sy",  0b1111},
+};
+
+// prfop of prfm/prfum: type (pld, pli, pst) : target (l1, l2, l3) : policy (keep, strm)
+std::unordered_map<std::string, int> prefetch_ops = {
+    {"pldl1keep", 0b00000}, {"pldl1strm", 0b00001}, {"pldl2keep", 0b00010}, {"pldl2strm", 0b00011}, {"pldl3keep", 0b00100}, {"pldl3strm", 0b00101},
+    {"plil1keep", 0b01000}, {"plil1strm", 0b01001}, {"plil2keep", 0b01010}, {"plil2strm", 0b01011}, {"plil3keep", 0b01100}, {"plil3strm", 0b01101},
+    {"pstl1keep", 0b10000}, {"pstl1strm", 0b10001}, {"pstl2keep", 0b10010}, {"pstl2strm", 0b10011}, {"pstl3keep", 0b10100}, {"pstl3strm", 0b10101},
+};
+
+// op1:CRn:CRm:op2 of the SYS instruction behind dc/ic, at bits 16, 12, 8, 5
+#define SYS_OP(op1, crn, crm, op2) ((op1) << 16 | (crn) << 12 | (crm) << 8 | (op2) << 5)
+
+std::unordered_map<std::string, int> dc_ops = {
+    {"ivac",  SYS_OP(0, 7, 6, 1)},  {"isw",   SYS_OP(0, 7, 6, 2)},  {"csw",   SYS_OP(0, 7, 10, 2)}, {"cisw",  SYS_OP(0, 7, 14, 2)},
+    {"zva",   SYS_OP(3, 7, 4, 1)},  {"cvac",  SYS_OP(3, 7, 10, 1)}, {"cvau",  SYS_OP(3, 7, 11, 1)}, {"cvap",  SYS_OP(3, 7, 12, 1)},
+    {"civac", SYS_OP(3, 7, 14, 1)},
+};
+
+std::unordered_map<std::string, int> ic_ops = {
+    {"ialluis", SYS_OP(0, 7, 1, 0)}, {"iallu", SYS_OP(0, 7, 5, 0)}, {"ivau", SYS_OP(3, 7, 5, 1)},
+};
+
+// op0:op1:CRn:CRm:op2 of mrs/msr at bits 19, 16, 12, 8, 5
+#define SYS_REG(op0, op1, crn, crm, op2) ((op0) << 19 | (op1) << 16 | (crn) << 12 | (crm) << 8 | (op2) << 5)
+
+enum SysRegAccess {
+    READ_WRITE,
+    READ_ONLY,  // mrs only
+    WRITE_ONLY, // msr only
+};
+
+struct SystemRegister {
+    int encoding;
+    SysRegAccess access = READ_WRITE;
+};
+
+std::unordered_map<std::string, SystemRegister> system_registers = {
+    // generic timer
+    {"cntfrq_el0", {SYS_REG(3, 3, 14, 0, 0)}}, {"cntpct_el0", {SYS_REG(3, 3, 14, 0, 1), READ_ONLY}},
+    {"cntvct_el0", {SYS_REG(3, 3, 14, 0, 2), READ_ONLY}}, {"cntpctss_el0", {SYS_REG(3, 3, 14, 0, 5), READ_ONLY}},
+    {"cntvctss_el0", {SYS_REG(3, 3, 14, 0, 6), READ_ONLY}}, {"cntp_tval_el0", {SYS_REG(3, 3, 14, 2, 0)}},
+    {"cntp_ctl_el0", {SYS_REG(3, 3, 14, 2, 1)}}, {"cntp_cval_el0", {SYS_REG(3, 3, 14, 2, 2)}},
+    {"cntv_tval_el0", {SYS_REG(3, 3, 14, 3, 0)}}, {"cntv_ctl_el0", {SYS_REG(3, 3, 14, 3, 1)}},
+    {"cntv_cval_el0", {SYS_REG(3, 3, 14, 3, 2)}}, {"cntkctl_el1", {SYS_REG(3, 0, 14, 1, 0)}},
+
+    // performance monitors
+    {"pmcr_el0", {SYS_REG(3, 3, 9, 12, 0)}}, {"pmcntenset_el0", {SYS_REG(3, 3, 9, 12, 1)}},
+    {"pmcntenclr_el0", {SYS_REG(3, 3, 9, 12, 2)}}, {"pmovsclr_el0", {SYS_REG(3, 3, 9, 12, 3)}},
+    {"pmswinc_el0", {SYS_REG(3, 3, 9, 12, 4), WRITE_ONLY}}, {"pmselr_el0", {SYS_REG(3, 3, 9, 12, 5)}},
+    {"pmceid0_el0", {SYS_REG(3, 3, 9, 12, 6), READ_ONLY}}, {"pmceid1_el0", {SYS_REG(3, 3, 9, 12, 7), READ_ONLY}},
+    {"pmccntr_el0", {SYS_REG(3, 3, 9, 13, 0)}}, {"pmxevtyper_el0", {SYS_REG(3, 3, 9, 13, 1)}},
+    {"pmxevcntr_el0", {SYS_REG(3, 3, 9, 13, 2)}}, {"pmuserenr_el0", {SYS_REG(3, 3, 9, 14, 0)}},
+    {"pmovsset_el0", {SYS_REG(3, 3, 9, 14, 3)}}, {"pmccfiltr_el0", {SYS_REG(3, 3, 14, 15, 7)}},
+
+    // floating-point, flags and pstate
+    {"fpcr", {SYS_REG(3, 3, 4, 4, 0)}}, {"fpsr", {SYS_REG(3, 3, 4, 4, 1)}}, {"nzcv", {SYS_REG(3, 3, 4, 2, 0)}},
+    {"daif", {SYS_REG(3, 3, 4, 2, 1)}}, {"currentel", {SYS_REG(3, 0, 4, 2, 2), READ_ONLY}}, {"spsel", {SYS_REG(3, 0, 4, 2, 0)}},
+    {"pan", {SYS_REG(3, 0, 4, 2, 3)}}, {"uao", {SYS_REG(3, 0, 4, 2, 4)}}, {"dit", {SYS_REG(3, 3, 4, 2, 5)}},
+    {"ssbs", {SYS_REG(3, 3, 4, 2, 6)}}, {"tco", {SYS_REG(3, 3, 4, 2, 7)}},
+
+    // thread pointers
+    {"tpidr_el0", {SYS_REG(3, 3, 13, 0, 2)}}, {"tpidrro_el0", {SYS_REG(3, 3, 13, 0, 3)}}, {"tpidr_el1", {SYS_REG(3, 0, 13, 0, 4)}},
+    {"contextidr_el1", {SYS_REG(3, 0, 13, 0, 1)}},
+
+    // identification
+    {"midr_el1", {SYS_REG(3, 0, 0, 0, 0), READ_ONLY}}, {"mpidr_el1", {SYS_REG(3, 0, 0, 0, 5), READ_ONLY}},
+    {"revidr_el1", {SYS_REG(3, 0, 0, 0, 6), READ_ONLY}}, {"ctr_el0", {SYS_REG(3, 3, 0, 0, 1), READ_ONLY}},
+    {"dczid_el0", {SYS_REG(3, 3, 0, 0, 7), READ_ONLY}}, {"id_aa64pfr0_el1", {SYS_REG(3, 0, 0, 4, 0), READ_ONLY}},
+    {"id_aa64pfr1_el1", {SYS_REG(3, 0, 0, 4, 1), READ_ONLY}}, {"id_aa64zfr0_el1", {SYS_REG(3, 0, 0, 4, 4), READ_ONLY}},
+    {"id_aa64dfr0_el1", {SYS_REG(3, 0, 0, 5, 0), READ_ONLY}}, {"id_aa64isar0_el1", {SYS_REG(3, 0, 0, 6, 0), READ_ONLY}},
+    {"id_aa64isar1_el1", {SYS_REG(3, 0, 0, 6, 1), READ_ONLY}}, {"id_aa64mmfr0_el1", {SYS_REG(3, 0, 0, 7, 0), READ_ONLY}},
+    {"id_aa64mmfr1_el1", {SYS_REG(3, 0, 0, 7, 1), READ_ONLY}},
+
+    // random numbers
+    {"rndr", {SYS_REG(3, 3, 2, 4, 0), READ_ONLY}}, {"rndrrs", {SYS_REG(3, 3, 2, 4, 1), READ_ONLY}},
+
+    // EL1 system control
+    {"sctlr_el1", {SYS_REG(3, 0, 1, 0, 0)}}, {"cpacr_el1", {SYS_REG(3, 0, 1, 0, 2)}}, {"zcr_el1", {SYS_REG(3, 0, 1, 2, 0)}},
+    {"ttbr0_el1", {SYS_REG(3, 0, 2, 0, 0)}}, {"ttbr1_el1", {SYS_REG(3, 0, 2, 0, 1)}}, {"tcr_el1", {SYS_REG(3, 0, 2, 0, 2)}},
+    {"spsr_el1", {SYS_REG(3, 0, 4, 0, 0)}}, {"elr_el1", {SYS_REG(3, 0, 4, 0, 1)}}, {"sp_el0", {SYS_REG(3, 0, 4, 1, 0)}},
+    {"esr_el1", {SYS_REG(3, 0, 5, 2, 0)}}, {"far_el1", {SYS_REG(3, 0, 6, 0, 0)}}, {"par_el1", {SYS_REG(3, 0, 7, 4, 0)}},
+    {"mair_el1", {SYS_REG(3, 0, 10, 2, 0)}}, {"vbar_el1", {SYS_REG(3, 0, 12, 0, 0)}},
+};
+
+// the access directions of a register encoding, registers that aren't named are read-write
+SysRegAccess system_register_access(int encoding) {
+    for (auto& [name, reg] : system_registers) {
+        if (reg.encoding == encoding) {
+            return reg.access;
+        }
+    }
+    return READ_WRITE;
+}
+
+struct PstateField {
+    int encoding; // op1:op2 of msr (immediate) at bits 16, 5
+    int max;      // of the immediate
+};
+
+std::unordered_map<std::string, PstateField> pstate_fields = {
+    {"spsel",   {0 << 16 | 5 << 5, 15}}, {"daifset", {3 << 16 | 6 << 5, 15}}, {"daifclr", {3 << 16 | 7 << 5, 15}},
+    {"uao",     {0 << 16 | 3 << 5, 1}},  {"pan",     {0 << 16 | 4 << 5, 1}},  {"dit",     {3 << 16 | 2 << 5, 1}},
+    {"ssbs",    {3 << 16 | 1 << 5, 1}},  {"tco",     {3 << 16 | 4 << 5, 1}},
 };
 
+int pstate_field_max(int encoding) {
+    for (auto& [name, field] : pstate_fields) {
+        if (field.encoding == encoding) {
+            return field.max;
+        }
+    }
+    return 15;
+}
+
 std::unordered_map<std::string, ShiftType> shift_types = {
     {"LSL", LSL},
     {"LSR", LSR},
     {"ASR", ASR},
     {"RESERVED", RESERVED},
     {"ROR", ROR},
+    {"lsl", LSL},
+    {"lsr", LSR},
+    {"asr", ASR},
+    {"ror", ROR},
 };
 
 std::unordered_map<std::string, ExtendType> extend_types = {
@@ -131,6 +410,28 @@ std::unordered_map<std::string, ExtendType> extend_types = {
     {"SXTH", SXTH},
     {"SXTW", SXTW},
     {"SXTX", SXTX},
+    {"uxtb", UXTB},
+    {"uxth", UXTH},
+    {"uxtw", UXTW},
+    {"uxtx", UXTX},
+    {"sxtb", SXTB},
+    {"sxth", SXTH},
+    {"sxtw", SXTW},
+    {"sxtx", SXTX},
+};
+
+std::unordered_map<std::string, CondType> cond_types = {
+    {"eq", EQ}, {"ne", NE}, {"hs", HS}, {"cs", HS}, {"lo", LO}, {"cc", LO}, {"mi", MI}, {"pl", PL},
+    {"vs", VS}, {"vc", VC}, {"hi", HI}, {"ls", LS}, {"ge", GE}, {"lt", LT}, {"gt", GT}, {"le", LE},
+    {"al", AL},
+};
+
+const char* cond_names[] = {"eq", "ne", "hs", "lo", "mi", "pl", "vs", "vc", "hi", "ls", "ge", "lt", "gt", "le", "al", "nv"};
+
+// b.<cond> names for the flags set by SVE predicate-generating instructions
+std::unordered_map<std::string, CondType> sve_cond_aliases = {
+    {"none",  EQ}, {"any",   NE}, {"nlast", HS}, {"last",  LO}, {"first", MI},
+    {"nfrst", PL}, {"pmore", HI}, {"plast", LS}, {"tcont", GE}, {"tstop", LT},
 };
 
 Operand *new_shift(ShiftType shift_type, int amount) {
@@ -159,7 +460,16 @@ Operand *new_cond(CondType cond_type) {
     return op;
 }
 
-Operand *new_imm(int imm) {
+// barrier options, prefetch operations, dc/ic operations
+Operand *new_named_op(OperandKind kind, int val) {
+    Operand *op = new Operand;
+    op->kind = kind;
+    op->val = val;
+
+    return op;
+}
+
+Operand *new_imm(int64_t imm) {
     Operand *op = new Operand;
     op->kind = IMM;
     op->imm = imm;
@@ -167,23 +477,98 @@ Operand *new_imm(int imm) {
     return op;
 }
 
+[[noreturn]] void operand_error(std::string msg);
+
+// also the end of every instr_table entry, where no form matched the operands
 [[noreturn]] void unreachable() {
-    std::cerr << "unreachable" << std::endl;
-    exit(1);
+    operand_error("invalid operands");
 }
 
 #define is_xr(operands, i)                   (operands[i]->kind == XR)
 #define is_wr(operands, i)                   (operands[i]->kind == WR)
-#define is_xr_or_xsp(operands, i)            (operands[i]->kind == XR || operands[i]->kind == XSP)
-#define is_wr_or_wsp(operands, i)            (operands[i]->kind == WR || operands[i]->kind == WSP)
+// register 31 is sp in these fields, so xzr/wzr are not taken
+#define is_xr_or_xsp(operands, i)            ((operands[i]->kind == XR && operands[i]->regi_bits != 31) || operands[i]->kind == XSP)
+#define is_wr_or_wsp(operands, i)            ((operands[i]->kind == WR && operands[i]->regi_bits != 31) || operands[i]->kind == WSP)
 #define is_shift(operands, i)                (operands[i]->kind == SHIFT)
 #define is_extend(operands, i)               (operands[i]->kind == EXTEND)
 #define is_imm(operands, i)                  (operands[i]->kind == IMM)
 #define is_cond(operands, i)                 (operands[i]->kind == COND)
 #define is_mem_op_base(operands, i)             (operands[i]->kind == MEM_OP_BASE || (operands[i]->kind == MEM_OP_IMM_OFFSET && operands[i]->offset->imm == 0))
-#define is_mem_op_imm_offset(operands, i)       (operands[i]->kind == MEM_OP_IMM_OFFSET)
+#define is_mem_op_imm_offset(operands, i)       (operands[i]->kind == MEM_OP_IMM_OFFSET || operands[i]->kind == MEM_OP_BASE)
 #define is_mem_op_imm_offset_pre(operands, i)   (operands[i]->kind == MEM_OP_IMM_OFFSET_PRE)
 #define is_mem_op_regi_offset(operands, i)      (operands[i]->kind == MEM_OP_REGI_OFFSET)
+#define is_literal(operands, i)                 (operands[i]->kind == LITERAL)
+
+// AdvSIMD
+#define is_vreg(operands, i)                 (operands[i]->kind == VREG)
+#define is_vreg_b(operands, i)               (is_vreg(operands, i) && operands[i]->val <= ARR_16B)
+#define is_vreg_h(operands, i)               (is_vreg(operands, i) && (operands[i]->val == ARR_4H || operands[i]->val == ARR_8H))
+#define is_vreg_bhs(operands, i)             (is_vreg(operands, i) && operands[i]->val <= ARR_4S)
+#define is_vreg_bhsd(operands, i)            (is_vreg(operands, i) && operands[i]->val != ARR_1D)
+#define is_vreg_sd(operands, i)              (is_vreg(operands, i) && (operands[i]->val == ARR_2S || operands[i]->val == ARR_4S || operands[i]->val == ARR_2D))
+#define is_vsame(operands, i)                (is_vreg(operands, i) && operands[i]->val == operands[0]->val)
+#define is_velem(operands, i)                (operands[i]->kind == VREG_ELEM)
+#define is_velem_hs(operands, i)             (is_velem(operands, i) && (operands[i]->val == ELEM_H || operands[i]->val == ELEM_S))
+#define is_velem_sd(operands, i)             (is_velem(operands, i) && (operands[i]->val == ELEM_S || operands[i]->val == ELEM_D))
+#define is_velem_bhs(operands, i)            (is_velem(operands, i) && operands[i]->val <= ELEM_S)
+#define is_velem_s(operands, i)              (is_velem(operands, i) && operands[i]->val == ELEM_S)
+#define is_velem_d(operands, i)              (is_velem(operands, i) && operands[i]->val == ELEM_D)
+#define is_vlist(operands, i)                (operands[i]->kind == VREG_LIST)
+#define is_vlist1(operands, i)               (is_vlist(operands, i) && operands[i]->amount == 1)
+#define is_vlist2(operands, i)               (is_vlist(operands, i) && operands[i]->amount == 2)
+#define is_vlist3(operands, i)               (is_vlist(operands, i) && operands[i]->amount == 3)
+#define is_vlist4(operands, i)               (is_vlist(operands, i) && operands[i]->amount == 4)
+
+// scalar SIMD&FP
+#define is_br(operands, i)                   (operands[i]->kind == BR)
+#define is_hr(operands, i)                   (operands[i]->kind == HR)
+#define is_sr(operands, i)                   (operands[i]->kind == SR)
+#define is_dr(operands, i)                   (operands[i]->kind == DR)
+#define is_qr(operands, i)                   (operands[i]->kind == QR)
+#define is_fp_imm(operands, i)               (operands[i]->kind == FP_IMM)
+#define is_fp_zero(operands, i)              ((is_fp_imm(operands, i) && operands[i]->fp_imm == 0.0) || (is_imm(operands, i) && operands[i]->imm == 0))
+
+// SVE
+#define is_zreg(operands, i)                 (operands[i]->kind == ZREG)
+#define is_zreg_b(operands, i)               (is_zreg(operands, i) && operands[i]->val == ELEM_B)
+#define is_zreg_h(operands, i)               (is_zreg(operands, i) && operands[i]->val == ELEM_H)
+#define is_zreg_s(operands, i)               (is_zreg(operands, i) && operands[i]->val == ELEM_S)
+#define is_zreg_d(operands, i)               (is_zreg(operands, i) && operands[i]->val == ELEM_D)
+#define is_zreg_hsd(operands, i)             (is_zreg(operands, i) && operands[i]->val != ELEM_B)
+#define is_zsame(operands, i)                (is_zreg(operands, i) && operands[i]->val == operands[0]->val)
+#define is_zlist_b(operands, i)              (operands[i]->kind == ZREG_LIST && operands[i]->amount == 1 && operands[i]->val == ELEM_B)
+#define is_zlist_h(operands, i)              (operands[i]->kind == ZREG_LIST && operands[i]->amount == 1 && operands[i]->val == ELEM_H)
+#define is_zlist_s(operands, i)              (operands[i]->kind == ZREG_LIST && operands[i]->amount == 1 && operands[i]->val == ELEM_S)
+#define is_zlist_d(operands, i)              (operands[i]->kind == ZREG_LIST && operands[i]->amount == 1 && operands[i]->val == ELEM_D)
+#define is_preg_sized(operands, i)           (operands[i]->kind == PREG && operands[i]->val >= 0)
+// governing predicates only have 3 bits
+#define is_pg(operands, i)                   (operands[i]->kind == PREG && operands[i]->val < 0 && operands[i]->regi_bits < 8)
+#define is_pg_z(operands, i)                 (operands[i]->kind == PREG_ZERO && operands[i]->regi_bits < 8)
+#define is_pg_m(operands, i)                 (operands[i]->kind == PREG_MERGE && operands[i]->regi_bits < 8)
+#define is_sve_pattern(operands, i)          (operands[i]->kind == SVE_PATTERN)
+#define is_sve_mul(operands, i)              (operands[i]->kind == SVE_MUL)
+#define is_mem_op_vl_offset(operands, i)     (operands[i]->kind == MEM_OP_VL_OFFSET && operands[i]->offset->imm >= -8 && operands[i]->offset->imm <= 7)
+#define is_mem_op_regi_lsl0(operands, i)     (is_mem_op_regi_offset(operands, i) && operands[i]->extend_offset->val == UXTX && operands[i]->extend_offset->amount == 0)
+#define is_mem_op_regi_lsl1(operands, i)     (is_mem_op_regi_offset(operands, i) && operands[i]->extend_offset->val == UXTX && operands[i]->extend_offset->amount == 1)
+#define is_mem_op_regi_lsl2(operands, i)     (is_mem_op_regi_offset(operands, i) && operands[i]->extend_offset->val == UXTX && operands[i]->extend_offset->amount == 2)
+#define is_mem_op_regi_lsl3(operands, i)     (is_mem_op_regi_offset(operands, i) && operands[i]->extend_offset->val == UXTX && operands[i]->extend_offset->amount == 3)
+// immediate offsets the scaled form can't encode but ldur/stur can, which ldr/str fall back to
+#define is_mem_op_unscaled(operands, i, size) (is_mem_op_imm_offset(operands, i) && operands[i]->offset->imm >= -256 && operands[i]->offset->imm <= 255 && (operands[i]->offset->imm < 0 || operands[i]->offset->imm % size != 0))
+#define is_mem_op_unscaled1(operands, i)     is_mem_op_unscaled(operands, i, 1)
+#define is_mem_op_unscaled2(operands, i)     is_mem_op_unscaled(operands, i, 2)
+#define is_mem_op_unscaled4(operands, i)     is_mem_op_unscaled(operands, i, 4)
+#define is_mem_op_unscaled8(operands, i)     is_mem_op_unscaled(operands, i, 8)
+#define is_mem_op_unscaled16(operands, i)    is_mem_op_unscaled(operands, i, 16)
+#define is_simm8(operands, i)                (is_imm(operands, i) && operands[i]->imm >= -128 && operands[i]->imm <= 127)
+
+#define is_label(operands, i)                (operands[i]->kind == LABEL)
+
+#define is_barrier_opt(operands, i)          (operands[i]->kind == BARRIER_OPT)
+#define is_prfop(operands, i)                (operands[i]->kind == PRFOP)
+#define is_dc_op(operands, i)                (operands[i]->kind == DC_OP)
+#define is_ic_op(operands, i)                (operands[i]->kind == IC_OP)
+#define is_sysreg(operands, i)               (operands[i]->kind == SYSREG && operands[i]->val >= 0)
+#define is_pstate_field(operands, i)         (operands[i]->kind == SYSREG && operands[i]->amount >= 0)
 
 #define next_op_shift(operands, i)           ((operand_length > i+1) ? is_shift(operands, i+1) : true)
 #define next_op_extend(operands, i)          ((operand_length > i+1) ? is_extend(operands, i+1) : true)
@@ -191,28 +576,44 @@ Operand *new_imm(int imm) {
 #define is_xr_shift(operands, i)             (is_xr(operands, i) && next_op_shift(operands, i))
 #define is_wr_shift(operands, i)             (is_wr(operands, i) && next_op_shift(operands, i))
 #define is_imm_shift(operands, i)            (is_imm(operands, i) && next_op_shift(operands, i))
+// add/sub/cmp/cmn of a negative immediate are encoded as the opposite instruction
+#define is_neg_imm_shift(operands, i)        (is_imm_shift(operands, i) && operands[i]->imm < 0)
 #define is_xr_extend(operands, i)            (is_xr(operands, i) && next_op_extend(operands, i))
 #define is_wr_extend(operands, i)            (is_wr(operands, i) && next_op_extend(operands, i))
 
-#define pattern1(A)             (operand_length >= 1) && \
+constexpr bool ends_with(const char* str, const char* suffix) {
+    size_t n = 0, m = 0;
+    while (str[n]) n++;
+    while (suffix[m]) m++;
+    for (size_t i = 0; i < m; i++) {
+        if (n < m || str[n - m + i] != suffix[i]) return false;
+    }
+    return n >= m;
+}
+
+// A pattern takes exactly its operands, only a `_shift`/`_extend` predicate also takes the
+// optional shift or extend after its operand
+#define pattern_length(N, LAST) (operand_length == N || (operand_length == N + 1 && (ends_with(#LAST, "_shift") || ends_with(#LAST, "_extend"))))
+
+#define pattern1(A)             pattern_length(1, A) && \
                                 is_##A(operands, 0)
 
-#define pattern2(A, B)          (operand_length >= 2) && \
+#define pattern2(A, B)          pattern_length(2, B) && \
                                 is_##A(operands, 0) && \
                                 is_##B(operands, 1)
 
-#define pattern3(A, B, C)       (operand_length >= 3) && \
+#define pattern3(A, B, C)       pattern_length(3, C) && \
                                 is_##A(operands, 0) && \
                                 is_##B(operands, 1) && \
                                 is_##C(operands, 2)
 
-#define pattern4(A, B, C, D)    (operand_length >= 4) && \
+#define pattern4(A, B, C, D)    pattern_length(4, D) && \
                                 is_##A(operands, 0) && \
                                 is_##B(operands, 1) && \
                                 is_##C(operands, 2) && \
                                 is_##D(operands, 3)
 
-#define pattern5(A, B, C, D, E) (operand_length >= 5) && \
+#define pattern5(A, B, C, D, E) pattern_length(5, E) && \
                                 is_##A(operands, 0) && \
                                 is_##B(operands, 1) && \
                                 is_##C(operands, 2) && \
@@ -226,36 +627,455 @@ CondType invert_cond(CondType cond) {
     return inverted_condtype[cond];
 }
 
+inline uint64_t reg_mask(int reg_size) {
+    return reg_size == 64 ? ~0ull : 0xffffffffull;
+}
+
+// Index of the only 16bit chunk of value that may be non-zero, or -1.
+int wide_imm_hw(uint64_t value, int reg_size) {
+    value &= reg_mask(reg_size);
+    for (int hw = 0; hw < reg_size / 16; hw++) {
+        if ((value & ~(0xffffull << (hw * 16))) == 0) {
+            return hw;
+        }
+    }
+    return -1;
+}
+
+uint32_t encode_wide_imm(uint64_t value, int reg_size) {
+    int hw = wide_imm_hw(value, reg_size);
+    return (hw << 21) | (((value >> (hw * 16)) & 0xffff) << 5);
+}
+
+// Logical (bitmask) immediates: a rotated run of ones replicated in 2, 4, 8, 16, 32 or 64 bit elements.
+// All 5334 valid 64bit patterns are generated at compile time into an open addressing table keyed by value,
+// the 32bit patterns are the entries with an element size <= 32 (N = 0).
+
+#define BITMASK_TABLE_BITS 14
+#define BITMASK_TABLE_SIZE (1 << BITMASK_TABLE_BITS)
+
+struct BitmaskTable {
+    uint64_t keys[BITMASK_TABLE_SIZE]; // 0 marks an empty slot, it is never a valid pattern
+    uint16_t fields[BITMASK_TABLE_SIZE]; // N:immr:imms
+    int count;
+};
+
+constexpr uint32_t bitmask_hash(uint64_t value) {
+    return (value * 0x9e3779b97f4a7c15ull) >> (64 - BITMASK_TABLE_BITS);
+}
+
+constexpr BitmaskTable make_bitmask_table() {
+    BitmaskTable table = {};
+    for (int size = 2; size <= 64; size *= 2) {
+        uint64_t mask = ~0ull >> (64 - size);
+        for (int ones = 1; ones < size; ones++) {
+            uint64_t run = (1ull << ones) - 1;
+            for (int rotate = 0; rotate < size; rotate++) {
+                uint64_t value = rotate == 0 ? run : ((run >> rotate) | (run << (size - rotate))) & mask;
+                for (int s = size; s < 64; s *= 2) {
+                    value |= value << s;
+                }
+
+                uint32_t slot = bitmask_hash(value);
+                while (table.keys[slot] != 0) {
+                    slot = (slot + 1) & (BITMASK_TABLE_SIZE - 1);
+                }
+                table.keys[slot] = value;
+                table.fields[slot] = ((size == 64) << 12) | (rotate << 6) | (((~(uint32_t)(size - 1) << 1) | (ones - 1)) & 0b111111);
+                table.count++;
+            }
+        }
+    }
+    return table;
+}
+
+constexpr BitmaskTable bitmask_table = make_bitmask_table();
+
+// DecodeBitMasks() from the A64 pseudocode
+constexpr uint64_t decode_bitmask_imm(uint16_t fields) {
+    int n = fields >> 12;
+    int immr = (fields >> 6) & 0b111111;
+    int imms = fields & 0b111111;
+
+    int len = 6;
+    while (len > 0 && !(((n << 6) | (~imms & 0b111111)) & (1 << len))) {
+        len--;
+    }
+    int size = 1 << len;
+    uint64_t mask = ~0ull >> (64 - size);
+    uint64_t run = (1ull << ((imms & (size - 1)) + 1)) - 1;
+    int rotate = immr & (size - 1);
+    uint64_t value = rotate == 0 ? run : ((run >> rotate) | (run << (size - rotate))) & mask;
+    for (int s = size; s < 64; s *= 2) {
+        value |= value << s;
+    }
+    return value;
+}
+
+constexpr bool verify_bitmask_table(const BitmaskTable& table) {
+    int count64 = 0;
+    int count32 = 0;
+    for (int slot = 0; slot < BITMASK_TABLE_SIZE; slot++) {
+        if (table.keys[slot] == 0) {
+            continue;
+        }
+        if (decode_bitmask_imm(table.fields[slot]) != table.keys[slot]) {
+            return false;
+        }
+        count64++;
+        if (!(table.fields[slot] >> 12)) {
+            count32++;
+        }
+    }
+    return count64 == 5334 && count32 == 1302 && table.count == 5334;
+}
+
+static_assert(verify_bitmask_table(bitmask_table), "bitmask immediate table is inconsistent");
+
+// Stores N:immr:imms at bits 22, 16, 10 into fields.
+bool bitmask_imm(uint64_t value, int reg_size, uint32_t* fields) {
+    if (reg_size == 32) {
+        value &= 0xffffffffull;
+        value |= value << 32;
+    }
+
+    uint32_t slot = bitmask_hash(value);
+    while (bitmask_table.keys[slot] != 0) {
+        if (bitmask_table.keys[slot] == value) {
+            uint32_t f = bitmask_table.fields[slot];
+            if (reg_size == 32 && (f >> 12)) {
+                return false;
+            }
+            if (fields != nullptr) {
+                *fields = ((f >> 12) << 22) | (((f >> 6) & 0b111111) << 16) | ((f & 0b111111) << 10);
+            }
+            return true;
+        }
+        slot = (slot + 1) & (BITMASK_TABLE_SIZE - 1);
+    }
+    return false;
+}
+
+uint32_t encode_bitmask_imm(uint64_t value, int reg_size) {
+    uint32_t fields = 0;
+    bitmask_imm(value, reg_size, &fields);
+    return fields;
+}
+
+#define is_wide_imm32(operands, i)           (is_imm(operands, i) && wide_imm_hw(operands[i]->imm, 32) >= 0)
+#define is_wide_imm64(operands, i)           (is_imm(operands, i) && wide_imm_hw(operands[i]->imm, 64) >= 0)
+#define is_inv_wide_imm32(operands, i)       (is_imm(operands, i) && wide_imm_hw(~operands[i]->imm, 32) >= 0)
+#define is_inv_wide_imm64(operands, i)       (is_imm(operands, i) && wide_imm_hw(~operands[i]->imm, 64) >= 0)
+// a 32bit immediate may be written signed or unsigned
+#define is_imm32(operands, i)                (is_imm(operands, i) && operands[i]->imm >= INT32_MIN && operands[i]->imm <= UINT32_MAX)
+#define is_bitmask_imm32(operands, i)        (is_imm32(operands, i) && bitmask_imm(operands[i]->imm, 32, nullptr))
+#define is_bitmask_imm64(operands, i)        (is_imm(operands, i) && bitmask_imm(operands[i]->imm, 64, nullptr))
+#define is_inv_bitmask_imm32(operands, i)    (is_imm32(operands, i) && bitmask_imm(~operands[i]->imm, 32, nullptr))
+#define is_inv_bitmask_imm64(operands, i)    (is_imm(operands, i) && bitmask_imm(~operands[i]->imm, 64, nullptr))
+
+// imm8 of fmov: +-(16..31)/16 * 2^(-3..4), stored as a:b:c:d:e:f:g:h with the exponent in b:c:d
+bool fp8_imm(double value, uint32_t* imm8) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int exp = (int)((bits >> 52) & 0x7ff) - 1023;
+    if ((bits & 0xffffffffffffull) != 0 || exp < -3 || exp > 4) {
+        return false;
+    }
+    if (imm8 != nullptr) {
+        uint32_t bcd = exp >= 1 ? exp - 1 : 0b100 | (exp + 3);
+        *imm8 = (uint32_t)(bits >> 63) << 7 | bcd << 4 | (uint32_t)((bits >> 48) & 0b1111);
+    }
+    return true;
+}
+
+uint32_t encode_fp8_imm(double value) {
+    uint32_t imm8 = 0;
+    fp8_imm(value, &imm8);
+    return imm8;
+}
+
+#define is_fp8_imm(operands, i)              (is_fp_imm(operands, i) && fp8_imm(operands[i]->fp_imm, nullptr))
+
+// Operand values are checked where they are put into their fields. A value that does not
+// fit would spill into the neighbouring fields and encode another instruction.
+// The checks are off while an instruction is encoded with 0 for its unresolved expressions,
+// resolve_exprs encodes it again with their values.
+bool operand_checks = true;
+
+// element indexes of a 128 bit register
+void check_elem_index(int elem_size, int64_t index) {
+    if (operand_checks && (index < 0 || index >= (16 >> elem_size))) {
+        operand_error("element index " + std::to_string(index) + " out of range");
+    }
+}
+
+// imm5 of dup/ins/umov/smov: element index above the lowest set bit, which gives the element size
+uint32_t encode_elem_imm5(int elem_size, int64_t index) {
+    check_elem_index(elem_size, index);
+    return (uint32_t)((index << (elem_size + 1)) | (1 << elem_size)) << 16;
+}
+
+// imm4 of ins (element): the source index, shifted by the element size
+uint32_t encode_elem_imm4(int elem_size, int64_t index) {
+    check_elem_index(elem_size, index);
+    return (uint32_t)(index << elem_size) << 11;
+}
+
+// size, Rm and the H:L:M index of integer by-element instructions (h elements are limited to v0-v15)
+uint32_t encode_elem_int(Operand* elem) {
+    check_elem_index(elem->val, elem->imm);
+    if (elem->val == ELEM_H) {
+        if (operand_checks && elem->regi_bits > 15) {
+            operand_error("h elements must be in v0-v15");
+        }
+        return (ELEM_H << 22) | (elem->regi_bits << 16) | ((elem->imm >> 2 & 1) << 11) | ((elem->imm >> 1 & 1) << 21) | ((elem->imm & 1) << 20);
+    }
+    return (ELEM_S << 22) | (elem->regi_bits << 16) | ((elem->imm >> 1 & 1) << 11) | ((elem->imm & 1) << 21);
+}
+
+// sz, Rm and the H:L index of floating-point by-element instructions
+uint32_t encode_elem_fp(Operand* elem) {
+    check_elem_index(elem->val, elem->imm);
+    if (elem->val == ELEM_D) {
+        return (1 << 22) | (elem->regi_bits << 16) | ((elem->imm & 1) << 11);
+    }
+    return (elem->regi_bits << 16) | ((elem->imm >> 1 & 1) << 11) | ((elem->imm & 1) << 21);
+}
+
+// immh:immb of shifts by immediate: esize + shift for left shifts (0..esize-1), 2 * esize - shift
+// for right shifts (1..esize)
+uint32_t encode_vshift_imm(int arrangement, int64_t shift, bool right) {
+    int64_t esize = 8 << (arrangement >> 1);
+    if (operand_checks && (right ? shift < 1 || shift > esize : shift < 0 || shift >= esize)) {
+        operand_error("shift " + std::to_string(shift) + " out of range");
+    }
+    return (uint32_t)(right ? 2 * esize - shift : esize + shift) << 16;
+}
+
+// imm4 of ext, a byte index into the first register
+uint32_t encode_ext_imm(int arrangement, int64_t index) {
+    if (operand_checks && (index < 0 || index >= ((arrangement & 1) ? 16 : 8))) {
+        operand_error("byte index " + std::to_string(index) + " out of range");
+    }
+    return (uint32_t)index << 11;
+}
+
+// the post-index immediate of ld1-ld4/st1-st4 is the size of the list, Rm = 31 is in the opcode
+uint32_t check_vlist_post_imm(Operand* list, int64_t imm) {
+    int64_t size = list->amount * ((list->val & 1) ? 16 : 8);
+    if (operand_checks && imm != size) {
+        operand_error("post-index immediate must be #" + std::to_string(size));
+    }
+    return 0;
+}
+
+// a signed or unsigned field of `bits` bits counting units of `scale`
+uint32_t encode_field(const char* what, int64_t value, int bits, bool is_signed, int scale) {
+    int64_t min = is_signed ? -((int64_t)1 << (bits - 1)) * scale : 0;
+    int64_t max = (is_signed ? ((int64_t)1 << (bits - 1)) - 1 : ((int64_t)1 << bits) - 1) * scale;
+    if (operand_checks && value % scale != 0) {
+        operand_error(std::string(what) + " " + std::to_string(value) + " is not a multiple of " + std::to_string(scale));
+    }
+    if (operand_checks && (value < min || value > max)) {
+        operand_error(std::string(what) + " " + std::to_string(value) + " out of range [" + std::to_string(min) + ", " + std::to_string(max) + "]");
+    }
+    return (uint32_t)((value / scale) & (((int64_t)1 << bits) - 1));
+}
+
+// offsets of loads and stores, in units of `scale` bytes
+uint32_t encode_offset(int64_t offset, int bits, bool is_signed, int scale) {
+    return encode_field("offset", offset, bits, is_signed, scale);
+}
+
+// the LSL #amount of add/sub (0 or 12) and movz/movn/movk (0, 16, 32 or 48 within the register)
+uint32_t encode_lsl_shift(Operand* shift, int step, int max) {
+    if (operand_checks && (shift->val != LSL || shift->amount % step != 0 || shift->amount > max)) {
+        std::string amounts = "#0";
+        for (int amount = step; amount <= max; amount += step) {
+            amounts += (amount == max ? " or #" : ", #") + std::to_string(amount);
+        }
+        operand_error("shift must be LSL " + amounts);
+    }
+    return shift->amount / step;
+}
+
+// imm12 and sh of add/sub (immediate). Without an LSL, a multiple of 4096 that only fits shifted
+// is encoded as `#imm >> 12, lsl #12`, as GNU as does. `negate` encodes the negative immediate
+// of the opposite instruction; errors show the immediate as written.
+uint32_t encode_add_imm(Operand** operands, int operand_length, int idx, bool negate) {
+    int64_t imm = operands[idx]->imm;
+    int64_t value = negate ? (int64_t)(0 - (uint64_t)imm) : imm;
+    uint32_t shift = 0;
+    if (operand_length > idx + 1) {
+        shift = encode_lsl_shift(operands[idx + 1], 12, 12);
+    } else if (value > 4095 && value % 4096 == 0 && value / 4096 <= 4095) {
+        value /= 4096;
+        shift = 1;
+    }
+    if (operand_checks && (value < 0 || value > 4095)) {
+        std::string range = negate ? "[-4095, 0]" : "[0, 4095]";
+        if (operand_length <= idx + 1) {
+            range += negate ? " or a multiple of 4096 in [-16773120, -4096]" : " or a multiple of 4096 in [4096, 16773120]";
+        }
+        operand_error("immediate " + std::to_string(imm) + " out of range " + range);
+    }
+    return (uint32_t)(value & 0xfff) << 10 | shift << 22;
+}
+
+// S of register offsets: the index is shifted by log2 of the access size or not at all
+uint32_t encode_regi_offset_shift(Operand* extend, int size_shift) {
+    if (operand_checks && extend->amount != 0 && extend->amount != size_shift) {
+        operand_error(size_shift == 0 ? "shift amount must be 0" : "shift amount must be 0 or " + std::to_string(size_shift));
+    }
+    return extend->amount != 0;
+}
+
+// imm4 of the SVE element count instructions, mul #1..#16
+uint32_t encode_sve_mul(int64_t mul) {
+    if (operand_checks && (mul < 1 || mul > 16)) {
+        operand_error("mul " + std::to_string(mul) + " out of range [1, 16]");
+    }
+    return (uint32_t)(mul - 1) & 0b1111;
+}
+
+// b5:b40 of tbz/tbnz, the bit number must be inside the tested register
+uint32_t encode_test_bit(Operand* reg, int64_t bit) {
+    int64_t size = reg->kind == WR ? 32 : 64;
+    if (operand_checks && (bit < 0 || bit >= size)) {
+        operand_error("bit " + std::to_string(bit) + " out of range [0, " + std::to_string(size - 1) + "]");
+    }
+    return (uint32_t)((bit >> 5) & 1) << 31 | (uint32_t)(bit & 0b11111) << 19;
+}
+
+// scale of the fixed-point conversions, fbits goes from 1 to the size of the general register
+uint32_t encode_fbits(Operand* reg, int64_t fbits) {
+    int64_t size = reg->kind == WR ? 32 : 64;
+    if (operand_checks && (fbits < 1 || fbits > size)) {
+        operand_error("fbits " + std::to_string(fbits) + " out of range [1, " + std::to_string(size) + "]");
+    }
+    return (uint32_t)(64 - fbits) & 0b111111;
+}
+
+// CRm of msr (immediate), pan/uao/dit/ssbs/tco take 0 or 1
+uint32_t encode_pstate_imm(int field, int64_t imm) {
+    return encode_field("immediate", imm, pstate_field_max(field) == 1 ? 1 : 4, false, 1);
+}
+
+// mrs can't read write-only registers and msr can't write read-only ones
+uint32_t encode_sysreg(int encoding, SysRegAccess access) {
+    SysRegAccess allowed = system_register_access(encoding);
+    if (operand_checks && allowed != READ_WRITE && allowed != access) {
+        operand_error(allowed == READ_ONLY ? "system register is read-only" : "system register is write-only");
+    }
+    return encoding;
+}
+
+// S:imm9 of ldraa/ldrab, a signed offset in units of 8 bytes split over bits 22 and 12-20
+uint32_t encode_pac_offset(int64_t offset) {
+    uint32_t imm10 = encode_offset(offset, 10, true, 8);
+    return (imm10 >> 9) << 22 | (imm10 & 0b111111111) << 12;
+}
+
+// shift type and amount of a shifted register, the amount is less than the register size
+uint32_t encode_reg_shift(Operand* reg, Operand* shift, int b1, int b2) {
+    int size = reg->kind == XR ? 64 : 32;
+    if (operand_checks && (shift->amount < 0 || shift->amount >= size)) {
+        operand_error("shift " + std::to_string(shift->amount) + " out of range [0, " + std::to_string(size - 1) + "]");
+    }
+    return (shift->val << b1) | ((shift->amount & (size - 1)) << b2);
+}
+
+// Rs of the store exclusives, which must differ from the registers stored and from the base
+// (other than sp), as the result would be unpredictable
+uint32_t encode_status_regi(Operand** operands, int operand_length) {
+    int rs = operands[0]->regi_bits;
+    for (int i = 1; operand_checks && i < operand_length; i++) {
+        Operand* op = operands[i];
+        if (op->kind == MEM_OP_BASE || op->kind == MEM_OP_IMM_OFFSET) {
+            if (op->base_register->kind == XR && op->base_register->regi_bits == rs) {
+                operand_error("the status register must differ from the base register");
+            }
+        } else if (op->regi_bits == rs) {
+            operand_error("the status register must differ from the stored registers");
+        }
+    }
+    return rs;
+}
+
 #define ENCODE_REGI(operand_idx, b)                 (operands[operand_idx]->regi_bits << b)
-#define ENCODE_SHIFTS(operand_idx, b1, b2)          ((operand_length > operand_idx) ? (operands[operand_idx]->val << b1) | (operands[operand_idx]->amount << b2) : 0)
+#define ENCODE_STATUS_REGI(b)                       (encode_status_regi(operands, operand_length) << b)
+#define ENCODE_SHIFTS(operand_idx, b1, b2)          ((operand_length > operand_idx) ? encode_reg_shift(operands[operand_idx - 1], operands[operand_idx], b1, b2) : 0)
 
 #define ENCODE_MEM_OP_BASE(operand_idx, b)             (operands[operand_idx]->base_register->regi_bits << b)
 
-#define ENCODE_MEM_OP_IMM9_OFFSET(operand_idx, b1, b2)  (operands[operand_idx]->base_register->regi_bits << b1) | ((operands[operand_idx]->offset->imm & 0b111111111) << b2)
-#define ENCODE_MEM_OP_IMM12_OFFSET(operand_idx, b1, b2) (operands[operand_idx]->base_register->regi_bits << b1) | ((operands[operand_idx]->offset->imm & 0b111111111111) << b2)
+#define ENCODE_MEM_OP_IMM9_OFFSET(operand_idx, b1, b2)  (operands[operand_idx]->base_register->regi_bits << b1) | (encode_offset(operands[operand_idx]->offset->imm, 9, true, 1) << b2)
+#define ENCODE_MEM_OP_IMM12_OFFSET(operand_idx, b1, b2) (operands[operand_idx]->base_register->regi_bits << b1) | (encode_offset(operands[operand_idx]->offset->imm, 12, false, 1) << b2)
 
-#define ENCODE_MEM_OP_DIV_IMM7_OFFSET(operand_idx, b1, b2, div)  (operands[operand_idx]->base_register->regi_bits << b1) | (((operands[operand_idx]->offset->imm / div) & 0b1111111) << b2)
-#define ENCODE_MEM_OP_DIV_IMM9_OFFSET(operand_idx, b1, b2, div)  (operands[operand_idx]->base_register->regi_bits << b1) | (((operands[operand_idx]->offset->imm / div) & 0b111111111) << b2)
-#define ENCODE_MEM_OP_DIV_IMM12_OFFSET(operand_idx, b1, b2, div) (operands[operand_idx]->base_register->regi_bits << b1) | (((operands[operand_idx]->offset->imm / div) & 0b111111111111) << b2)
+#define ENCODE_MEM_OP_DIV_IMM7_OFFSET(operand_idx, b1, b2, div)  (operands[operand_idx]->base_register->regi_bits << b1) | (encode_offset(operands[operand_idx]->offset->imm, 7, true, div) << b2)
+#define ENCODE_MEM_OP_DIV_IMM12_OFFSET(operand_idx, b1, b2, div) (operands[operand_idx]->base_register->regi_bits << b1) | (encode_offset(operands[operand_idx]->offset->imm, 12, false, div) << b2)
+#define ENCODE_MEM_OP_PAC_OFFSET(operand_idx, b)                 (operands[operand_idx]->base_register->regi_bits << b) | encode_pac_offset(operands[operand_idx]->offset->imm)
 
-#define ENCODE_MEM_OP_REGI_OFFSET(operand_idx, b1, b2, b3, b4, div_amount)   (operands[operand_idx]->base_register->regi_bits << b1) | (operands[operand_idx]->offset->regi_bits << b2) | (operands[operand_idx]->extend_offset->val << b3) | ((operands[operand_idx]->extend_offset->amount / div_amount) << b4)
+#define ENCODE_MEM_OP_REGI_OFFSET(operand_idx, b1, b2, b3, b4, size_shift)   (operands[operand_idx]->base_register->regi_bits << b1) | (operands[operand_idx]->offset->regi_bits << b2) | (operands[operand_idx]->extend_offset->val << b3) | (encode_regi_offset_shift(operands[operand_idx]->extend_offset, size_shift) << b4)
 
 // imm
-#define ENCODE_IMM4(operand_idx, b)               (operands[operand_idx]->imm & 0b1111) << b
-#define ENCODE_IMM5(operand_idx, b)               (operands[operand_idx]->imm & 0b11111) << b
-#define ENCODE_IMM6(operand_idx, b)               (operands[operand_idx]->imm & 0b111111) << b
-#define ENCODE_IMM7(operand_idx, b)               (operands[operand_idx]->imm & 0b1111111) << b
-#define ENCODE_IMM8(operand_idx, b)               (operands[operand_idx]->imm & 0b11111111) << b
-#define ENCODE_IMM9(operand_idx, b)               (operands[operand_idx]->imm & 0b111111111) << b
-#define ENCODE_IMM10(operand_idx, b)              (operands[operand_idx]->imm & 0b1111111111) << b
-#define ENCODE_IMM11(operand_idx, b)              (operands[operand_idx]->imm & 0b11111111111) << b
-#define ENCODE_IMM12(operand_idx, b)              (operands[operand_idx]->imm & 0b111111111111) << b
-#define ENCODE_IMM16(operand_idx, b)              (operands[operand_idx]->imm & 0b1111111111111111) << b
-
-#define ENCODE_DIV_IMM7(operand_idx, b, div)      ((operands[operand_idx]->imm / div) & 0b1111111) << b
-
-#define ENCODE_SUB_IMM6(operand_idx, sub, b)      ((sub - operands[operand_idx]->imm) & 0b111111) << b
-#define ENCODE_NEG_MOD_IMM6(operand_idx, mod, b)  (((-operands[operand_idx]->imm) % mod) & 0b111111) << b
+#define ENCODE_IMM4(operand_idx, b)               (encode_field("immediate", operands[operand_idx]->imm, 4, false, 1) << b)
+#define ENCODE_IMM5(operand_idx, b)               (encode_field("immediate", operands[operand_idx]->imm, 5, false, 1) << b)
+#define ENCODE_IMM6(operand_idx, b)               (encode_field("immediate", operands[operand_idx]->imm, 6, false, 1) << b)
+#define ENCODE_IMM7(operand_idx, b)               (encode_field("immediate", operands[operand_idx]->imm, 7, false, 1) << b)
+#define ENCODE_IMM8(operand_idx, b)               (encode_field("immediate", operands[operand_idx]->imm, 8, false, 1) << b)
+#define ENCODE_IMM9(operand_idx, b)               (encode_field("immediate", operands[operand_idx]->imm, 9, false, 1) << b)
+#define ENCODE_IMM10(operand_idx, b)              (encode_field("immediate", operands[operand_idx]->imm, 10, false, 1) << b)
+#define ENCODE_IMM11(operand_idx, b)              (encode_field("immediate", operands[operand_idx]->imm, 11, false, 1) << b)
+#define ENCODE_IMM16(operand_idx, b)              (encode_field("immediate", operands[operand_idx]->imm, 16, false, 1) << b)
+#define ENCODE_ADD_IMM(operand_idx)               encode_add_imm(operands, operand_length, operand_idx, false)
+#define ENCODE_NEG_ADD_IMM(operand_idx)           encode_add_imm(operands, operand_length, operand_idx, true)
+#define ENCODE_SIMM8(operand_idx, b)              (encode_field("immediate", operands[operand_idx]->imm, 8, true, 1) << b)
+
+#define ENCODE_WIDE_IMM(operand_idx, reg_size)        encode_wide_imm(operands[operand_idx]->imm, reg_size)
+#define ENCODE_INV_WIDE_IMM(operand_idx, reg_size)    encode_wide_imm(~operands[operand_idx]->imm, reg_size)
+#define ENCODE_BITMASK_IMM(operand_idx, reg_size)     encode_bitmask_imm(operands[operand_idx]->imm, reg_size)
+#define ENCODE_INV_BITMASK_IMM(operand_idx, reg_size) encode_bitmask_imm(~operands[operand_idx]->imm, reg_size)
+#define ENCODE_FP8_IMM(operand_idx, b)                (encode_fp8_imm(operands[operand_idx]->fp_imm) << b)
+
+#define ENCODE_DIV_IMM7(operand_idx, b, div)      encode_offset(operands[operand_idx]->imm, 7, true, div) << b
+#define ENCODE_SIMM9(operand_idx, b)              encode_offset(operands[operand_idx]->imm, 9, true, 1) << b
+
+#define ENCODE_SUB_IMM6(operand_idx, sub, b)      (uint32_t)((sub - operands[operand_idx]->imm) & 0b111111) << b
+#define ENCODE_NEG_MOD_IMM6(operand_idx, mod, b)  (uint32_t)(((-operands[operand_idx]->imm) % mod) & 0b111111) << b
+
+// AdvSIMD
+#define ENCODE_VQ(operand_idx)                    ((operands[operand_idx]->val & 1) << 30)
+#define ENCODE_VSIZE(operand_idx)                 ((operands[operand_idx]->val >> 1) << 22)
+#define ENCODE_VSZ(operand_idx)                   (((operands[operand_idx]->val >> 1) & 1) << 22)
+#define ENCODE_VLIST(operand_idx)                 (((operands[operand_idx]->val & 1) << 30) | ((operands[operand_idx]->val >> 1) << 10))
+#define ENCODE_VLIST_LEN(operand_idx)             ((operands[operand_idx]->amount - 1) << 13)
+#define ENCODE_ELEM_IMM5(operand_idx)             encode_elem_imm5(operands[operand_idx]->val, operands[operand_idx]->imm)
+#define ENCODE_DUP_IMM5(operand_idx)              encode_elem_imm5(operands[operand_idx]->val >> 1, 0)
+#define ENCODE_ELEM_IMM4(operand_idx)             encode_elem_imm4(operands[operand_idx]->val, operands[operand_idx]->imm)
+#define ENCODE_ELEM_INT(operand_idx)              encode_elem_int(operands[operand_idx])
+#define ENCODE_ELEM_FP(operand_idx)               encode_elem_fp(operands[operand_idx])
+#define ENCODE_VSHL_IMM(operand_idx, arr_idx)     encode_vshift_imm(operands[arr_idx]->val, operands[operand_idx]->imm, false)
+#define ENCODE_VSHR_IMM(operand_idx, arr_idx)     encode_vshift_imm(operands[arr_idx]->val, operands[operand_idx]->imm, true)
+#define ENCODE_EXT_IMM(operand_idx, arr_idx)      encode_ext_imm(operands[arr_idx]->val, operands[operand_idx]->imm)
+#define ENCODE_VLIST_POST_IMM(list_idx, imm_idx)  check_vlist_post_imm(operands[list_idx], operands[imm_idx]->imm)
+
+// SVE
+#define ENCODE_SVE_SIZE(operand_idx)              (operands[operand_idx]->val << 22)
+#define ENCODE_SVE_PATTERN(operand_idx)           (operands[operand_idx]->val << 5)
+#define ENCODE_SVE_MUL(operand_idx)               (encode_sve_mul(operands[operand_idx]->amount) << 16)
+#define ENCODE_MEM_OP_REGI_LSL(operand_idx, b1, b2)     (operands[operand_idx]->base_register->regi_bits << b1) | (operands[operand_idx]->offset->regi_bits << b2)
+#define ENCODE_MEM_OP_VL_OFFSET(operand_idx, b1, b2)    (operands[operand_idx]->base_register->regi_bits << b1) | (uint32_t)((operands[operand_idx]->offset->imm & 0b1111) << b2)
+
+// tbz/tbnz bit number, b5:b40
+#define ENCODE_TEST_BIT(operand_idx)              encode_test_bit(operands[0], operands[operand_idx]->imm)
+// fixed-point conversions, scale = 64 - fbits
+#define ENCODE_FBITS(reg_idx, operand_idx)        (encode_fbits(operands[reg_idx], operands[operand_idx]->imm) << 10)
+
+// barrier option, prefetch operation, dc/ic operation, system register
+#define ENCODE_VAL(operand_idx, b)                (operands[operand_idx]->val << b)
+#define ENCODE_PSTATE_FIELD(operand_idx)          (operands[operand_idx]->amount)
+#define ENCODE_PSTATE_IMM(field_idx, imm_idx)     (encode_pstate_imm(operands[field_idx]->amount, operands[imm_idx]->imm) << 8)
+#define ENCODE_SYSREG(operand_idx, access)        encode_sysreg(operands[operand_idx]->val, access)
 
 // cond
 #define ENCODE_COND(operand_idx, b)               (operands[operand_idx]->val << b)
@@ -264,12 +1084,17 @@ CondType invert_cond(CondType cond) {
 // extend
 #define ENCODE_EXTENDX(operand_idx, b1, b2)       ((operand_length > operand_idx) ? ((operands[operand_idx]->val << b1) | (operands[operand_idx]->amount << b2)) : UXTX << b1)
 #define ENCODE_EXTENDW(operand_idx, b1, b2)       ((operand_length > operand_idx) ? ((operands[operand_idx]->val << b1) | (operands[operand_idx]->amount << b2)) : UXTW << b1)
-#define ENCODE_LSL_SHIFTS(operand_idx, div, b)    ((operand_length > operand_idx) ? ((operands[operand_idx]->amount / div) << b) : 0)
+#define ENCODE_LSL_SHIFTS(operand_idx, div, max, b) ((operand_length > operand_idx) ? (encode_lsl_shift(operands[operand_idx], div, max) << b) : 0)
 
 // Base instructions in alphabetic order
 // https://student.cs.uwaterloo.ca/~cs452/docs/rpi4b/ISA_A64_xml_v88A-2021-12_OPT.pdf
 
 static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>> instr_table = {
+    {"abs", [](Operand** operands, int operand_length) {
+        // AdvSIMD two-register misc
+        if (pattern2(vreg_bhsd, vsame))                 return (uint32_t)0b00001110001000001011100000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
     {"adc", [](Operand** operands, int operand_length) {
         if (pattern3(xr, xr, xr))                       return (uint32_t)0b10011010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16); // #1
         if (pattern3(wr, wr, wr))                       return (uint32_t)0b00011010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16); // #1
@@ -283,23 +1108,58 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
     {"add", [](Operand** operands, int operand_length) {
         if (pattern3(xr, xr, xr_shift))                 return (uint32_t)0b10001011000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
         if (pattern3(wr, wr, wr_shift))                 return (uint32_t)0b00001011000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
-        if (pattern3(xr_or_xsp, xr_or_xsp, imm_shift))  return (uint32_t)0b10010001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_IMM12(2, 10) | ENCODE_LSL_SHIFTS(3, 12, 22); // #3
-        if (pattern3(wr_or_wsp, wr_or_wsp, imm_shift))  return (uint32_t)0b00010001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_IMM12(2, 10) | ENCODE_LSL_SHIFTS(3, 12, 22); // #3
+        // SUB (immediate) for negative immediates
+        if (pattern3(xr_or_xsp, xr_or_xsp, neg_imm_shift)) return (uint32_t)0b11010001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_NEG_ADD_IMM(2);
+        if (pattern3(wr_or_wsp, wr_or_wsp, neg_imm_shift)) return (uint32_t)0b01010001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_NEG_ADD_IMM(2);
+        if (pattern3(xr_or_xsp, xr_or_xsp, imm_shift))  return (uint32_t)0b10010001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_ADD_IMM(2); // #3
+        if (pattern3(wr_or_wsp, wr_or_wsp, imm_shift))  return (uint32_t)0b00010001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_ADD_IMM(2); // #3
         if (pattern3(wr_or_wsp, wr_or_wsp, wr_extend))  return (uint32_t)0b00001011001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_EXTENDW(3, 13, 10); // #4
         if (pattern3(xr_or_xsp, xr_or_xsp, xr_extend))  return (uint32_t)0b10001011001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_EXTENDX(3, 13, 10); // #5
         if (pattern3(xr_or_xsp, xr_or_xsp, wr_extend))  return (uint32_t)0b10001011001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_EXTENDW(3, 13, 10); // #4
+        // AdvSIMD three same
+        if (pattern3(vreg_bhsd, vsame, vsame))          return (uint32_t)0b00001110001000001000010000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // SVE integer add/subtract vectors (unpredicated)
+        if (pattern3(zreg, zsame, zsame))               return (uint32_t)0b00000100001000000000000000000000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"addp", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhsd, vsame, vsame))          return (uint32_t)0b00001110001000001011110000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
         unreachable();
     }},
     {"adds", [](Operand** operands, int operand_length) {
         if (pattern3(xr, xr, xr_shift))                 return (uint32_t)0b10101011000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
         if (pattern3(wr, wr, wr_shift))                 return (uint32_t)0b00101011000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
-        if (pattern3(xr, xr_or_xsp, imm_shift))         return (uint32_t)0b10110001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_IMM12(2, 10) | ENCODE_LSL_SHIFTS(3, 12, 22); // #3
-        if (pattern3(wr, wr_or_wsp, imm_shift))         return (uint32_t)0b00110001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_IMM12(2, 10) | ENCODE_LSL_SHIFTS(3, 12, 22); // #3
+        // SUBS (immediate) for negative immediates
+        if (pattern3(xr, xr_or_xsp, neg_imm_shift))     return (uint32_t)0b11110001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_NEG_ADD_IMM(2);
+        if (pattern3(wr, wr_or_wsp, neg_imm_shift))     return (uint32_t)0b01110001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_NEG_ADD_IMM(2);
+        if (pattern3(xr, xr_or_xsp, imm_shift))         return (uint32_t)0b10110001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_ADD_IMM(2); // #3
+        if (pattern3(wr, wr_or_wsp, imm_shift))         return (uint32_t)0b00110001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_ADD_IMM(2); // #3
         if (pattern3(wr, wr_or_wsp, wr_extend))         return (uint32_t)0b00101011001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_EXTENDW(3, 13, 10); // #4
         if (pattern3(xr, xr_or_xsp, xr_extend))         return (uint32_t)0b10101011001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_EXTENDX(3, 13, 10); // #5
         if (pattern3(xr, xr_or_xsp, wr_extend))         return (uint32_t)0b10101011001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_EXTENDX(3, 13, 10); // #5
         unreachable();
     }},
+    {"and", [](Operand** operands, int operand_length) {
+        // (immediate)
+        if (pattern3(wr_or_wsp, wr, bitmask_imm32))     return (uint32_t)0b00010010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_BITMASK_IMM(2, 32);
+        if (pattern3(xr_or_xsp, xr, bitmask_imm64))     return (uint32_t)0b10010010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_BITMASK_IMM(2, 64);
+        // (shifted register)
+        if (pattern3(wr, wr, wr_shift))                 return (uint32_t)0b00001010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
+        if (pattern3(xr, xr, xr_shift))                 return (uint32_t)0b10001010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
+        // AdvSIMD three same (logical)
+        if (pattern3(vreg_b, vsame, vsame))             return (uint32_t)0b00001110001000000001110000000000 | ENCODE_VQ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"ands", [](Operand** operands, int operand_length) {
+        // (immediate)
+        if (pattern3(wr, wr, bitmask_imm32))            return (uint32_t)0b01110010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_BITMASK_IMM(2, 32);
+        if (pattern3(xr, xr, bitmask_imm64))            return (uint32_t)0b11110010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_BITMASK_IMM(2, 64);
+        // (shifted register)
+        if (pattern3(wr, wr, wr_shift))                 return (uint32_t)0b01101010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
+        if (pattern3(xr, xr, xr_shift))                 return (uint32_t)0b11101010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
+        unreachable();
+    }},
     {"asr", [](Operand** operands, int operand_length) {
         if (pattern3(xr, xr, xr))                       return (uint32_t)0b10011010110000000010100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16); // #1
         if (pattern3(wr, wr, wr))                       return (uint32_t)0b00011010110000000010100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16); // #1
@@ -368,6 +1228,60 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern1(xr))                               return (uint32_t)0b11011010110000010011011111100000 | ENCODE_REGI(0, 0); // #7
         unreachable();
     }},
+    {"b", [](Operand** operands, int operand_length) {
+        // B.cond
+        if (pattern2(cond, label))                      return (uint32_t)0b01010100000000000000000000000000 | ENCODE_COND(0, 0);
+        // B
+        if (pattern1(label))                            return (uint32_t)0b00010100000000000000000000000000;
+        unreachable();
+    }},
+    {"bic", [](Operand** operands, int operand_length) {
+        // (immediate)
+        if (pattern3(wr_or_wsp, wr, inv_bitmask_imm32)) return (uint32_t)0b00010010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_INV_BITMASK_IMM(2, 32);
+        if (pattern3(xr_or_xsp, xr, inv_bitmask_imm64)) return (uint32_t)0b10010010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_INV_BITMASK_IMM(2, 64);
+        // (shifted register)
+        if (pattern3(wr, wr, wr_shift))                 return (uint32_t)0b00001010001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
+        if (pattern3(xr, xr, xr_shift))                 return (uint32_t)0b10001010001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
+        // AdvSIMD three same (logical)
+        if (pattern3(vreg_b, vsame, vsame))             return (uint32_t)0b00001110011000000001110000000000 | ENCODE_VQ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"bics", [](Operand** operands, int operand_length) {
+        // (immediate)
+        if (pattern3(wr, wr, inv_bitmask_imm32))        return (uint32_t)0b01110010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_INV_BITMASK_IMM(2, 32);
+        if (pattern3(xr, xr, inv_bitmask_imm64))        return (uint32_t)0b11110010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_INV_BITMASK_IMM(2, 64);
+        // (shifted register)
+        if (pattern3(wr, wr, wr_shift))                 return (uint32_t)0b01101010001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
+        if (pattern3(xr, xr, xr_shift))                 return (uint32_t)0b11101010001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
+        unreachable();
+    }},
+    {"bif", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (logical)
+        if (pattern3(vreg_b, vsame, vsame))             return (uint32_t)0b00101110111000000001110000000000 | ENCODE_VQ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"bit", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (logical)
+        if (pattern3(vreg_b, vsame, vsame))             return (uint32_t)0b00101110101000000001110000000000 | ENCODE_VQ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"bl", [](Operand** operands, int operand_length) {
+        if (pattern1(label))                            return (uint32_t)0b10010100000000000000000000000000;
+        unreachable();
+    }},
+    {"blr", [](Operand** operands, int operand_length) {
+        if (pattern1(xr))                               return (uint32_t)0b11010110001111110000000000000000 | ENCODE_REGI(0, 5);
+        unreachable();
+    }},
+    {"br", [](Operand** operands, int operand_length) {
+        if (pattern1(xr))                               return (uint32_t)0b11010110000111110000000000000000 | ENCODE_REGI(0, 5);
+        unreachable();
+    }},
+    {"bsl", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (logical)
+        if (pattern3(vreg_b, vsame, vsame))             return (uint32_t)0b00101110011000000001110000000000 | ENCODE_VQ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
     {"cas", [](Operand** operands, int operand_length) {
         if (pattern3(wr, wr, mem_op_base))              return (uint32_t)0b10001000101000000111110000000000 | ENCODE_REGI(0, 16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
         if (pattern3(xr, xr, mem_op_base))              return (uint32_t)0b11001000101000000111110000000000 | ENCODE_REGI(0, 16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
@@ -407,6 +1321,16 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern3(wr, wr, mem_op_base))              return (uint32_t)0b01001000101000000111110000000000 | ENCODE_REGI(0, 16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
         unreachable();
     }},
+    {"cbnz", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, label))                        return (uint32_t)0b00110101000000000000000000000000 | ENCODE_REGI(0, 0);
+        if (pattern2(xr, label))                        return (uint32_t)0b10110101000000000000000000000000 | ENCODE_REGI(0, 0);
+        unreachable();
+    }},
+    {"cbz", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, label))                        return (uint32_t)0b00110100000000000000000000000000 | ENCODE_REGI(0, 0);
+        if (pattern2(xr, label))                        return (uint32_t)0b10110100000000000000000000000000 | ENCODE_REGI(0, 0);
+        unreachable();
+    }},
     {"ccmn", [](Operand** operands, int operand_length) {
         // immediate
         if (pattern4(xr, imm, imm, cond))               return (uint32_t)0b10111010010000000000100000000000 | ENCODE_REGI(0, 5) | ENCODE_IMM5(1, 16) | ENCODE_IMM4(2, 0) | ENCODE_COND(3, 12); // #9
@@ -454,6 +1378,31 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern2(wr, wr))                           return (uint32_t)0b01011010110000000001000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5); // #8
         unreachable();
     }},
+    {"cmeq", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhsd, vsame, vsame))          return (uint32_t)0b00101110001000001000110000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"cmge", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhsd, vsame, vsame))          return (uint32_t)0b00001110001000000011110000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"cmgt", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhsd, vsame, vsame))          return (uint32_t)0b00001110001000000011010000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"cmhi", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhsd, vsame, vsame))          return (uint32_t)0b00101110001000000011010000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"cmhs", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhsd, vsame, vsame))          return (uint32_t)0b00101110001000000011110000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
     {"cmn", [](Operand** operands, int operand_length) {
         // (shiftted register)
         if (pattern2(xr, xr_shift))                     return (uint32_t)0b10101011000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16) | ENCODE_SHIFTS(2, 22, 10); // #11
@@ -463,8 +1412,11 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern3(xr_or_xsp, wr, extend))            return (uint32_t)0b10101011001000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16) | ENCODE_EXTENDX(2, 13, 10); // #12
         if (pattern2(wr_or_wsp, wr_extend))             return (uint32_t)0b00101011001000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16) | ENCODE_EXTENDW(2, 13, 10); // #13
         // (immediate)
-        if (pattern2(xr_or_xsp, imm_shift))             return (uint32_t)0b10110001000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_IMM12(1, 10) | ENCODE_LSL_SHIFTS(2, 12, 22); // #14
-        if (pattern2(wr_or_wsp, imm_shift))             return (uint32_t)0b00110001000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_IMM12(1, 10) | ENCODE_LSL_SHIFTS(2, 12, 22); // #14
+        // CMP (immediate) for negative immediates
+        if (pattern2(xr_or_xsp, neg_imm_shift))         return (uint32_t)0b11110001000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_NEG_ADD_IMM(1);
+        if (pattern2(wr_or_wsp, neg_imm_shift))         return (uint32_t)0b01110001000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_NEG_ADD_IMM(1);
+        if (pattern2(xr_or_xsp, imm_shift))             return (uint32_t)0b10110001000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_ADD_IMM(1); // #14
+        if (pattern2(wr_or_wsp, imm_shift))             return (uint32_t)0b00110001000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_ADD_IMM(1); // #14
         unreachable();
     }},
     {"cmp", [](Operand** operands, int operand_length) {
@@ -473,8 +1425,11 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern2(xr_or_xsp, xr_extend))             return (uint32_t)0b11101011001000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16) | ENCODE_EXTENDX(2, 13, 10); // #12
         if (pattern3(xr_or_xsp, wr, extend))            return (uint32_t)0b11101011001000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16) | ENCODE_EXTENDW(2, 13, 10); // #13
         if (pattern2(wr_or_wsp, wr_extend))             return (uint32_t)0b01101011001000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16) | ENCODE_EXTENDW(2, 13, 10); // #13
-        if (pattern2(xr_or_xsp, imm_shift))             return (uint32_t)0b11110001000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_IMM12(1, 10) | ENCODE_LSL_SHIFTS(2, 12, 22); // #14
-        if (pattern2(wr_or_wsp, imm_shift))             return (uint32_t)0b01110001000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_IMM12(1, 10) | ENCODE_LSL_SHIFTS(2, 12, 22); // #14
+        // CMN (immediate) for negative immediates
+        if (pattern2(xr_or_xsp, neg_imm_shift))         return (uint32_t)0b10110001000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_NEG_ADD_IMM(1);
+        if (pattern2(wr_or_wsp, neg_imm_shift))         return (uint32_t)0b00110001000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_NEG_ADD_IMM(1);
+        if (pattern2(xr_or_xsp, imm_shift))             return (uint32_t)0b11110001000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_ADD_IMM(1); // #14
+        if (pattern2(wr_or_wsp, imm_shift))             return (uint32_t)0b01110001000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_ADD_IMM(1); // #14
         unreachable();
     }},
     {"cneg", [](Operand** operands, int operand_length) {
@@ -482,6 +1437,39 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern3(wr, wr, cond))                     return (uint32_t)0b01011010100000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(1, 16) | ENCODE_INV_COND(2, 12); // #15
         unreachable();
     }},
+    {"cnt", [](Operand** operands, int operand_length) {
+        // AdvSIMD two-register misc
+        if (pattern2(vreg_b, vsame))                    return (uint32_t)0b00001110001000000101100000000000 | ENCODE_VQ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"cntb", [](Operand** operands, int operand_length) {
+        // SVE element count
+        if (pattern3(xr, sve_pattern, sve_mul))         return (uint32_t)0b00000100001000001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1) | ENCODE_SVE_MUL(2);
+        if (pattern2(xr, sve_pattern))                  return (uint32_t)0b00000100001000001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1);
+        if (pattern1(xr))                               return (uint32_t)0b00000100001000001110001111100000 | ENCODE_REGI(0, 0);
+        unreachable();
+    }},
+    {"cntd", [](Operand** operands, int operand_length) {
+        // SVE element count
+        if (pattern3(xr, sve_pattern, sve_mul))         return (uint32_t)0b00000100111000001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1) | ENCODE_SVE_MUL(2);
+        if (pattern2(xr, sve_pattern))                  return (uint32_t)0b00000100111000001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1);
+        if (pattern1(xr))                               return (uint32_t)0b00000100111000001110001111100000 | ENCODE_REGI(0, 0);
+        unreachable();
+    }},
+    {"cnth", [](Operand** operands, int operand_length) {
+        // SVE element count
+        if (pattern3(xr, sve_pattern, sve_mul))         return (uint32_t)0b00000100011000001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1) | ENCODE_SVE_MUL(2);
+        if (pattern2(xr, sve_pattern))                  return (uint32_t)0b00000100011000001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1);
+        if (pattern1(xr))                               return (uint32_t)0b00000100011000001110001111100000 | ENCODE_REGI(0, 0);
+        unreachable();
+    }},
+    {"cntw", [](Operand** operands, int operand_length) {
+        // SVE element count
+        if (pattern3(xr, sve_pattern, sve_mul))         return (uint32_t)0b00000100101000001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1) | ENCODE_SVE_MUL(2);
+        if (pattern2(xr, sve_pattern))                  return (uint32_t)0b00000100101000001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1);
+        if (pattern1(xr))                               return (uint32_t)0b00000100101000001110001111100000 | ENCODE_REGI(0, 0);
+        unreachable();
+    }},
     {"crc32b", [](Operand** operands, int operand_length) {
         if (pattern3(wr, wr, wr))                       return (uint32_t)0b00011010110000000100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16); // #1
         unreachable();
@@ -548,6 +1536,11 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern4(wr, wr, wr, cond))                 return (uint32_t)0b01011010100000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_COND(3, 12); // #16
         unreachable();
     }},
+    {"dc", [](Operand** operands, int operand_length) {
+        // DC: SYS #op1, C7, Cm, #op2, Xt
+        if (pattern2(dc_op, xr))                        return (uint32_t)0b11010101000010000000000000000000 | ENCODE_VAL(0, 0) | ENCODE_REGI(1, 0);
+        unreachable();
+    }},
     {"dcps1", [](Operand** operands, int operand_length) {
         if (operand_length == 0)                        return (uint32_t)0b11010100101000000000000000000001;
         if (pattern1(imm))                              return (uint32_t)0b11010100101000000000000000000001 | ENCODE_IMM16(0, 5); // #17
@@ -563,10 +1556,45 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern1(imm))                              return (uint32_t)0b11010100101000000000000000000011 | ENCODE_IMM16(0, 5); // #17
         unreachable();
     }},
+    {"dmb", [](Operand** operands, int operand_length) {
+        if (pattern1(barrier_opt))                      return (uint32_t)0b11010101000000110011000010111111 | ENCODE_VAL(0, 8);
+        if (pattern1(imm))                              return (uint32_t)0b11010101000000110011000010111111 | ENCODE_IMM4(0, 8);
+        unreachable();
+    }},
     {"drps", [](Operand** operands, int operand_length) {
         if (operand_length == 0)                        return (uint32_t)0b11010110101111110000001111100000;
         unreachable();
     }},
+    {"dsb", [](Operand** operands, int operand_length) {
+        if (pattern1(barrier_opt))                      return (uint32_t)0b11010101000000110011000010011111 | ENCODE_VAL(0, 8);
+        if (pattern1(imm))                              return (uint32_t)0b11010101000000110011000010011111 | ENCODE_IMM4(0, 8);
+        unreachable();
+    }},
+    {"dup", [](Operand** operands, int operand_length) {
+        // AdvSIMD copy
+        if (pattern2(vreg_bhsd, velem))                 return (uint32_t)0b00001110000000000000010000000000 | ENCODE_VQ(0) | ENCODE_ELEM_IMM5(1) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(vreg_bhs, wr))                     return (uint32_t)0b00001110000000000000110000000000 | ENCODE_VQ(0) | ENCODE_DUP_IMM5(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(vreg_bhsd, xr))                    return (uint32_t)0b00001110000000000000110000000000 | ENCODE_VQ(0) | ENCODE_DUP_IMM5(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // SVE broadcast integer immediate
+        if (pattern2(zreg, simm8))                      return (uint32_t)0b00100101001110001100000000000000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_SIMM8(1, 5);
+        unreachable();
+    }},
+    {"eon", [](Operand** operands, int operand_length) {
+        if (pattern3(wr, wr, wr_shift))                 return (uint32_t)0b01001010001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
+        if (pattern3(xr, xr, xr_shift))                 return (uint32_t)0b11001010001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
+        unreachable();
+    }},
+    {"eor", [](Operand** operands, int operand_length) {
+        // (immediate)
+        if (pattern3(wr_or_wsp, wr, bitmask_imm32))     return (uint32_t)0b01010010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_BITMASK_IMM(2, 32);
+        if (pattern3(xr_or_xsp, xr, bitmask_imm64))     return (uint32_t)0b11010010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_BITMASK_IMM(2, 64);
+        // (shifted register)
+        if (pattern3(wr, wr, wr_shift))                 return (uint32_t)0b01001010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
+        if (pattern3(xr, xr, xr_shift))                 return (uint32_t)0b11001010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
+        // AdvSIMD three same (logical)
+        if (pattern3(vreg_b, vsame, vsame))             return (uint32_t)0b00101110001000000001110000000000 | ENCODE_VQ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
     {"eret", [](Operand** operands, int operand_length) {
         if (operand_length == 0)                        return (uint32_t)0b11010110100111110000001111100000;
         unreachable();
@@ -583,30 +1611,603 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (operand_length == 0)                        return (uint32_t)0b11010101000000110010001000011111;
         unreachable();
     }},
+    {"ext", [](Operand** operands, int operand_length) {
+        // AdvSIMD extract
+        if (pattern4(vreg_b, vsame, vsame, imm))        return (uint32_t)0b00101110000000000000000000000000 | ENCODE_VQ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_EXT_IMM(3, 0);
+        unreachable();
+    }},
     {"extr", [](Operand** operands, int operand_length) {
         if (pattern4(wr, wr, wr, imm))                  return (uint32_t)0b00010011100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_IMM6(3, 10); // #18
         if (pattern4(wr, wr, wr, imm))                  return (uint32_t)0b10010011110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_IMM6(3, 10); // #18
         unreachable();
     }},
-    {"hint", [](Operand** operands, int operand_length) {
-        if (pattern1(imm))                              return (uint32_t)0b11010101000000110010000000011111 | ENCODE_IMM7(0, 5);
+    {"fabd", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (floating-point)
+        if (pattern3(vreg_sd, vsame, vsame))            return (uint32_t)0b00101110101000001101010000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // AdvSIMD scalar three same (floating-point)
+        if (pattern3(hr, hr, hr))                       return (uint32_t)0b01111110110000000001010000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(sr, sr, sr))                       return (uint32_t)0b01111110101000001101010000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(dr, dr, dr))                       return (uint32_t)0b01111110111000001101010000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
         unreachable();
     }},
-    {"hlt", [](Operand** operands, int operand_length) {
-        if (pattern1(imm))                              return (uint32_t)0b11010100010000000000000000000000 | ENCODE_IMM16(0, 5); // #17
+    {"fabs", [](Operand** operands, int operand_length) {
+        // AdvSIMD two-register misc (floating-point)
+        if (pattern2(vreg_sd, vsame))                   return (uint32_t)0b00001110101000001111100000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // floating-point data-processing (1 source)
+        if (pattern2(hr, hr))                           return (uint32_t)0b00011110111000001100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, sr))                           return (uint32_t)0b00011110001000001100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, dr))                           return (uint32_t)0b00011110011000001100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
         unreachable();
     }},
-    {"hvc", [](Operand** operands, int operand_length) {
-        if (pattern1(imm))                              return (uint32_t)0b11010100000000000000000000000010 | ENCODE_IMM16(0, 5); // #17
+    {"fadd", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (floating-point)
+        if (pattern3(vreg_sd, vsame, vsame))            return (uint32_t)0b00001110001000001101010000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // floating-point data-processing (2 source)
+        if (pattern3(hr, hr, hr))                       return (uint32_t)0b00011110111000000010100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(sr, sr, sr))                       return (uint32_t)0b00011110001000000010100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(dr, dr, dr))                       return (uint32_t)0b00011110011000000010100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // SVE floating-point arithmetic (unpredicated)
+        if (pattern3(zreg_hsd, zsame, zsame))           return (uint32_t)0b01100101000000000000000000000000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
         unreachable();
     }},
-    {"ldadd", [](Operand** operands, int operand_length) {
-        if (pattern3(wr, wr, mem_op_base))              return (uint32_t)0b10111000001000000000000000000000 | ENCODE_REGI(0, 16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
-        if (pattern3(xr, xr, mem_op_base))              return (uint32_t)0b11111000001000000000000000000000 | ENCODE_REGI(0, 16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
+    {"faddp", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (floating-point)
+        if (pattern3(vreg_sd, vsame, vsame))            return (uint32_t)0b00101110001000001101010000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
         unreachable();
     }},
-    {"ldadda", [](Operand** operands, int operand_length) {
-        if (pattern3(wr, wr, mem_op_base))              return (uint32_t)0b10111000101000000000000000000000 | ENCODE_REGI(0, 16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
+    {"faddv", [](Operand** operands, int operand_length) {
+        // SVE floating-point recursive reduction
+        if (pattern3(hr, pg, zreg_h))                   return (uint32_t)0b01100101010000000010000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_REGI(2, 5);
+        if (pattern3(sr, pg, zreg_s))                   return (uint32_t)0b01100101100000000010000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_REGI(2, 5);
+        if (pattern3(dr, pg, zreg_d))                   return (uint32_t)0b01100101110000000010000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_REGI(2, 5);
+        unreachable();
+    }},
+    {"fccmp", [](Operand** operands, int operand_length) {
+        // floating-point conditional compare
+        if (pattern4(hr, hr, imm, cond))                return (uint32_t)0b00011110111000000000010000000000 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16) | ENCODE_IMM4(2, 0) | ENCODE_COND(3, 12);
+        if (pattern4(sr, sr, imm, cond))                return (uint32_t)0b00011110001000000000010000000000 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16) | ENCODE_IMM4(2, 0) | ENCODE_COND(3, 12);
+        if (pattern4(dr, dr, imm, cond))                return (uint32_t)0b00011110011000000000010000000000 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16) | ENCODE_IMM4(2, 0) | ENCODE_COND(3, 12);
+        unreachable();
+    }},
+    {"fccmpe", [](Operand** operands, int operand_length) {
+        // floating-point conditional compare
+        if (pattern4(hr, hr, imm, cond))                return (uint32_t)0b00011110111000000000010000010000 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16) | ENCODE_IMM4(2, 0) | ENCODE_COND(3, 12);
+        if (pattern4(sr, sr, imm, cond))                return (uint32_t)0b00011110001000000000010000010000 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16) | ENCODE_IMM4(2, 0) | ENCODE_COND(3, 12);
+        if (pattern4(dr, dr, imm, cond))                return (uint32_t)0b00011110011000000000010000010000 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16) | ENCODE_IMM4(2, 0) | ENCODE_COND(3, 12);
+        unreachable();
+    }},
+    {"fcmeq", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (floating-point)
+        if (pattern3(vreg_sd, vsame, vsame))            return (uint32_t)0b00001110001000001110010000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"fcmge", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (floating-point)
+        if (pattern3(vreg_sd, vsame, vsame))            return (uint32_t)0b00101110001000001110010000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"fcmgt", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (floating-point)
+        if (pattern3(vreg_sd, vsame, vsame))            return (uint32_t)0b00101110101000001110010000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"fcmp", [](Operand** operands, int operand_length) {
+        // floating-point compare
+        if (pattern2(hr, fp_zero))                      return (uint32_t)0b00011110111000000010000000001000 | ENCODE_REGI(0, 5);
+        if (pattern2(sr, fp_zero))                      return (uint32_t)0b00011110001000000010000000001000 | ENCODE_REGI(0, 5);
+        if (pattern2(dr, fp_zero))                      return (uint32_t)0b00011110011000000010000000001000 | ENCODE_REGI(0, 5);
+        if (pattern2(hr, hr))                           return (uint32_t)0b00011110111000000010000000000000 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16);
+        if (pattern2(sr, sr))                           return (uint32_t)0b00011110001000000010000000000000 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16);
+        if (pattern2(dr, dr))                           return (uint32_t)0b00011110011000000010000000000000 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16);
+        unreachable();
+    }},
+    {"fcmpe", [](Operand** operands, int operand_length) {
+        // floating-point compare
+        if (pattern2(hr, fp_zero))                      return (uint32_t)0b00011110111000000010000000011000 | ENCODE_REGI(0, 5);
+        if (pattern2(sr, fp_zero))                      return (uint32_t)0b00011110001000000010000000011000 | ENCODE_REGI(0, 5);
+        if (pattern2(dr, fp_zero))                      return (uint32_t)0b00011110011000000010000000011000 | ENCODE_REGI(0, 5);
+        if (pattern2(hr, hr))                           return (uint32_t)0b00011110111000000010000000010000 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16);
+        if (pattern2(sr, sr))                           return (uint32_t)0b00011110001000000010000000010000 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16);
+        if (pattern2(dr, dr))                           return (uint32_t)0b00011110011000000010000000010000 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16);
+        unreachable();
+    }},
+    {"fcsel", [](Operand** operands, int operand_length) {
+        // floating-point conditional select
+        if (pattern4(hr, hr, hr, cond))                 return (uint32_t)0b00011110111000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_COND(3, 12);
+        if (pattern4(sr, sr, sr, cond))                 return (uint32_t)0b00011110001000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_COND(3, 12);
+        if (pattern4(dr, dr, dr, cond))                 return (uint32_t)0b00011110011000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_COND(3, 12);
+        unreachable();
+    }},
+    {"fcvt", [](Operand** operands, int operand_length) {
+        // floating-point data-processing (1 source)
+        if (pattern2(sr, hr))                           return (uint32_t)0b00011110111000100100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, hr))                           return (uint32_t)0b00011110111000101100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(hr, sr))                           return (uint32_t)0b00011110001000111100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, sr))                           return (uint32_t)0b00011110001000101100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(hr, dr))                           return (uint32_t)0b00011110011000111100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, dr))                           return (uint32_t)0b00011110011000100100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"fcvtas", [](Operand** operands, int operand_length) {
+        // conversion between floating-point and integer
+        if (pattern2(wr, hr))                           return (uint32_t)0b00011110111001000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, sr))                           return (uint32_t)0b00011110001001000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, dr))                           return (uint32_t)0b00011110011001000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, hr))                           return (uint32_t)0b10011110111001000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, sr))                           return (uint32_t)0b10011110001001000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, dr))                           return (uint32_t)0b10011110011001000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"fcvtau", [](Operand** operands, int operand_length) {
+        // conversion between floating-point and integer
+        if (pattern2(wr, hr))                           return (uint32_t)0b00011110111001010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, sr))                           return (uint32_t)0b00011110001001010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, dr))                           return (uint32_t)0b00011110011001010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, hr))                           return (uint32_t)0b10011110111001010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, sr))                           return (uint32_t)0b10011110001001010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, dr))                           return (uint32_t)0b10011110011001010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"fcvtms", [](Operand** operands, int operand_length) {
+        // conversion between floating-point and integer
+        if (pattern2(wr, hr))                           return (uint32_t)0b00011110111100000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, sr))                           return (uint32_t)0b00011110001100000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, dr))                           return (uint32_t)0b00011110011100000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, hr))                           return (uint32_t)0b10011110111100000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, sr))                           return (uint32_t)0b10011110001100000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, dr))                           return (uint32_t)0b10011110011100000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"fcvtmu", [](Operand** operands, int operand_length) {
+        // conversion between floating-point and integer
+        if (pattern2(wr, hr))                           return (uint32_t)0b00011110111100010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, sr))                           return (uint32_t)0b00011110001100010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, dr))                           return (uint32_t)0b00011110011100010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, hr))                           return (uint32_t)0b10011110111100010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, sr))                           return (uint32_t)0b10011110001100010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, dr))                           return (uint32_t)0b10011110011100010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"fcvtns", [](Operand** operands, int operand_length) {
+        // conversion between floating-point and integer
+        if (pattern2(wr, hr))                           return (uint32_t)0b00011110111000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, sr))                           return (uint32_t)0b00011110001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, dr))                           return (uint32_t)0b00011110011000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, hr))                           return (uint32_t)0b10011110111000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, sr))                           return (uint32_t)0b10011110001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, dr))                           return (uint32_t)0b10011110011000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"fcvtnu", [](Operand** operands, int operand_length) {
+        // conversion between floating-point and integer
+        if (pattern2(wr, hr))                           return (uint32_t)0b00011110111000010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, sr))                           return (uint32_t)0b00011110001000010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, dr))                           return (uint32_t)0b00011110011000010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, hr))                           return (uint32_t)0b10011110111000010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, sr))                           return (uint32_t)0b10011110001000010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, dr))                           return (uint32_t)0b10011110011000010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"fcvtps", [](Operand** operands, int operand_length) {
+        // conversion between floating-point and integer
+        if (pattern2(wr, hr))                           return (uint32_t)0b00011110111010000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, sr))                           return (uint32_t)0b00011110001010000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, dr))                           return (uint32_t)0b00011110011010000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, hr))                           return (uint32_t)0b10011110111010000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, sr))                           return (uint32_t)0b10011110001010000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, dr))                           return (uint32_t)0b10011110011010000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"fcvtpu", [](Operand** operands, int operand_length) {
+        // conversion between floating-point and integer
+        if (pattern2(wr, hr))                           return (uint32_t)0b00011110111010010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, sr))                           return (uint32_t)0b00011110001010010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, dr))                           return (uint32_t)0b00011110011010010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, hr))                           return (uint32_t)0b10011110111010010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, sr))                           return (uint32_t)0b10011110001010010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, dr))                           return (uint32_t)0b10011110011010010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"fcvtzs", [](Operand** operands, int operand_length) {
+        // AdvSIMD two-register misc (floating-point)
+        if (pattern2(vreg_sd, vsame))                   return (uint32_t)0b00001110101000011011100000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // conversion between floating-point and fixed-point
+        if (pattern3(wr, hr, imm))                      return (uint32_t)0b00011110110110000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(0, 2);
+        if (pattern3(wr, sr, imm))                      return (uint32_t)0b00011110000110000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(0, 2);
+        if (pattern3(wr, dr, imm))                      return (uint32_t)0b00011110010110000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(0, 2);
+        if (pattern3(xr, hr, imm))                      return (uint32_t)0b10011110110110000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(0, 2);
+        if (pattern3(xr, sr, imm))                      return (uint32_t)0b10011110000110000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(0, 2);
+        if (pattern3(xr, dr, imm))                      return (uint32_t)0b10011110010110000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(0, 2);
+        // conversion between floating-point and integer
+        if (pattern2(wr, hr))                           return (uint32_t)0b00011110111110000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, sr))                           return (uint32_t)0b00011110001110000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, dr))                           return (uint32_t)0b00011110011110000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, hr))                           return (uint32_t)0b10011110111110000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, sr))                           return (uint32_t)0b10011110001110000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, dr))                           return (uint32_t)0b10011110011110000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"fcvtzu", [](Operand** operands, int operand_length) {
+        // AdvSIMD two-register misc (floating-point)
+        if (pattern2(vreg_sd, vsame))                   return (uint32_t)0b00101110101000011011100000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // conversion between floating-point and fixed-point
+        if (pattern3(wr, hr, imm))                      return (uint32_t)0b00011110110110010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(0, 2);
+        if (pattern3(wr, sr, imm))                      return (uint32_t)0b00011110000110010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(0, 2);
+        if (pattern3(wr, dr, imm))                      return (uint32_t)0b00011110010110010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(0, 2);
+        if (pattern3(xr, hr, imm))                      return (uint32_t)0b10011110110110010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(0, 2);
+        if (pattern3(xr, sr, imm))                      return (uint32_t)0b10011110000110010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(0, 2);
+        if (pattern3(xr, dr, imm))                      return (uint32_t)0b10011110010110010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(0, 2);
+        // conversion between floating-point and integer
+        if (pattern2(wr, hr))                           return (uint32_t)0b00011110111110010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, sr))                           return (uint32_t)0b00011110001110010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, dr))                           return (uint32_t)0b00011110011110010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, hr))                           return (uint32_t)0b10011110111110010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, sr))                           return (uint32_t)0b10011110001110010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, dr))                           return (uint32_t)0b10011110011110010000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"fdiv", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (floating-point)
+        if (pattern3(vreg_sd, vsame, vsame))            return (uint32_t)0b00101110001000001111110000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // floating-point data-processing (2 source)
+        if (pattern3(hr, hr, hr))                       return (uint32_t)0b00011110111000000001100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(sr, sr, sr))                       return (uint32_t)0b00011110001000000001100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(dr, dr, dr))                       return (uint32_t)0b00011110011000000001100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"fdup", [](Operand** operands, int operand_length) {
+        // SVE broadcast floating-point immediate
+        if (pattern2(zreg_hsd, fp8_imm))                return (uint32_t)0b00100101001110011100000000000000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_FP8_IMM(1, 5);
+        unreachable();
+    }},
+    {"fmadd", [](Operand** operands, int operand_length) {
+        // floating-point data-processing (3 source)
+        if (pattern4(hr, hr, hr, hr))                   return (uint32_t)0b00011111110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10);
+        if (pattern4(sr, sr, sr, sr))                   return (uint32_t)0b00011111000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10);
+        if (pattern4(dr, dr, dr, dr))                   return (uint32_t)0b00011111010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10);
+        unreachable();
+    }},
+    {"fmax", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (floating-point)
+        if (pattern3(vreg_sd, vsame, vsame))            return (uint32_t)0b00001110001000001111010000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // floating-point data-processing (2 source)
+        if (pattern3(hr, hr, hr))                       return (uint32_t)0b00011110111000000100100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(sr, sr, sr))                       return (uint32_t)0b00011110001000000100100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(dr, dr, dr))                       return (uint32_t)0b00011110011000000100100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"fmaxnm", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (floating-point)
+        if (pattern3(vreg_sd, vsame, vsame))            return (uint32_t)0b00001110001000001100010000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // floating-point data-processing (2 source)
+        if (pattern3(hr, hr, hr))                       return (uint32_t)0b00011110111000000110100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(sr, sr, sr))                       return (uint32_t)0b00011110001000000110100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(dr, dr, dr))                       return (uint32_t)0b00011110011000000110100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"fmin", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (floating-point)
+        if (pattern3(vreg_sd, vsame, vsame))            return (uint32_t)0b00001110101000001111010000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // floating-point data-processing (2 source)
+        if (pattern3(hr, hr, hr))                       return (uint32_t)0b00011110111000000101100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(sr, sr, sr))                       return (uint32_t)0b00011110001000000101100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(dr, dr, dr))                       return (uint32_t)0b00011110011000000101100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"fminnm", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (floating-point)
+        if (pattern3(vreg_sd, vsame, vsame))            return (uint32_t)0b00001110101000001100010000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // floating-point data-processing (2 source)
+        if (pattern3(hr, hr, hr))                       return (uint32_t)0b00011110111000000111100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(sr, sr, sr))                       return (uint32_t)0b00011110001000000111100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(dr, dr, dr))                       return (uint32_t)0b00011110011000000111100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"fmla", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (floating-point)
+        if (pattern3(vreg_sd, vsame, vsame))            return (uint32_t)0b00001110001000001100110000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // AdvSIMD vector x indexed element
+        if (pattern3(vreg_sd, vsame, velem_sd))         return (uint32_t)0b00001111100000000001000000000000 | ENCODE_VQ(0) | ENCODE_ELEM_FP(2) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // AdvSIMD scalar x indexed element
+        if (pattern3(sr, sr, velem_s))                  return (uint32_t)0b01011111100000000001000000000000 | ENCODE_ELEM_FP(2) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern3(dr, dr, velem_d))                  return (uint32_t)0b01011111100000000001000000000000 | ENCODE_ELEM_FP(2) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // SVE floating-point multiply-add
+        if (pattern4(zreg_hsd, pg_m, zsame, zsame))     return (uint32_t)0b01100101001000000000000000000000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_REGI(2, 5) | ENCODE_REGI(3, 16);
+        unreachable();
+    }},
+    {"fmls", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (floating-point)
+        if (pattern3(vreg_sd, vsame, vsame))            return (uint32_t)0b00001110101000001100110000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // AdvSIMD vector x indexed element
+        if (pattern3(vreg_sd, vsame, velem_sd))         return (uint32_t)0b00001111100000000101000000000000 | ENCODE_VQ(0) | ENCODE_ELEM_FP(2) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // AdvSIMD scalar x indexed element
+        if (pattern3(sr, sr, velem_s))                  return (uint32_t)0b01011111100000000101000000000000 | ENCODE_ELEM_FP(2) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern3(dr, dr, velem_d))                  return (uint32_t)0b01011111100000000101000000000000 | ENCODE_ELEM_FP(2) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // SVE floating-point multiply-add
+        if (pattern4(zreg_hsd, pg_m, zsame, zsame))     return (uint32_t)0b01100101001000000010000000000000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_REGI(2, 5) | ENCODE_REGI(3, 16);
+        unreachable();
+    }},
+    {"fmov", [](Operand** operands, int operand_length) {
+        // FMOV (register)
+        if (pattern2(hr, hr))                           return (uint32_t)0b00011110111000000100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, sr))                           return (uint32_t)0b00011110001000000100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, dr))                           return (uint32_t)0b00011110011000000100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // FMOV (scalar, immediate)
+        if (pattern2(hr, fp8_imm))                      return (uint32_t)0b00011110111000000001000000000000 | ENCODE_REGI(0, 0) | ENCODE_FP8_IMM(1, 13);
+        if (pattern2(sr, fp8_imm))                      return (uint32_t)0b00011110001000000001000000000000 | ENCODE_REGI(0, 0) | ENCODE_FP8_IMM(1, 13);
+        if (pattern2(dr, fp8_imm))                      return (uint32_t)0b00011110011000000001000000000000 | ENCODE_REGI(0, 0) | ENCODE_FP8_IMM(1, 13);
+        // FMOV (general)
+        if (pattern2(wr, hr))                           return (uint32_t)0b00011110111001100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, hr))                           return (uint32_t)0b10011110111001100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(hr, wr))                           return (uint32_t)0b00011110111001110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(hr, xr))                           return (uint32_t)0b10011110111001110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(wr, sr))                           return (uint32_t)0b00011110001001100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, wr))                           return (uint32_t)0b00011110001001110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, dr))                           return (uint32_t)0b10011110011001100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, xr))                           return (uint32_t)0b10011110011001110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, velem_d))                      return (uint32_t)0b10011110101011100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(velem_d, xr))                      return (uint32_t)0b10011110101011110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // FMOV (immediate, unpredicated): FDUP
+        if (pattern2(zreg_hsd, fp8_imm))                return (uint32_t)0b00100101001110011100000000000000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_FP8_IMM(1, 5);
+        unreachable();
+    }},
+    {"fmsub", [](Operand** operands, int operand_length) {
+        // floating-point data-processing (3 source)
+        if (pattern4(hr, hr, hr, hr))                   return (uint32_t)0b00011111110000001000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10);
+        if (pattern4(sr, sr, sr, sr))                   return (uint32_t)0b00011111000000001000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10);
+        if (pattern4(dr, dr, dr, dr))                   return (uint32_t)0b00011111010000001000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10);
+        unreachable();
+    }},
+    {"fmul", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (floating-point)
+        if (pattern3(vreg_sd, vsame, vsame))            return (uint32_t)0b00101110001000001101110000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // AdvSIMD vector x indexed element
+        if (pattern3(vreg_sd, vsame, velem_sd))         return (uint32_t)0b00001111100000001001000000000000 | ENCODE_VQ(0) | ENCODE_ELEM_FP(2) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // AdvSIMD scalar x indexed element
+        if (pattern3(sr, sr, velem_s))                  return (uint32_t)0b01011111100000001001000000000000 | ENCODE_ELEM_FP(2) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern3(dr, dr, velem_d))                  return (uint32_t)0b01011111100000001001000000000000 | ENCODE_ELEM_FP(2) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // floating-point data-processing (2 source)
+        if (pattern3(hr, hr, hr))                       return (uint32_t)0b00011110111000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(sr, sr, sr))                       return (uint32_t)0b00011110001000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(dr, dr, dr))                       return (uint32_t)0b00011110011000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // SVE floating-point arithmetic (unpredicated)
+        if (pattern3(zreg_hsd, zsame, zsame))           return (uint32_t)0b01100101000000000000100000000000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"fneg", [](Operand** operands, int operand_length) {
+        // AdvSIMD two-register misc (floating-point)
+        if (pattern2(vreg_sd, vsame))                   return (uint32_t)0b00101110101000001111100000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // floating-point data-processing (1 source)
+        if (pattern2(hr, hr))                           return (uint32_t)0b00011110111000010100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, sr))                           return (uint32_t)0b00011110001000010100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, dr))                           return (uint32_t)0b00011110011000010100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"fnmadd", [](Operand** operands, int operand_length) {
+        // floating-point data-processing (3 source)
+        if (pattern4(hr, hr, hr, hr))                   return (uint32_t)0b00011111111000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10);
+        if (pattern4(sr, sr, sr, sr))                   return (uint32_t)0b00011111001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10);
+        if (pattern4(dr, dr, dr, dr))                   return (uint32_t)0b00011111011000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10);
+        unreachable();
+    }},
+    {"fnmsub", [](Operand** operands, int operand_length) {
+        // floating-point data-processing (3 source)
+        if (pattern4(hr, hr, hr, hr))                   return (uint32_t)0b00011111111000001000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10);
+        if (pattern4(sr, sr, sr, sr))                   return (uint32_t)0b00011111001000001000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10);
+        if (pattern4(dr, dr, dr, dr))                   return (uint32_t)0b00011111011000001000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10);
+        unreachable();
+    }},
+    {"fnmul", [](Operand** operands, int operand_length) {
+        // floating-point data-processing (2 source)
+        if (pattern3(hr, hr, hr))                       return (uint32_t)0b00011110111000001000100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(sr, sr, sr))                       return (uint32_t)0b00011110001000001000100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(dr, dr, dr))                       return (uint32_t)0b00011110011000001000100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"frinta", [](Operand** operands, int operand_length) {
+        // floating-point data-processing (1 source)
+        if (pattern2(hr, hr))                           return (uint32_t)0b00011110111001100100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, sr))                           return (uint32_t)0b00011110001001100100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, dr))                           return (uint32_t)0b00011110011001100100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"frinti", [](Operand** operands, int operand_length) {
+        // floating-point data-processing (1 source)
+        if (pattern2(hr, hr))                           return (uint32_t)0b00011110111001111100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, sr))                           return (uint32_t)0b00011110001001111100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, dr))                           return (uint32_t)0b00011110011001111100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"frintm", [](Operand** operands, int operand_length) {
+        // floating-point data-processing (1 source)
+        if (pattern2(hr, hr))                           return (uint32_t)0b00011110111001010100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, sr))                           return (uint32_t)0b00011110001001010100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, dr))                           return (uint32_t)0b00011110011001010100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"frintn", [](Operand** operands, int operand_length) {
+        // floating-point data-processing (1 source)
+        if (pattern2(hr, hr))                           return (uint32_t)0b00011110111001000100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, sr))                           return (uint32_t)0b00011110001001000100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, dr))                           return (uint32_t)0b00011110011001000100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"frintp", [](Operand** operands, int operand_length) {
+        // floating-point data-processing (1 source)
+        if (pattern2(hr, hr))                           return (uint32_t)0b00011110111001001100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, sr))                           return (uint32_t)0b00011110001001001100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, dr))                           return (uint32_t)0b00011110011001001100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"frintx", [](Operand** operands, int operand_length) {
+        // floating-point data-processing (1 source)
+        if (pattern2(hr, hr))                           return (uint32_t)0b00011110111001110100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, sr))                           return (uint32_t)0b00011110001001110100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, dr))                           return (uint32_t)0b00011110011001110100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"frintz", [](Operand** operands, int operand_length) {
+        // floating-point data-processing (1 source)
+        if (pattern2(hr, hr))                           return (uint32_t)0b00011110111001011100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, sr))                           return (uint32_t)0b00011110001001011100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, dr))                           return (uint32_t)0b00011110011001011100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"fsqrt", [](Operand** operands, int operand_length) {
+        // AdvSIMD two-register misc (floating-point)
+        if (pattern2(vreg_sd, vsame))                   return (uint32_t)0b00101110101000011111100000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // floating-point data-processing (1 source)
+        if (pattern2(hr, hr))                           return (uint32_t)0b00011110111000011100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, sr))                           return (uint32_t)0b00011110001000011100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, dr))                           return (uint32_t)0b00011110011000011100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"fsub", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same (floating-point)
+        if (pattern3(vreg_sd, vsame, vsame))            return (uint32_t)0b00001110101000001101010000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // floating-point data-processing (2 source)
+        if (pattern3(hr, hr, hr))                       return (uint32_t)0b00011110111000000011100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(sr, sr, sr))                       return (uint32_t)0b00011110001000000011100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(dr, dr, dr))                       return (uint32_t)0b00011110011000000011100000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // SVE floating-point arithmetic (unpredicated)
+        if (pattern3(zreg_hsd, zsame, zsame))           return (uint32_t)0b01100101000000000000010000000000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"hint", [](Operand** operands, int operand_length) {
+        if (pattern1(imm))                              return (uint32_t)0b11010101000000110010000000011111 | ENCODE_IMM7(0, 5);
+        unreachable();
+    }},
+    {"hlt", [](Operand** operands, int operand_length) {
+        if (pattern1(imm))                              return (uint32_t)0b11010100010000000000000000000000 | ENCODE_IMM16(0, 5); // #17
+        unreachable();
+    }},
+    {"hvc", [](Operand** operands, int operand_length) {
+        if (pattern1(imm))                              return (uint32_t)0b11010100000000000000000000000010 | ENCODE_IMM16(0, 5); // #17
+        unreachable();
+    }},
+    {"ic", [](Operand** operands, int operand_length) {
+        // IC: SYS #op1, C7, Cm, #op2{, Xt}
+        if (pattern2(ic_op, xr))                        return (uint32_t)0b11010101000010000000000000000000 | ENCODE_VAL(0, 0) | ENCODE_REGI(1, 0);
+        if (pattern1(ic_op))                            return (uint32_t)0b11010101000010000000000000011111 | ENCODE_VAL(0, 0);
+        unreachable();
+    }},
+    {"incb", [](Operand** operands, int operand_length) {
+        // SVE element count
+        if (pattern3(xr, sve_pattern, sve_mul))         return (uint32_t)0b00000100001100001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1) | ENCODE_SVE_MUL(2);
+        if (pattern2(xr, sve_pattern))                  return (uint32_t)0b00000100001100001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1);
+        if (pattern1(xr))                               return (uint32_t)0b00000100001100001110001111100000 | ENCODE_REGI(0, 0);
+        unreachable();
+    }},
+    {"incd", [](Operand** operands, int operand_length) {
+        // SVE element count
+        if (pattern3(xr, sve_pattern, sve_mul))         return (uint32_t)0b00000100111100001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1) | ENCODE_SVE_MUL(2);
+        if (pattern2(xr, sve_pattern))                  return (uint32_t)0b00000100111100001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1);
+        if (pattern1(xr))                               return (uint32_t)0b00000100111100001110001111100000 | ENCODE_REGI(0, 0);
+        unreachable();
+    }},
+    {"inch", [](Operand** operands, int operand_length) {
+        // SVE element count
+        if (pattern3(xr, sve_pattern, sve_mul))         return (uint32_t)0b00000100011100001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1) | ENCODE_SVE_MUL(2);
+        if (pattern2(xr, sve_pattern))                  return (uint32_t)0b00000100011100001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1);
+        if (pattern1(xr))                               return (uint32_t)0b00000100011100001110001111100000 | ENCODE_REGI(0, 0);
+        unreachable();
+    }},
+    {"incw", [](Operand** operands, int operand_length) {
+        // SVE element count
+        if (pattern3(xr, sve_pattern, sve_mul))         return (uint32_t)0b00000100101100001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1) | ENCODE_SVE_MUL(2);
+        if (pattern2(xr, sve_pattern))                  return (uint32_t)0b00000100101100001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1);
+        if (pattern1(xr))                               return (uint32_t)0b00000100101100001110001111100000 | ENCODE_REGI(0, 0);
+        unreachable();
+    }},
+    {"ins", [](Operand** operands, int operand_length) {
+        // AdvSIMD copy
+        if (pattern2(velem, velem))                     return (uint32_t)0b01101110000000000000010000000000 | ENCODE_ELEM_IMM5(0) | ENCODE_ELEM_IMM4(1) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(velem_bhs, wr))                    return (uint32_t)0b01001110000000000001110000000000 | ENCODE_ELEM_IMM5(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(velem_d, xr))                      return (uint32_t)0b01001110000000000001110000000000 | ENCODE_ELEM_IMM5(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"isb", [](Operand** operands, int operand_length) {
+        if (pattern1(imm))                              return (uint32_t)0b11010101000000110011000011011111 | ENCODE_IMM4(0, 8);
+        if (pattern1(barrier_opt))                      return (uint32_t)0b11010101000000110011000011011111 | ENCODE_VAL(0, 8);
+        if (operand_length == 0)                        return (uint32_t)0b11010101000000110011111111011111;
+        unreachable();
+    }},
+    {"ld1", [](Operand** operands, int operand_length) {
+        // AdvSIMD load/store multiple structures
+        if (pattern3(vlist1, mem_op_base, xr))          return (uint32_t)0b00001100110000000111000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(vlist1, mem_op_base, imm))         return (uint32_t)0b00001100110111110111000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_VLIST_POST_IMM(0, 2);
+        if (pattern3(vlist2, mem_op_base, xr))          return (uint32_t)0b00001100110000001010000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(vlist2, mem_op_base, imm))         return (uint32_t)0b00001100110111111010000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_VLIST_POST_IMM(0, 2);
+        if (pattern3(vlist3, mem_op_base, xr))          return (uint32_t)0b00001100110000000110000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(vlist3, mem_op_base, imm))         return (uint32_t)0b00001100110111110110000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_VLIST_POST_IMM(0, 2);
+        if (pattern3(vlist4, mem_op_base, xr))          return (uint32_t)0b00001100110000000010000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(vlist4, mem_op_base, imm))         return (uint32_t)0b00001100110111110010000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_VLIST_POST_IMM(0, 2);
+        if (pattern2(vlist1, mem_op_base))              return (uint32_t)0b00001100010000000111000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        if (pattern2(vlist2, mem_op_base))              return (uint32_t)0b00001100010000001010000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        if (pattern2(vlist3, mem_op_base))              return (uint32_t)0b00001100010000000110000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        if (pattern2(vlist4, mem_op_base))              return (uint32_t)0b00001100010000000010000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        unreachable();
+    }},
+    {"ld1b", [](Operand** operands, int operand_length) {
+        // SVE contiguous load (scalar plus scalar)
+        if (pattern3(zlist_b, pg_z, mem_op_regi_lsl0))  return (uint32_t)0b10100100000000000100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_REGI_LSL(2, 5, 16);
+        // SVE contiguous load (scalar plus immediate)
+        if (pattern3(zlist_b, pg_z, mem_op_vl_offset))  return (uint32_t)0b10100100000000001010000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_VL_OFFSET(2, 5, 16);
+        if (pattern3(zlist_b, pg_z, mem_op_base))       return (uint32_t)0b10100100000000001010000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_BASE(2, 5);
+        unreachable();
+    }},
+    {"ld1d", [](Operand** operands, int operand_length) {
+        // SVE contiguous load (scalar plus scalar)
+        if (pattern3(zlist_d, pg_z, mem_op_regi_lsl3))  return (uint32_t)0b10100101111000000100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_REGI_LSL(2, 5, 16);
+        // SVE contiguous load (scalar plus immediate)
+        if (pattern3(zlist_d, pg_z, mem_op_vl_offset))  return (uint32_t)0b10100101111000001010000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_VL_OFFSET(2, 5, 16);
+        if (pattern3(zlist_d, pg_z, mem_op_base))       return (uint32_t)0b10100101111000001010000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_BASE(2, 5);
+        unreachable();
+    }},
+    {"ld1h", [](Operand** operands, int operand_length) {
+        // SVE contiguous load (scalar plus scalar)
+        if (pattern3(zlist_h, pg_z, mem_op_regi_lsl1))  return (uint32_t)0b10100100101000000100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_REGI_LSL(2, 5, 16);
+        // SVE contiguous load (scalar plus immediate)
+        if (pattern3(zlist_h, pg_z, mem_op_vl_offset))  return (uint32_t)0b10100100101000001010000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_VL_OFFSET(2, 5, 16);
+        if (pattern3(zlist_h, pg_z, mem_op_base))       return (uint32_t)0b10100100101000001010000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_BASE(2, 5);
+        unreachable();
+    }},
+    {"ld1w", [](Operand** operands, int operand_length) {
+        // SVE contiguous load (scalar plus scalar)
+        if (pattern3(zlist_s, pg_z, mem_op_regi_lsl2))  return (uint32_t)0b10100101010000000100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_REGI_LSL(2, 5, 16);
+        // SVE contiguous load (scalar plus immediate)
+        if (pattern3(zlist_s, pg_z, mem_op_vl_offset))  return (uint32_t)0b10100101010000001010000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_VL_OFFSET(2, 5, 16);
+        if (pattern3(zlist_s, pg_z, mem_op_base))       return (uint32_t)0b10100101010000001010000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_BASE(2, 5);
+        unreachable();
+    }},
+    {"ld2", [](Operand** operands, int operand_length) {
+        // AdvSIMD load/store multiple structures
+        if (pattern3(vlist2, mem_op_base, xr))          return (uint32_t)0b00001100110000001000000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(vlist2, mem_op_base, imm))         return (uint32_t)0b00001100110111111000000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_VLIST_POST_IMM(0, 2);
+        if (pattern2(vlist2, mem_op_base))              return (uint32_t)0b00001100010000001000000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        unreachable();
+    }},
+    {"ld3", [](Operand** operands, int operand_length) {
+        // AdvSIMD load/store multiple structures
+        if (pattern3(vlist3, mem_op_base, xr))          return (uint32_t)0b00001100110000000100000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(vlist3, mem_op_base, imm))         return (uint32_t)0b00001100110111110100000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_VLIST_POST_IMM(0, 2);
+        if (pattern2(vlist3, mem_op_base))              return (uint32_t)0b00001100010000000100000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        unreachable();
+    }},
+    {"ld4", [](Operand** operands, int operand_length) {
+        // AdvSIMD load/store multiple structures
+        if (pattern3(vlist4, mem_op_base, xr))          return (uint32_t)0b00001100110000000000000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(vlist4, mem_op_base, imm))         return (uint32_t)0b00001100110111110000000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_VLIST_POST_IMM(0, 2);
+        if (pattern2(vlist4, mem_op_base))              return (uint32_t)0b00001100010000000000000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        unreachable();
+    }},
+    {"ldadd", [](Operand** operands, int operand_length) {
+        if (pattern3(wr, wr, mem_op_base))              return (uint32_t)0b10111000001000000000000000000000 | ENCODE_REGI(0, 16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
+        if (pattern3(xr, xr, mem_op_base))              return (uint32_t)0b11111000001000000000000000000000 | ENCODE_REGI(0, 16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
+        unreachable();
+    }},
+    {"ldadda", [](Operand** operands, int operand_length) {
+        if (pattern3(wr, wr, mem_op_base))              return (uint32_t)0b10111000101000000000000000000000 | ENCODE_REGI(0, 16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
         if (pattern3(xr, xr, mem_op_base))              return (uint32_t)0b11111000101000000000000000000000 | ENCODE_REGI(0, 16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
         unreachable();
     }},
@@ -843,6 +2444,10 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
     {"ldnp", [](Operand** operands, int operand_length) {
         if (pattern3(wr, wr, mem_op_imm_offset))        return (uint32_t)0b00101000010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 4);
         if (pattern3(xr, xr, mem_op_imm_offset))        return (uint32_t)0b10101000010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 8);
+        // LDNP (SIMD&FP)
+        if (pattern3(sr, sr, mem_op_imm_offset))        return (uint32_t)0b00101100010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 4);
+        if (pattern3(dr, dr, mem_op_imm_offset))        return (uint32_t)0b01101100010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 8);
+        if (pattern3(qr, qr, mem_op_imm_offset))        return (uint32_t)0b10101100010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 16);
         unreachable();
     }},
     {"ldp", [](Operand** operands, int operand_length) {
@@ -852,6 +2457,16 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern3(xr, xr, mem_op_imm_offset_pre))    return (uint32_t)0b10101001110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 8);
         if (pattern3(wr, wr, mem_op_imm_offset))        return (uint32_t)0b00101001010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 4);
         if (pattern3(xr, xr, mem_op_imm_offset))        return (uint32_t)0b10101001010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 8);
+        // LDP (SIMD&FP)
+        if (pattern4(sr, sr, mem_op_base, imm))         return (uint32_t)0b00101100110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_BASE(2, 5) | ENCODE_DIV_IMM7(3, 15, 4);
+        if (pattern4(dr, dr, mem_op_base, imm))         return (uint32_t)0b01101100110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_BASE(2, 5) | ENCODE_DIV_IMM7(3, 15, 8);
+        if (pattern4(qr, qr, mem_op_base, imm))         return (uint32_t)0b10101100110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_BASE(2, 5) | ENCODE_DIV_IMM7(3, 15, 16);
+        if (pattern3(sr, sr, mem_op_imm_offset_pre))    return (uint32_t)0b00101101110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 4);
+        if (pattern3(dr, dr, mem_op_imm_offset_pre))    return (uint32_t)0b01101101110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 8);
+        if (pattern3(qr, qr, mem_op_imm_offset_pre))    return (uint32_t)0b10101101110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 16);
+        if (pattern3(sr, sr, mem_op_imm_offset))        return (uint32_t)0b00101101010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 4);
+        if (pattern3(dr, dr, mem_op_imm_offset))        return (uint32_t)0b01101101010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 8);
+        if (pattern3(qr, qr, mem_op_imm_offset))        return (uint32_t)0b10101101010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 16);
         unreachable();
     }},
     {"ldpsw", [](Operand** operands, int operand_length) {
@@ -862,56 +2477,99 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
     }},
     {"ldr", [](Operand** operands, int operand_length) {
         // LDR (immediate)
-        if (pattern3(wr, mem_op_base, imm))             return (uint32_t)0b10111000010000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_IMM9(2, 12);
-        if (pattern3(xr, mem_op_base, imm))             return (uint32_t)0b11111000010000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_IMM9(2, 12);
+        if (pattern3(wr, mem_op_base, imm))             return (uint32_t)0b10111000010000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern3(xr, mem_op_base, imm))             return (uint32_t)0b11111000010000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
         if (pattern2(wr, mem_op_imm_offset_pre))        return (uint32_t)0b10111000010000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
         if (pattern2(xr, mem_op_imm_offset_pre))        return (uint32_t)0b11111000010000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        // LDUR, for offsets LDR (immediate) can't encode
+        if (pattern2(wr, mem_op_unscaled4))             return (uint32_t)0b10111000010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(xr, mem_op_unscaled8))             return (uint32_t)0b11111000010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
         if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b10111001010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 4);
         if (pattern2(xr, mem_op_imm_offset))            return (uint32_t)0b11111001010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 8);
         if (pattern2(wr, mem_op_regi_offset))           return (uint32_t)0b10111000011000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 2);
         if (pattern2(xr, mem_op_regi_offset))           return (uint32_t)0b11111000011000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 3);
+        // LDR (literal), imm19 is filled in when the literal pool is placed
+        if (pattern2(wr, literal))                      return (uint32_t)0b00011000000000000000000000000000 | ENCODE_REGI(0, 0);
+        if (pattern2(xr, literal))                      return (uint32_t)0b01011000000000000000000000000000 | ENCODE_REGI(0, 0);
+        // LDR (immediate, SIMD&FP)
+        if (pattern3(br, mem_op_base, imm))             return (uint32_t)0b00111100010000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern3(hr, mem_op_base, imm))             return (uint32_t)0b01111100010000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern3(sr, mem_op_base, imm))             return (uint32_t)0b10111100010000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern3(dr, mem_op_base, imm))             return (uint32_t)0b11111100010000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern3(qr, mem_op_base, imm))             return (uint32_t)0b00111100110000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern2(br, mem_op_imm_offset_pre))        return (uint32_t)0b00111100010000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(hr, mem_op_imm_offset_pre))        return (uint32_t)0b01111100010000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(sr, mem_op_imm_offset_pre))        return (uint32_t)0b10111100010000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(dr, mem_op_imm_offset_pre))        return (uint32_t)0b11111100010000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(qr, mem_op_imm_offset_pre))        return (uint32_t)0b00111100110000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        // LDUR (SIMD&FP), for offsets LDR (immediate, SIMD&FP) can't encode
+        if (pattern2(br, mem_op_unscaled1))             return (uint32_t)0b00111100010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(hr, mem_op_unscaled2))             return (uint32_t)0b01111100010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(sr, mem_op_unscaled4))             return (uint32_t)0b10111100010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(dr, mem_op_unscaled8))             return (uint32_t)0b11111100010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(qr, mem_op_unscaled16))            return (uint32_t)0b00111100110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(br, mem_op_imm_offset))            return (uint32_t)0b00111101010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 1);
+        if (pattern2(hr, mem_op_imm_offset))            return (uint32_t)0b01111101010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 2);
+        if (pattern2(sr, mem_op_imm_offset))            return (uint32_t)0b10111101010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 4);
+        if (pattern2(dr, mem_op_imm_offset))            return (uint32_t)0b11111101010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 8);
+        if (pattern2(qr, mem_op_imm_offset))            return (uint32_t)0b00111101110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 16);
+        // LDR (register, SIMD&FP)
+        if (pattern2(br, mem_op_regi_offset))           return (uint32_t)0b00111100011000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 0);
+        if (pattern2(hr, mem_op_regi_offset))           return (uint32_t)0b01111100011000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 1);
+        if (pattern2(sr, mem_op_regi_offset))           return (uint32_t)0b10111100011000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 2);
+        if (pattern2(dr, mem_op_regi_offset))           return (uint32_t)0b11111100011000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 3);
+        if (pattern2(qr, mem_op_regi_offset))           return (uint32_t)0b00111100111000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 4);
+        // LDR (literal, SIMD&FP), imm19 is filled in when the literal pool is placed
+        if (pattern2(sr, literal))                      return (uint32_t)0b00011100000000000000000000000000 | ENCODE_REGI(0, 0);
+        if (pattern2(dr, literal))                      return (uint32_t)0b01011100000000000000000000000000 | ENCODE_REGI(0, 0);
         unreachable();
     }},
     {"ldraa", [](Operand** operands, int operand_length) {
-        if (pattern2(xr, mem_op_imm_offset))            return (uint32_t)0b11111000001000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM9_OFFSET(1, 5, 12, 8);
-        if (pattern2(xr, mem_op_imm_offset_pre))        return (uint32_t)0b11111000001000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM9_OFFSET(1, 5, 12, 8);
+        if (pattern2(xr, mem_op_imm_offset))            return (uint32_t)0b11111000001000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_PAC_OFFSET(1, 5);
+        if (pattern2(xr, mem_op_imm_offset_pre))        return (uint32_t)0b11111000001000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_PAC_OFFSET(1, 5);
         unreachable();
     }},
     {"ldrab", [](Operand** operands, int operand_length) {
-        if (pattern2(xr, mem_op_imm_offset))            return (uint32_t)0b11111000101000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM9_OFFSET(1, 5, 12, 8);
-        if (pattern2(xr, mem_op_imm_offset_pre))        return (uint32_t)0b11111000101000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM9_OFFSET(1, 5, 12, 8);
+        if (pattern2(xr, mem_op_imm_offset))            return (uint32_t)0b11111000101000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_PAC_OFFSET(1, 5);
+        if (pattern2(xr, mem_op_imm_offset_pre))        return (uint32_t)0b11111000101000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_PAC_OFFSET(1, 5);
         unreachable();
     }},
     {"ldrb", [](Operand** operands, int operand_length) {
-        if (pattern3(wr, mem_op_base, imm))             return (uint32_t)0b00111000010000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_IMM9(2, 12);
+        if (pattern3(wr, mem_op_base, imm))             return (uint32_t)0b00111000010000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
         if (pattern2(wr, mem_op_imm_offset_pre))        return (uint32_t)0b00111000010000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(wr, mem_op_unscaled1))             return (uint32_t)0b00111000010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
         if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b00111001010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM12_OFFSET(1, 5, 10);
-        if (pattern2(wr, mem_op_regi_offset))           return (uint32_t)0b00111000011000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 1);
+        if (pattern2(wr, mem_op_regi_offset))           return (uint32_t)0b00111000011000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 0);
         unreachable();
     }},
     {"ldrh", [](Operand** operands, int operand_length) {
-        if (pattern3(wr, mem_op_base, imm))             return (uint32_t)0b01111000010000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_IMM9(2, 12);
+        if (pattern3(wr, mem_op_base, imm))             return (uint32_t)0b01111000010000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
         if (pattern2(wr, mem_op_imm_offset_pre))        return (uint32_t)0b01111000010000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(wr, mem_op_unscaled2))             return (uint32_t)0b01111000010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
         if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b01111001010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 2);
         if (pattern2(wr, mem_op_regi_offset))           return (uint32_t)0b01111000011000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 1);
         unreachable();
     }},
     {"ldrsb", [](Operand** operands, int operand_length) {
-        if (pattern3(wr, mem_op_base, imm))             return (uint32_t)0b00111000110000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_IMM9(2, 12);
-        if (pattern3(xr, mem_op_base, imm))             return (uint32_t)0b00111000100000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_IMM9(2, 12);
+        if (pattern3(wr, mem_op_base, imm))             return (uint32_t)0b00111000110000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern3(xr, mem_op_base, imm))             return (uint32_t)0b00111000100000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
         if (pattern2(wr, mem_op_imm_offset_pre))        return (uint32_t)0b00111000110000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
         if (pattern2(xr, mem_op_imm_offset_pre))        return (uint32_t)0b00111000100000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(wr, mem_op_unscaled1))             return (uint32_t)0b00111000110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(xr, mem_op_unscaled1))             return (uint32_t)0b00111000100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
         if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b00111001110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM12_OFFSET(1, 5, 10);
         if (pattern2(xr, mem_op_imm_offset))            return (uint32_t)0b00111001100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM12_OFFSET(1, 5, 10);
-        if (pattern2(wr, mem_op_regi_offset))           return (uint32_t)0b00111000111000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 1);
-        if (pattern2(xr, mem_op_regi_offset))           return (uint32_t)0b00111000101000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 1);
+        if (pattern2(wr, mem_op_regi_offset))           return (uint32_t)0b00111000111000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 0);
+        if (pattern2(xr, mem_op_regi_offset))           return (uint32_t)0b00111000101000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 0);
         unreachable();
     }},
     {"ldrsh", [](Operand** operands, int operand_length) {
-        if (pattern3(wr, mem_op_base, imm))             return (uint32_t)0b01111000110000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_IMM9(2, 12);
-        if (pattern3(xr, mem_op_base, imm))             return (uint32_t)0b01111000100000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_IMM9(2, 12);
+        if (pattern3(wr, mem_op_base, imm))             return (uint32_t)0b01111000110000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern3(xr, mem_op_base, imm))             return (uint32_t)0b01111000100000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
         if (pattern2(wr, mem_op_imm_offset_pre))        return (uint32_t)0b01111000110000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
         if (pattern2(xr, mem_op_imm_offset_pre))        return (uint32_t)0b01111000100000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(wr, mem_op_unscaled2))             return (uint32_t)0b01111000110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(xr, mem_op_unscaled2))             return (uint32_t)0b01111000100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
         if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b01111001110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 2);
         if (pattern2(xr, mem_op_imm_offset))            return (uint32_t)0b01111001100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 2);
         if (pattern2(wr, mem_op_regi_offset))           return (uint32_t)0b01111000111000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 1);
@@ -919,9 +2577,10 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         unreachable();
     }},
     {"ldrsw", [](Operand** operands, int operand_length) {
-        if (pattern3(xr, mem_op_base, imm))             return (uint32_t)0b10111000100000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_IMM9(2, 12);
+        if (pattern3(xr, mem_op_base, imm))             return (uint32_t)0b10111000100000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
         if (pattern2(xr, mem_op_imm_offset_pre))        return (uint32_t)0b10111000100000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
-        if (pattern2(xr, mem_op_imm_offset))            return (uint32_t)0b10111001100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM9_OFFSET(1, 5, 10, 4);
+        if (pattern2(xr, mem_op_unscaled4))             return (uint32_t)0b10111000100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(xr, mem_op_imm_offset))            return (uint32_t)0b10111001100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 4);
         if (pattern2(xr, mem_op_regi_offset))           return (uint32_t)0b10111000101000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 2);
         unreachable();
     }},
@@ -1215,6 +2874,12 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
     {"ldur", [](Operand** operands, int operand_length) {
         if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b10111000010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
         if (pattern2(xr, mem_op_imm_offset))            return (uint32_t)0b11111000010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        // LDUR (SIMD&FP)
+        if (pattern2(br, mem_op_imm_offset))            return (uint32_t)0b00111100010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(hr, mem_op_imm_offset))            return (uint32_t)0b01111100010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(sr, mem_op_imm_offset))            return (uint32_t)0b10111100010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(dr, mem_op_imm_offset))            return (uint32_t)0b11111100010000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(qr, mem_op_imm_offset))            return (uint32_t)0b00111100110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
         unreachable();
     }},
     {"ldurb", [](Operand** operands, int operand_length) {
@@ -1290,6 +2955,22 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern4(xr, xr, xr, xr))                   return (uint32_t)0b10011011000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10); // #20
         unreachable();
     }},
+    {"mla", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhs, vsame, vsame))           return (uint32_t)0b00001110001000001001010000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // AdvSIMD vector x indexed element
+        if (pattern3(vreg_h, vsame, velem_hs))          return (uint32_t)0b00101111000000000000000000000000 | ENCODE_VQ(0) | ENCODE_ELEM_INT(2) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern3(vreg_sd, vsame, velem_hs))         return (uint32_t)0b00101111000000000000000000000000 | ENCODE_VQ(0) | ENCODE_ELEM_INT(2) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"mls", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhs, vsame, vsame))           return (uint32_t)0b00101110001000001001010000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // AdvSIMD vector x indexed element
+        if (pattern3(vreg_h, vsame, velem_hs))          return (uint32_t)0b00101111000000000100000000000000 | ENCODE_VQ(0) | ENCODE_ELEM_INT(2) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern3(vreg_sd, vsame, velem_hs))         return (uint32_t)0b00101111000000000100000000000000 | ENCODE_VQ(0) | ENCODE_ELEM_INT(2) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
     {"mneg", [](Operand** operands, int operand_length) {
         if (pattern3(wr, wr, wr))                       return (uint32_t)0b00011011000000001111110000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16); // #1
         if (pattern3(xr, xr, xr))                       return (uint32_t)0b10011011000000001111110000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16); // #1
@@ -1300,25 +2981,54 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern2(xr, xr))                           return (uint32_t)0b10101010000000000000001111100000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 16); // #23
         if (pattern2(wr_or_wsp, wr_or_wsp))             return (uint32_t)0b00010001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5); // #8
         if (pattern2(xr_or_xsp, xr_or_xsp))             return (uint32_t)0b10010001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5); // #8
-        // TODO: MOV (inverted wide immediate)
-        if (pattern2(wr, imm))                          return (uint32_t)0b01010010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_IMM16(1, 5);
-        if (pattern2(xr, imm))                          return (uint32_t)0b11010010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_IMM16(1, 5);
-        // TODO: MOV (bitmask immediate)
+        // values that need more than one instruction are expanded by expand_mov_imm
+        if (pattern2(wr, wide_imm32))                   return (uint32_t)0b01010010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_WIDE_IMM(1, 32);
+        if (pattern2(xr, wide_imm64))                   return (uint32_t)0b11010010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_WIDE_IMM(1, 64);
+        // MOV (inverted wide immediate)
+        if (pattern2(wr, inv_wide_imm32))               return (uint32_t)0b00010010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_INV_WIDE_IMM(1, 32);
+        if (pattern2(xr, inv_wide_imm64))               return (uint32_t)0b10010010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_INV_WIDE_IMM(1, 64);
+        // MOV (bitmask immediate)
+        if (pattern2(wr_or_wsp, bitmask_imm32))         return (uint32_t)0b00110010000000000000001111100000 | ENCODE_REGI(0, 0) | ENCODE_BITMASK_IMM(1, 32);
+        if (pattern2(xr_or_xsp, bitmask_imm64))         return (uint32_t)0b10110010000000000000001111100000 | ENCODE_REGI(0, 0) | ENCODE_BITMASK_IMM(1, 64);
+        // MOV (vector): ORR Vd, Vn, Vn
+        if (pattern2(vreg_b, vsame))                    return (uint32_t)0b00001110101000000001110000000000 | ENCODE_VQ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(1, 16);
+        // MOV (element): INS
+        if (pattern2(velem, velem))                     return (uint32_t)0b01101110000000000000010000000000 | ENCODE_ELEM_IMM5(0) | ENCODE_ELEM_IMM4(1) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(velem_bhs, wr))                    return (uint32_t)0b01001110000000000001110000000000 | ENCODE_ELEM_IMM5(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(velem_d, xr))                      return (uint32_t)0b01001110000000000001110000000000 | ENCODE_ELEM_IMM5(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // MOV (to general): UMOV
+        if (pattern2(wr, velem))                        return (uint32_t)0b00001110000000000011110000000000 | ENCODE_ELEM_IMM5(1) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, velem_d))                      return (uint32_t)0b01001110000000000011110000000000 | ENCODE_ELEM_IMM5(1) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // MOV (immediate, unpredicated): DUP
+        if (pattern2(zreg, simm8))                      return (uint32_t)0b00100101001110001100000000000000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_SIMM8(1, 5);
+        // label expressions are only known after placement, when the mov can't be expanded any more
+        if ((pattern2(wr, imm)) || (pattern2(xr, imm))) operand_error("immediate " + std::to_string(operands[1]->imm) + " needs more than one instruction");
         unreachable();
     }},
     {"movk", [](Operand** operands, int operand_length) {
-        if (pattern2(wr, imm_shift))                    return (uint32_t)0b01110010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_IMM16(1, 5) | ENCODE_LSL_SHIFTS(2, 16, 21); // #21
-        if (pattern2(xr, imm_shift))                    return (uint32_t)0b11110010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_IMM16(1, 5) | ENCODE_LSL_SHIFTS(2, 16, 21); // #21
+        if (pattern2(wr, imm_shift))                    return (uint32_t)0b01110010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_IMM16(1, 5) | ENCODE_LSL_SHIFTS(2, 16, 16, 21); // #21
+        if (pattern2(xr, imm_shift))                    return (uint32_t)0b11110010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_IMM16(1, 5) | ENCODE_LSL_SHIFTS(2, 16, 48, 21); // #21
         unreachable();
     }},
     {"movn", [](Operand** operands, int operand_length) {
-        if (pattern2(wr, imm_shift))                    return (uint32_t)0b00010010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_IMM16(1, 5) | ENCODE_LSL_SHIFTS(2, 16, 21); // #21
-        if (pattern2(xr, imm_shift))                    return (uint32_t)0b10010010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_IMM16(1, 5) | ENCODE_LSL_SHIFTS(2, 16, 21); // #21
+        if (pattern2(wr, imm_shift))                    return (uint32_t)0b00010010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_IMM16(1, 5) | ENCODE_LSL_SHIFTS(2, 16, 16, 21); // #21
+        if (pattern2(xr, imm_shift))                    return (uint32_t)0b10010010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_IMM16(1, 5) | ENCODE_LSL_SHIFTS(2, 16, 48, 21); // #21
         unreachable();
     }},
     {"movz", [](Operand** operands, int operand_length) {
-        if (pattern2(wr, imm_shift))                    return (uint32_t)0b01010010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_IMM16(1, 5) | ENCODE_LSL_SHIFTS(2, 16, 21); // #21
-        if (pattern2(xr, imm_shift))                    return (uint32_t)0b11010010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_IMM16(1, 5) | ENCODE_LSL_SHIFTS(2, 16, 21); // #21
+        if (pattern2(wr, imm_shift))                    return (uint32_t)0b01010010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_IMM16(1, 5) | ENCODE_LSL_SHIFTS(2, 16, 16, 21); // #21
+        if (pattern2(xr, imm_shift))                    return (uint32_t)0b11010010100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_IMM16(1, 5) | ENCODE_LSL_SHIFTS(2, 16, 48, 21); // #21
+        unreachable();
+    }},
+    {"mrs", [](Operand** operands, int operand_length) {
+        if (pattern2(xr, sysreg))                       return (uint32_t)0b11010101001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_SYSREG(1, READ_ONLY);
+        unreachable();
+    }},
+    {"msr", [](Operand** operands, int operand_length) {
+        // MSR (immediate)
+        if (pattern2(pstate_field, imm))                return (uint32_t)0b11010101000000000100000000011111 | ENCODE_PSTATE_FIELD(0) | ENCODE_PSTATE_IMM(0, 1);
+        // MSR (register)
+        if (pattern2(sysreg, xr))                       return (uint32_t)0b11010101000000000000000000000000 | ENCODE_SYSREG(0, WRITE_ONLY) | ENCODE_REGI(1, 0);
         unreachable();
     }},
     {"msub", [](Operand** operands, int operand_length) {
@@ -1329,16 +3039,25 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
     {"mul", [](Operand** operands, int operand_length) {
         if (pattern3(wr, wr, wr))                       return (uint32_t)0b00011011000000000111110000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16); // #1
         if (pattern3(xr, xr, xr))                       return (uint32_t)0b10011011000000000111110000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16); // #1
+        // AdvSIMD three same
+        if (pattern3(vreg_bhs, vsame, vsame))           return (uint32_t)0b00001110001000001001110000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // AdvSIMD vector x indexed element
+        if (pattern3(vreg_h, vsame, velem_hs))          return (uint32_t)0b00001111000000001000000000000000 | ENCODE_VQ(0) | ENCODE_ELEM_INT(2) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern3(vreg_sd, vsame, velem_hs))         return (uint32_t)0b00001111000000001000000000000000 | ENCODE_VQ(0) | ENCODE_ELEM_INT(2) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
         unreachable();
     }},
     {"mvn", [](Operand** operands, int operand_length) {
         if (pattern2(wr, wr_shift))                     return (uint32_t)0b00101010001000000000001111100000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 16) | ENCODE_SHIFTS(2, 22, 10); // #22
         if (pattern2(xr, xr_shift))                     return (uint32_t)0b10101010001000000000001111100000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 16) | ENCODE_SHIFTS(2, 22, 10); // #22
+        // AdvSIMD two-register misc
+        if (pattern2(vreg_b, vsame))                    return (uint32_t)0b00101110001000000101100000000000 | ENCODE_VQ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
         unreachable();
     }},
     {"neg", [](Operand** operands, int operand_length) {
         if (pattern2(wr, wr_shift))                     return (uint32_t)0b01001011000000000000001111100000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 16) | ENCODE_SHIFTS(2, 22, 10); // #22
         if (pattern2(xr, xr_shift))                     return (uint32_t)0b11001011000000000000001111100000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 16) | ENCODE_SHIFTS(2, 22, 10); // #22
+        // AdvSIMD two-register misc
+        if (pattern2(vreg_bhsd, vsame))                 return (uint32_t)0b00101110001000001011100000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
         unreachable();
     }},
     {"negs", [](Operand** operands, int operand_length) {
@@ -1360,16 +3079,27 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (operand_length == 0)                        return (uint32_t)0b11010101000000110010000000011111;
         unreachable();
     }},
+    {"not", [](Operand** operands, int operand_length) {
+        // AdvSIMD two-register misc
+        if (pattern2(vreg_b, vsame))                    return (uint32_t)0b00101110001000000101100000000000 | ENCODE_VQ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
     {"orn", [](Operand** operands, int operand_length) {
         if (pattern3(wr, wr, wr_shift))                 return (uint32_t)0b00101010001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
         if (pattern3(xr, xr, xr_shift))                 return (uint32_t)0b10101010001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
+        // AdvSIMD three same (logical)
+        if (pattern3(vreg_b, vsame, vsame))             return (uint32_t)0b00001110111000000001110000000000 | ENCODE_VQ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
         unreachable();
     }},
     {"orr", [](Operand** operands, int operand_length) {
         // orr (shifted register)
         if (pattern3(wr, wr, wr_shift))                 return (uint32_t)0b00101010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
         if (pattern3(xr, xr, xr_shift))                 return (uint32_t)0b10101010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
-        // TODO: orr (immidiate)
+        // orr (immediate)
+        if (pattern3(wr_or_wsp, wr, bitmask_imm32))     return (uint32_t)0b00110010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_BITMASK_IMM(2, 32);
+        if (pattern3(xr_or_xsp, xr, bitmask_imm64))     return (uint32_t)0b10110010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_BITMASK_IMM(2, 64);
+        // AdvSIMD three same (logical)
+        if (pattern3(vreg_b, vsame, vsame))             return (uint32_t)0b00001110101000000001110000000000 | ENCODE_VQ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
         unreachable();
     }},
     {"pacda", [](Operand** operands, int operand_length) {
@@ -1432,10 +3162,36 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern1(xr))                               return (uint32_t)0b11011010110000010010011111100000 | ENCODE_REGI(0, 0); // #7
         unreachable();
     }},
+    {"prfm", [](Operand** operands, int operand_length) {
+        // PRFUM, for offsets PRFM (immediate) can't encode
+        if (pattern2(prfop, mem_op_unscaled8))          return (uint32_t)0b11111000100000000000000000000000 | ENCODE_VAL(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(imm, mem_op_unscaled8))            return (uint32_t)0b11111000100000000000000000000000 | ENCODE_IMM5(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        // PRFM (immediate), PRFM (register), PRFM (literal)
+        if (pattern2(prfop, mem_op_imm_offset))         return (uint32_t)0b11111001100000000000000000000000 | ENCODE_VAL(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 8);
+        if (pattern2(prfop, mem_op_base))               return (uint32_t)0b11111001100000000000000000000000 | ENCODE_VAL(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        if (pattern2(prfop, mem_op_regi_offset))        return (uint32_t)0b11111000101000000000100000000000 | ENCODE_VAL(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 3);
+        if (pattern2(prfop, label))                     return (uint32_t)0b11011000000000000000000000000000 | ENCODE_VAL(0, 0);
+        if (pattern2(imm, mem_op_imm_offset))           return (uint32_t)0b11111001100000000000000000000000 | ENCODE_IMM5(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 8);
+        if (pattern2(imm, mem_op_base))                 return (uint32_t)0b11111001100000000000000000000000 | ENCODE_IMM5(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        if (pattern2(imm, mem_op_regi_offset))          return (uint32_t)0b11111000101000000000100000000000 | ENCODE_IMM5(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 3);
+        if (pattern2(imm, label))                       return (uint32_t)0b11011000000000000000000000000000 | ENCODE_IMM5(0, 0);
+        unreachable();
+    }},
+    {"prfum", [](Operand** operands, int operand_length) {
+        if (pattern2(prfop, mem_op_imm_offset))         return (uint32_t)0b11111000100000000000000000000000 | ENCODE_VAL(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(imm, mem_op_imm_offset))           return (uint32_t)0b11111000100000000000000000000000 | ENCODE_IMM5(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        unreachable();
+    }},
     {"pssbb", [](Operand** operands, int operand_length) {
         if (operand_length == 0)                        return (uint32_t)0b11010101000000110011010010011111;
         unreachable();
     }},
+    {"ptrue", [](Operand** operands, int operand_length) {
+        // SVE predicate initialize
+        if (pattern2(preg_sized, sve_pattern))          return (uint32_t)0b00100101000110001110000000000000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_SVE_PATTERN(1);
+        if (pattern1(preg_sized))                       return (uint32_t)0b00100101000110001110001111100000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0);
+        unreachable();
+    }},
     {"rbit", [](Operand** operands, int operand_length) {
         if (pattern2(wr, wr))                           return (uint32_t)0b01011010110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5); // #8
         if (pattern2(xr, xr))                           return (uint32_t)0b11011010110000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5); // #8
@@ -1470,6 +3226,8 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
     }},
     {"rev64", [](Operand** operands, int operand_length) {
         if (pattern2(xr, xr))                           return (uint32_t)0b11011010110000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5); // #8
+        // AdvSIMD two-register misc
+        if (pattern2(vreg_bhs, vsame))                  return (uint32_t)0b00001110001000000000100000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
         unreachable();
     }},
     {"rmif", [](Operand** operands, int operand_length) {
@@ -1504,6 +3262,25 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern3(xr, xr, xr))                       return (uint32_t)0b11111010000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16); // #1
         unreachable();
     }},
+    {"scvtf", [](Operand** operands, int operand_length) {
+        // AdvSIMD two-register misc (floating-point)
+        if (pattern2(vreg_sd, vsame))                   return (uint32_t)0b00001110001000011101100000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // conversion between floating-point and fixed-point
+        if (pattern3(hr, wr, imm))                      return (uint32_t)0b00011110110000100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(1, 2);
+        if (pattern3(sr, wr, imm))                      return (uint32_t)0b00011110000000100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(1, 2);
+        if (pattern3(dr, wr, imm))                      return (uint32_t)0b00011110010000100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(1, 2);
+        if (pattern3(hr, xr, imm))                      return (uint32_t)0b10011110110000100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(1, 2);
+        if (pattern3(sr, xr, imm))                      return (uint32_t)0b10011110000000100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(1, 2);
+        if (pattern3(dr, xr, imm))                      return (uint32_t)0b10011110010000100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(1, 2);
+        // conversion between floating-point and integer
+        if (pattern2(hr, wr))                           return (uint32_t)0b00011110111000100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, wr))                           return (uint32_t)0b00011110001000100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, wr))                           return (uint32_t)0b00011110011000100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(hr, xr))                           return (uint32_t)0b10011110111000100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, xr))                           return (uint32_t)0b10011110001000100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, xr))                           return (uint32_t)0b10011110011000100000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
     {"sdiv", [](Operand** operands, int operand_length) {
         if (pattern3(wr, wr, wr))                       return (uint32_t)0b00011010110000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16); // #1
         if (pattern3(xr, xr, xr))                       return (uint32_t)0b10011010110000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16); // #1
@@ -1525,18 +3302,39 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (operand_length == 0)                        return (uint32_t)0b11010101000000110010000010111111;
         unreachable();
     }},
+    {"shl", [](Operand** operands, int operand_length) {
+        // AdvSIMD shift by immediate
+        if (pattern3(vreg_bhsd, vsame, imm))            return (uint32_t)0b00001111000000000101010000000000 | ENCODE_VQ(0) | ENCODE_VSHL_IMM(2, 0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
     {"smaddl", [](Operand** operands, int operand_length) {
         if (pattern4(xr, wr, wr, xr))                   return (uint32_t)0b10011011001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10); // #20
         unreachable();
     }},
+    {"smax", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhs, vsame, vsame))           return (uint32_t)0b00001110001000000110010000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
     {"smc", [](Operand** operands, int operand_length) {
         if (pattern1(imm))                              return (uint32_t)0b11010100000000000000000000000011 | ENCODE_IMM16(0, 5); // #17
         unreachable();
     }},
+    {"smin", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhs, vsame, vsame))           return (uint32_t)0b00001110001000000110110000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
     {"smnegl", [](Operand** operands, int operand_length) {
         if (pattern3(xr, wr, wr))                       return (uint32_t)0b10011011001000001111110000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16); // #1
         unreachable();
     }},
+    {"smov", [](Operand** operands, int operand_length) {
+        // AdvSIMD copy
+        if (pattern2(wr, velem_bhs))                    return (uint32_t)0b00001110000000000010110000000000 | ENCODE_ELEM_IMM5(1) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, velem_bhs))                    return (uint32_t)0b01001110000000000010110000000000 | ENCODE_ELEM_IMM5(1) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
     {"smsubl", [](Operand** operands, int operand_length) {
         if (pattern4(xr, wr, wr, xr))                   return (uint32_t)0b10011011001000001000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10); // #20
         unreachable();
@@ -1549,21 +3347,311 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern3(xr, wr, wr))                       return (uint32_t)0b10011011001000000111110000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16); // #1
         unreachable();
     }},
+    {"sqadd", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhsd, vsame, vsame))          return (uint32_t)0b00001110001000000000110000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"sqsub", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhsd, vsame, vsame))          return (uint32_t)0b00001110001000000010110000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
     {"ssbb", [](Operand** operands, int operand_length) {
         if (operand_length == 0)                        return (uint32_t)0b11010101000000110011000010011111;
         unreachable();
     }},
+    {"sshl", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhsd, vsame, vsame))          return (uint32_t)0b00001110001000000100010000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"sshr", [](Operand** operands, int operand_length) {
+        // AdvSIMD shift by immediate
+        if (pattern3(vreg_bhsd, vsame, imm))            return (uint32_t)0b00001111000000000000010000000000 | ENCODE_VQ(0) | ENCODE_VSHR_IMM(2, 0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
+    {"st1", [](Operand** operands, int operand_length) {
+        // AdvSIMD load/store multiple structures
+        if (pattern3(vlist1, mem_op_base, xr))          return (uint32_t)0b00001100100000000111000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(vlist1, mem_op_base, imm))         return (uint32_t)0b00001100100111110111000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_VLIST_POST_IMM(0, 2);
+        if (pattern3(vlist2, mem_op_base, xr))          return (uint32_t)0b00001100100000001010000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(vlist2, mem_op_base, imm))         return (uint32_t)0b00001100100111111010000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_VLIST_POST_IMM(0, 2);
+        if (pattern3(vlist3, mem_op_base, xr))          return (uint32_t)0b00001100100000000110000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(vlist3, mem_op_base, imm))         return (uint32_t)0b00001100100111110110000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_VLIST_POST_IMM(0, 2);
+        if (pattern3(vlist4, mem_op_base, xr))          return (uint32_t)0b00001100100000000010000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(vlist4, mem_op_base, imm))         return (uint32_t)0b00001100100111110010000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_VLIST_POST_IMM(0, 2);
+        if (pattern2(vlist1, mem_op_base))              return (uint32_t)0b00001100000000000111000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        if (pattern2(vlist2, mem_op_base))              return (uint32_t)0b00001100000000001010000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        if (pattern2(vlist3, mem_op_base))              return (uint32_t)0b00001100000000000110000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        if (pattern2(vlist4, mem_op_base))              return (uint32_t)0b00001100000000000010000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        unreachable();
+    }},
+    {"st1b", [](Operand** operands, int operand_length) {
+        // SVE contiguous store (scalar plus scalar)
+        if (pattern3(zlist_b, pg, mem_op_regi_lsl0))    return (uint32_t)0b11100100000000000100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_REGI_LSL(2, 5, 16);
+        // SVE contiguous store (scalar plus immediate)
+        if (pattern3(zlist_b, pg, mem_op_vl_offset))    return (uint32_t)0b11100100000000001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_VL_OFFSET(2, 5, 16);
+        if (pattern3(zlist_b, pg, mem_op_base))         return (uint32_t)0b11100100000000001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_BASE(2, 5);
+        unreachable();
+    }},
+    {"st1d", [](Operand** operands, int operand_length) {
+        // SVE contiguous store (scalar plus scalar)
+        if (pattern3(zlist_d, pg, mem_op_regi_lsl3))    return (uint32_t)0b11100101111000000100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_REGI_LSL(2, 5, 16);
+        // SVE contiguous store (scalar plus immediate)
+        if (pattern3(zlist_d, pg, mem_op_vl_offset))    return (uint32_t)0b11100101111000001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_VL_OFFSET(2, 5, 16);
+        if (pattern3(zlist_d, pg, mem_op_base))         return (uint32_t)0b11100101111000001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_BASE(2, 5);
+        unreachable();
+    }},
+    {"st1h", [](Operand** operands, int operand_length) {
+        // SVE contiguous store (scalar plus scalar)
+        if (pattern3(zlist_h, pg, mem_op_regi_lsl1))    return (uint32_t)0b11100100101000000100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_REGI_LSL(2, 5, 16);
+        // SVE contiguous store (scalar plus immediate)
+        if (pattern3(zlist_h, pg, mem_op_vl_offset))    return (uint32_t)0b11100100101000001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_VL_OFFSET(2, 5, 16);
+        if (pattern3(zlist_h, pg, mem_op_base))         return (uint32_t)0b11100100101000001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_BASE(2, 5);
+        unreachable();
+    }},
+    {"st1w", [](Operand** operands, int operand_length) {
+        // SVE contiguous store (scalar plus scalar)
+        if (pattern3(zlist_s, pg, mem_op_regi_lsl2))    return (uint32_t)0b11100101010000000100000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_REGI_LSL(2, 5, 16);
+        // SVE contiguous store (scalar plus immediate)
+        if (pattern3(zlist_s, pg, mem_op_vl_offset))    return (uint32_t)0b11100101010000001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_VL_OFFSET(2, 5, 16);
+        if (pattern3(zlist_s, pg, mem_op_base))         return (uint32_t)0b11100101010000001110000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_BASE(2, 5);
+        unreachable();
+    }},
+    {"st2", [](Operand** operands, int operand_length) {
+        // AdvSIMD load/store multiple structures
+        if (pattern3(vlist2, mem_op_base, xr))          return (uint32_t)0b00001100100000001000000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(vlist2, mem_op_base, imm))         return (uint32_t)0b00001100100111111000000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_VLIST_POST_IMM(0, 2);
+        if (pattern2(vlist2, mem_op_base))              return (uint32_t)0b00001100000000001000000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        unreachable();
+    }},
+    {"st3", [](Operand** operands, int operand_length) {
+        // AdvSIMD load/store multiple structures
+        if (pattern3(vlist3, mem_op_base, xr))          return (uint32_t)0b00001100100000000100000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(vlist3, mem_op_base, imm))         return (uint32_t)0b00001100100111110100000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_VLIST_POST_IMM(0, 2);
+        if (pattern2(vlist3, mem_op_base))              return (uint32_t)0b00001100000000000100000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        unreachable();
+    }},
+    {"st4", [](Operand** operands, int operand_length) {
+        // AdvSIMD load/store multiple structures
+        if (pattern3(vlist4, mem_op_base, xr))          return (uint32_t)0b00001100100000000000000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(vlist4, mem_op_base, imm))         return (uint32_t)0b00001100100111110000000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_VLIST_POST_IMM(0, 2);
+        if (pattern2(vlist4, mem_op_base))              return (uint32_t)0b00001100000000000000000000000000 | ENCODE_VLIST(0) | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        unreachable();
+    }},
+    {"stllr", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, mem_op_base))                  return (uint32_t)0b10001000100111110111110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        if (pattern2(xr, mem_op_base))                  return (uint32_t)0b11001000100111110111110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        unreachable();
+    }},
+    {"stllrb", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, mem_op_base))                  return (uint32_t)0b00001000100111110111110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        unreachable();
+    }},
+    {"stllrh", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, mem_op_base))                  return (uint32_t)0b01001000100111110111110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        unreachable();
+    }},
+    {"stlr", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, mem_op_base))                  return (uint32_t)0b10001000100111111111110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        if (pattern2(xr, mem_op_base))                  return (uint32_t)0b11001000100111111111110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        unreachable();
+    }},
+    {"stlrb", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, mem_op_base))                  return (uint32_t)0b00001000100111111111110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        unreachable();
+    }},
+    {"stlrh", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, mem_op_base))                  return (uint32_t)0b01001000100111111111110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5);
+        unreachable();
+    }},
+    {"stlur", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b10011001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(xr, mem_op_imm_offset))            return (uint32_t)0b11011001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        unreachable();
+    }},
+    {"stlurb", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b00011001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        unreachable();
+    }},
+    {"stlurh", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b01011001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        unreachable();
+    }},
+    {"stlxp", [](Operand** operands, int operand_length) {
+        if (pattern4(wr, wr, wr, mem_op_base))          return (uint32_t)0b10001000001000001000000000000000 | ENCODE_STATUS_REGI(16) | ENCODE_REGI(1, 0) | ENCODE_REGI(2, 10) | ENCODE_MEM_OP_BASE(3, 5);
+        if (pattern4(wr, xr, xr, mem_op_base))          return (uint32_t)0b11001000001000001000000000000000 | ENCODE_STATUS_REGI(16) | ENCODE_REGI(1, 0) | ENCODE_REGI(2, 10) | ENCODE_MEM_OP_BASE(3, 5);
+        unreachable();
+    }},
+    {"stlxr", [](Operand** operands, int operand_length) {
+        if (pattern3(wr, wr, mem_op_base))              return (uint32_t)0b10001000000000001111110000000000 | ENCODE_STATUS_REGI(16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
+        if (pattern3(wr, xr, mem_op_base))              return (uint32_t)0b11001000000000001111110000000000 | ENCODE_STATUS_REGI(16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
+        unreachable();
+    }},
+    {"stlxrb", [](Operand** operands, int operand_length) {
+        if (pattern3(wr, wr, mem_op_base))              return (uint32_t)0b00001000000000001111110000000000 | ENCODE_STATUS_REGI(16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
+        unreachable();
+    }},
+    {"stlxrh", [](Operand** operands, int operand_length) {
+        if (pattern3(wr, wr, mem_op_base))              return (uint32_t)0b01001000000000001111110000000000 | ENCODE_STATUS_REGI(16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
+        unreachable();
+    }},
+    {"stnp", [](Operand** operands, int operand_length) {
+        if (pattern3(wr, wr, mem_op_imm_offset))        return (uint32_t)0b00101000000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 4);
+        if (pattern3(xr, xr, mem_op_imm_offset))        return (uint32_t)0b10101000000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 8);
+        // STNP (SIMD&FP)
+        if (pattern3(sr, sr, mem_op_imm_offset))        return (uint32_t)0b00101100000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 4);
+        if (pattern3(dr, dr, mem_op_imm_offset))        return (uint32_t)0b01101100000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 8);
+        if (pattern3(qr, qr, mem_op_imm_offset))        return (uint32_t)0b10101100000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 16);
+        unreachable();
+    }},
+    {"stp", [](Operand** operands, int operand_length) {
+        if (pattern4(wr, wr, mem_op_base, imm))         return (uint32_t)0b00101000100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_BASE(2, 5) | ENCODE_DIV_IMM7(3, 15, 4);
+        if (pattern4(xr, xr, mem_op_base, imm))         return (uint32_t)0b10101000100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_BASE(2, 5) | ENCODE_DIV_IMM7(3, 15, 8);
+        if (pattern3(wr, wr, mem_op_imm_offset_pre))    return (uint32_t)0b00101001100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 4);
+        if (pattern3(xr, xr, mem_op_imm_offset_pre))    return (uint32_t)0b10101001100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 8);
+        if (pattern3(wr, wr, mem_op_imm_offset))        return (uint32_t)0b00101001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 4);
+        if (pattern3(xr, xr, mem_op_imm_offset))        return (uint32_t)0b10101001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 8);
+        // STP (SIMD&FP)
+        if (pattern4(sr, sr, mem_op_base, imm))         return (uint32_t)0b00101100100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_BASE(2, 5) | ENCODE_DIV_IMM7(3, 15, 4);
+        if (pattern4(dr, dr, mem_op_base, imm))         return (uint32_t)0b01101100100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_BASE(2, 5) | ENCODE_DIV_IMM7(3, 15, 8);
+        if (pattern4(qr, qr, mem_op_base, imm))         return (uint32_t)0b10101100100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_BASE(2, 5) | ENCODE_DIV_IMM7(3, 15, 16);
+        if (pattern3(sr, sr, mem_op_imm_offset_pre))    return (uint32_t)0b00101101100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 4);
+        if (pattern3(dr, dr, mem_op_imm_offset_pre))    return (uint32_t)0b01101101100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 8);
+        if (pattern3(qr, qr, mem_op_imm_offset_pre))    return (uint32_t)0b10101101100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 16);
+        if (pattern3(sr, sr, mem_op_imm_offset))        return (uint32_t)0b00101101000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 4);
+        if (pattern3(dr, dr, mem_op_imm_offset))        return (uint32_t)0b01101101000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 8);
+        if (pattern3(qr, qr, mem_op_imm_offset))        return (uint32_t)0b10101101000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 10) | ENCODE_MEM_OP_DIV_IMM7_OFFSET(2, 5, 15, 16);
+        unreachable();
+    }},
+    {"str", [](Operand** operands, int operand_length) {
+        // STR (immediate)
+        if (pattern3(wr, mem_op_base, imm))             return (uint32_t)0b10111000000000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern3(xr, mem_op_base, imm))             return (uint32_t)0b11111000000000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern2(wr, mem_op_imm_offset_pre))        return (uint32_t)0b10111000000000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(xr, mem_op_imm_offset_pre))        return (uint32_t)0b11111000000000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        // STUR, for offsets STR (immediate) can't encode
+        if (pattern2(wr, mem_op_unscaled4))             return (uint32_t)0b10111000000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(xr, mem_op_unscaled8))             return (uint32_t)0b11111000000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b10111001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 4);
+        if (pattern2(xr, mem_op_imm_offset))            return (uint32_t)0b11111001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 8);
+        if (pattern2(wr, mem_op_regi_offset))           return (uint32_t)0b10111000001000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 2);
+        if (pattern2(xr, mem_op_regi_offset))           return (uint32_t)0b11111000001000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 3);
+        // STR (immediate, SIMD&FP)
+        if (pattern3(br, mem_op_base, imm))             return (uint32_t)0b00111100000000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern3(hr, mem_op_base, imm))             return (uint32_t)0b01111100000000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern3(sr, mem_op_base, imm))             return (uint32_t)0b10111100000000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern3(dr, mem_op_base, imm))             return (uint32_t)0b11111100000000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern3(qr, mem_op_base, imm))             return (uint32_t)0b00111100100000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern2(br, mem_op_imm_offset_pre))        return (uint32_t)0b00111100000000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(hr, mem_op_imm_offset_pre))        return (uint32_t)0b01111100000000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(sr, mem_op_imm_offset_pre))        return (uint32_t)0b10111100000000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(dr, mem_op_imm_offset_pre))        return (uint32_t)0b11111100000000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(qr, mem_op_imm_offset_pre))        return (uint32_t)0b00111100100000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        // STUR (SIMD&FP), for offsets STR (immediate, SIMD&FP) can't encode
+        if (pattern2(br, mem_op_unscaled1))             return (uint32_t)0b00111100000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(hr, mem_op_unscaled2))             return (uint32_t)0b01111100000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(sr, mem_op_unscaled4))             return (uint32_t)0b10111100000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(dr, mem_op_unscaled8))             return (uint32_t)0b11111100000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(qr, mem_op_unscaled16))            return (uint32_t)0b00111100100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(br, mem_op_imm_offset))            return (uint32_t)0b00111101000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 1);
+        if (pattern2(hr, mem_op_imm_offset))            return (uint32_t)0b01111101000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 2);
+        if (pattern2(sr, mem_op_imm_offset))            return (uint32_t)0b10111101000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 4);
+        if (pattern2(dr, mem_op_imm_offset))            return (uint32_t)0b11111101000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 8);
+        if (pattern2(qr, mem_op_imm_offset))            return (uint32_t)0b00111101100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 16);
+        // STR (register, SIMD&FP)
+        if (pattern2(br, mem_op_regi_offset))           return (uint32_t)0b00111100001000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 0);
+        if (pattern2(hr, mem_op_regi_offset))           return (uint32_t)0b01111100001000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 1);
+        if (pattern2(sr, mem_op_regi_offset))           return (uint32_t)0b10111100001000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 2);
+        if (pattern2(dr, mem_op_regi_offset))           return (uint32_t)0b11111100001000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 3);
+        if (pattern2(qr, mem_op_regi_offset))           return (uint32_t)0b00111100101000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 4);
+        unreachable();
+    }},
+    {"strb", [](Operand** operands, int operand_length) {
+        if (pattern3(wr, mem_op_base, imm))             return (uint32_t)0b00111000000000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern2(wr, mem_op_imm_offset_pre))        return (uint32_t)0b00111000000000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(wr, mem_op_unscaled1))             return (uint32_t)0b00111000000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b00111001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM12_OFFSET(1, 5, 10);
+        if (pattern2(wr, mem_op_regi_offset))           return (uint32_t)0b00111000001000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 0);
+        unreachable();
+    }},
+    {"strh", [](Operand** operands, int operand_length) {
+        if (pattern3(wr, mem_op_base, imm))             return (uint32_t)0b01111000000000000000010000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_BASE(1, 5) | ENCODE_SIMM9(2, 12);
+        if (pattern2(wr, mem_op_imm_offset_pre))        return (uint32_t)0b01111000000000000000110000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(wr, mem_op_unscaled2))             return (uint32_t)0b01111000000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b01111001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_DIV_IMM12_OFFSET(1, 5, 10, 2);
+        if (pattern2(wr, mem_op_regi_offset))           return (uint32_t)0b01111000001000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_REGI_OFFSET(1, 5, 16, 13, 12, 1);
+        unreachable();
+    }},
+    {"sttr", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b10111000000000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(xr, mem_op_imm_offset))            return (uint32_t)0b11111000000000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        unreachable();
+    }},
+    {"sttrb", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b00111000000000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        unreachable();
+    }},
+    {"sttrh", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b01111000000000000000100000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        unreachable();
+    }},
+    {"stur", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b10111000000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(xr, mem_op_imm_offset))            return (uint32_t)0b11111000000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        // STUR (SIMD&FP)
+        if (pattern2(br, mem_op_imm_offset))            return (uint32_t)0b00111100000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(hr, mem_op_imm_offset))            return (uint32_t)0b01111100000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(sr, mem_op_imm_offset))            return (uint32_t)0b10111100000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(dr, mem_op_imm_offset))            return (uint32_t)0b11111100000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        if (pattern2(qr, mem_op_imm_offset))            return (uint32_t)0b00111100100000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        unreachable();
+    }},
+    {"sturb", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b00111000000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        unreachable();
+    }},
+    {"sturh", [](Operand** operands, int operand_length) {
+        if (pattern2(wr, mem_op_imm_offset))            return (uint32_t)0b01111000000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_MEM_OP_IMM9_OFFSET(1, 5, 12);
+        unreachable();
+    }},
+    {"stxp", [](Operand** operands, int operand_length) {
+        if (pattern4(wr, wr, wr, mem_op_base))          return (uint32_t)0b10001000001000000000000000000000 | ENCODE_STATUS_REGI(16) | ENCODE_REGI(1, 0) | ENCODE_REGI(2, 10) | ENCODE_MEM_OP_BASE(3, 5);
+        if (pattern4(wr, xr, xr, mem_op_base))          return (uint32_t)0b11001000001000000000000000000000 | ENCODE_STATUS_REGI(16) | ENCODE_REGI(1, 0) | ENCODE_REGI(2, 10) | ENCODE_MEM_OP_BASE(3, 5);
+        unreachable();
+    }},
+    {"stxr", [](Operand** operands, int operand_length) {
+        if (pattern3(wr, wr, mem_op_base))              return (uint32_t)0b10001000000000000111110000000000 | ENCODE_STATUS_REGI(16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
+        if (pattern3(wr, xr, mem_op_base))              return (uint32_t)0b11001000000000000111110000000000 | ENCODE_STATUS_REGI(16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
+        unreachable();
+    }},
+    {"stxrb", [](Operand** operands, int operand_length) {
+        if (pattern3(wr, wr, mem_op_base))              return (uint32_t)0b00001000000000000111110000000000 | ENCODE_STATUS_REGI(16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
+        unreachable();
+    }},
+    {"stxrh", [](Operand** operands, int operand_length) {
+        if (pattern3(wr, wr, mem_op_base))              return (uint32_t)0b01001000000000000111110000000000 | ENCODE_STATUS_REGI(16) | ENCODE_REGI(1, 0) | ENCODE_MEM_OP_BASE(2, 5);
+        unreachable();
+    }},
     {"sub", [](Operand** operands, int operand_length) {
         // SUB (shifted register)
         if (pattern3(xr, xr, xr_shift))                 return (uint32_t)0b11001011000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
         if (pattern3(wr, wr, wr_shift))                 return (uint32_t)0b01001011000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
         // SUB (immediate)
-        if (pattern3(xr_or_xsp, xr_or_xsp, imm_shift))  return (uint32_t)0b11010001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_IMM12(2, 10) | ENCODE_LSL_SHIFTS(3, 12, 22); // #3
-        if (pattern3(wr_or_wsp, wr_or_wsp, imm_shift))  return (uint32_t)0b01010001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_IMM12(2, 10) | ENCODE_LSL_SHIFTS(3, 12, 22); // #3
+        // ADD (immediate) for negative immediates
+        if (pattern3(xr_or_xsp, xr_or_xsp, neg_imm_shift)) return (uint32_t)0b10010001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_NEG_ADD_IMM(2);
+        if (pattern3(wr_or_wsp, wr_or_wsp, neg_imm_shift)) return (uint32_t)0b00010001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_NEG_ADD_IMM(2);
+        if (pattern3(xr_or_xsp, xr_or_xsp, imm_shift))  return (uint32_t)0b11010001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_ADD_IMM(2); // #3
+        if (pattern3(wr_or_wsp, wr_or_wsp, imm_shift))  return (uint32_t)0b01010001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_ADD_IMM(2); // #3
         // SUB (extened register)
         if (pattern3(wr_or_wsp, wr_or_wsp, wr_extend))  return (uint32_t)0b01001011001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_EXTENDW(3, 13, 10); // #4
         if (pattern3(xr_or_xsp, xr_or_xsp, xr_extend))  return (uint32_t)0b11001011001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_EXTENDX(3, 13, 10); // #5
         if (pattern3(xr_or_xsp, xr_or_xsp, wr_extend))  return (uint32_t)0b11001011001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_EXTENDW(3, 13, 10); // #4
+        // AdvSIMD three same
+        if (pattern3(vreg_bhsd, vsame, vsame))          return (uint32_t)0b00101110001000001000010000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        // SVE integer add/subtract vectors (unpredicated)
+        if (pattern3(zreg, zsame, zsame))               return (uint32_t)0b00000100001000000000010000000000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
         unreachable();
     }},
     {"subs", [](Operand** operands, int operand_length) {
@@ -1571,8 +3659,11 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern3(xr, xr, xr_shift))                 return (uint32_t)0b11101011000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
         if (pattern3(wr, wr, wr_shift))                 return (uint32_t)0b01101011000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_SHIFTS(3, 22, 10); // #2
         // ADD (immediate)
-        if (pattern3(xr, xr_or_xsp, imm_shift))         return (uint32_t)0b11110001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_IMM12(2, 10) | ENCODE_LSL_SHIFTS(3, 12, 22); // #3
-        if (pattern3(wr, wr_or_wsp, imm_shift))         return (uint32_t)0b01110001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_IMM12(2, 10) | ENCODE_LSL_SHIFTS(3, 12, 22); // #3
+        // ADDS (immediate) for negative immediates
+        if (pattern3(xr, xr_or_xsp, neg_imm_shift))     return (uint32_t)0b10110001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_NEG_ADD_IMM(2);
+        if (pattern3(wr, wr_or_wsp, neg_imm_shift))     return (uint32_t)0b00110001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_NEG_ADD_IMM(2);
+        if (pattern3(xr, xr_or_xsp, imm_shift))         return (uint32_t)0b11110001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_ADD_IMM(2); // #3
+        if (pattern3(wr, wr_or_wsp, imm_shift))         return (uint32_t)0b01110001000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_ADD_IMM(2); // #3
         // ADD (extened register)
         if (pattern3(wr, wr_or_wsp, wr_extend))         return (uint32_t)0b01101011001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_EXTENDW(3, 13, 10); // #4
         if (pattern3(xr, xr_or_xsp, xr_extend))         return (uint32_t)0b11101011001000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_EXTENDX(3, 13, 10); // #5
@@ -1597,6 +3688,54 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern2(xr, wr))                           return (uint32_t)0b10010011010000000111110000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5); // #8
         unreachable();
     }},
+    {"tbl", [](Operand** operands, int operand_length) {
+        // AdvSIMD table lookup
+        if (pattern3(vreg_b, vlist, vsame))             return (uint32_t)0b00001110000000000000000000000000 | ENCODE_VQ(0) | ENCODE_VLIST_LEN(1) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"tbnz", [](Operand** operands, int operand_length) {
+        if (pattern3(wr, imm, label))                   return (uint32_t)0b00110111000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_TEST_BIT(1);
+        if (pattern3(xr, imm, label))                   return (uint32_t)0b00110111000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_TEST_BIT(1);
+        unreachable();
+    }},
+    {"tbx", [](Operand** operands, int operand_length) {
+        // AdvSIMD table lookup
+        if (pattern3(vreg_b, vlist, vsame))             return (uint32_t)0b00001110000000000001000000000000 | ENCODE_VQ(0) | ENCODE_VLIST_LEN(1) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"tbz", [](Operand** operands, int operand_length) {
+        if (pattern3(wr, imm, label))                   return (uint32_t)0b00110110000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_TEST_BIT(1);
+        if (pattern3(xr, imm, label))                   return (uint32_t)0b00110110000000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_TEST_BIT(1);
+        unreachable();
+    }},
+    {"tst", [](Operand** operands, int operand_length) {
+        // (immediate)
+        if (pattern2(wr, bitmask_imm32))                return (uint32_t)0b01110010000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_BITMASK_IMM(1, 32);
+        if (pattern2(xr, bitmask_imm64))                return (uint32_t)0b11110010000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_BITMASK_IMM(1, 64);
+        // (shifted register)
+        if (pattern2(wr, wr_shift))                     return (uint32_t)0b01101010000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16) | ENCODE_SHIFTS(2, 22, 10);
+        if (pattern2(xr, xr_shift))                     return (uint32_t)0b11101010000000000000000000011111 | ENCODE_REGI(0, 5) | ENCODE_REGI(1, 16) | ENCODE_SHIFTS(2, 22, 10);
+        unreachable();
+    }},
+    {"ucvtf", [](Operand** operands, int operand_length) {
+        // AdvSIMD two-register misc (floating-point)
+        if (pattern2(vreg_sd, vsame))                   return (uint32_t)0b00101110001000011101100000000000 | ENCODE_VQ(0) | ENCODE_VSZ(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        // conversion between floating-point and fixed-point
+        if (pattern3(hr, wr, imm))                      return (uint32_t)0b00011110110000110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(1, 2);
+        if (pattern3(sr, wr, imm))                      return (uint32_t)0b00011110000000110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(1, 2);
+        if (pattern3(dr, wr, imm))                      return (uint32_t)0b00011110010000110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(1, 2);
+        if (pattern3(hr, xr, imm))                      return (uint32_t)0b10011110110000110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(1, 2);
+        if (pattern3(sr, xr, imm))                      return (uint32_t)0b10011110000000110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(1, 2);
+        if (pattern3(dr, xr, imm))                      return (uint32_t)0b10011110010000110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_FBITS(1, 2);
+        // conversion between floating-point and integer
+        if (pattern2(hr, wr))                           return (uint32_t)0b00011110111000110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, wr))                           return (uint32_t)0b00011110001000110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, wr))                           return (uint32_t)0b00011110011000110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(hr, xr))                           return (uint32_t)0b10011110111000110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(sr, xr))                           return (uint32_t)0b10011110001000110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(dr, xr))                           return (uint32_t)0b10011110011000110000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
     {"udf", [](Operand** operands, int operand_length) {
         if (pattern1(imm))                              return (uint32_t)0b00000000000000000000000000000000 | ENCODE_IMM16(0, 0);
         unreachable();
@@ -1610,10 +3749,26 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern4(xr, wr, wr, xr))                   return (uint32_t)0b10011011101000000000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10); // #20
         unreachable();
     }},
+    {"umax", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhs, vsame, vsame))           return (uint32_t)0b00101110001000000110010000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"umin", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhs, vsame, vsame))           return (uint32_t)0b00101110001000000110110000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
     {"umnegl", [](Operand** operands, int operand_length) {
         if (pattern3(xr, wr, wr))                       return (uint32_t)0b10011011101000001111110000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16); // #1
         unreachable();
     }},
+    {"umov", [](Operand** operands, int operand_length) {
+        // AdvSIMD copy
+        if (pattern2(wr, velem_bhs))                    return (uint32_t)0b00001110000000000011110000000000 | ENCODE_ELEM_IMM5(1) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        if (pattern2(xr, velem_d))                      return (uint32_t)0b01001110000000000011110000000000 | ENCODE_ELEM_IMM5(1) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
     {"umsubl", [](Operand** operands, int operand_length) {
         if (pattern4(xr, wr, wr, xr))                   return (uint32_t)0b10011011101000001000000000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16) | ENCODE_REGI(3, 10); // #20
         unreachable();
@@ -1626,6 +3781,26 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (pattern3(xr, wr, wr))                       return (uint32_t)0b10011011101000000111110000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16); // #1
         unreachable();
     }},
+    {"uqadd", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhsd, vsame, vsame))          return (uint32_t)0b00101110001000000000110000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"uqsub", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhsd, vsame, vsame))          return (uint32_t)0b00101110001000000010110000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"ushl", [](Operand** operands, int operand_length) {
+        // AdvSIMD three same
+        if (pattern3(vreg_bhsd, vsame, vsame))          return (uint32_t)0b00101110001000000100010000000000 | ENCODE_VQ(0) | ENCODE_VSIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"ushr", [](Operand** operands, int operand_length) {
+        // AdvSIMD shift by immediate
+        if (pattern3(vreg_bhsd, vsame, imm))            return (uint32_t)0b00101111000000000000010000000000 | ENCODE_VQ(0) | ENCODE_VSHR_IMM(2, 0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5);
+        unreachable();
+    }},
     {"uxtb", [](Operand** operands, int operand_length) {
         if (pattern2(wr, wr))                           return (uint32_t)0b01010011000000000001110000000000 | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5); // #8
         unreachable();
@@ -1642,6 +3817,30 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
         if (operand_length == 0)                        return (uint32_t)0b11010101000000110010000001111111;
         unreachable();
     }},
+    {"whilele", [](Operand** operands, int operand_length) {
+        // SVE integer compare scalar count and limit
+        if (pattern3(preg_sized, wr, wr))               return (uint32_t)0b00100101001000000000010000010000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(preg_sized, xr, xr))               return (uint32_t)0b00100101001000000001010000010000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"whilelo", [](Operand** operands, int operand_length) {
+        // SVE integer compare scalar count and limit
+        if (pattern3(preg_sized, wr, wr))               return (uint32_t)0b00100101001000000000110000000000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(preg_sized, xr, xr))               return (uint32_t)0b00100101001000000001110000000000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"whilels", [](Operand** operands, int operand_length) {
+        // SVE integer compare scalar count and limit
+        if (pattern3(preg_sized, wr, wr))               return (uint32_t)0b00100101001000000000110000010000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(preg_sized, xr, xr))               return (uint32_t)0b00100101001000000001110000010000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
+    {"whilelt", [](Operand** operands, int operand_length) {
+        // SVE integer compare scalar count and limit
+        if (pattern3(preg_sized, wr, wr))               return (uint32_t)0b00100101001000000000010000000000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        if (pattern3(preg_sized, xr, xr))               return (uint32_t)0b00100101001000000001010000000000 | ENCODE_SVE_SIZE(0) | ENCODE_REGI(0, 0) | ENCODE_REGI(1, 5) | ENCODE_REGI(2, 16);
+        unreachable();
+    }},
     {"xpacd", [](Operand** operands, int operand_length) {
         if (pattern1(xr))                               return (uint32_t)0b11011010110000010100011111100000 | ENCODE_REGI(0, 0); // #7
         unreachable();
@@ -1662,221 +3861,755 @@ static std::unordered_map<std::string, std::function<uint32_t(Operand**, int)>>
 
 // --------------------------------------------------------------------
 // --------------------------------------------------------------------
-// Elf file Generator
+// Labels
 // --------------------------------------------------------------------
 // --------------------------------------------------------------------
 
-struct Elf64_Ehdr {
-	uint8_t    e_ident[16];
-	uint16_t   e_type;     
-	uint16_t   e_machine;  
-	uint32_t   e_version;
-	uintptr_t  e_entry;
-	uintptr_t  e_phoff;
-	uintptr_t  e_shoff;
-	uint32_t   e_flags;
-	uint16_t   e_ehsize;   
-	uint16_t   e_phentsize;
-	uint16_t   e_phnum;    
-	uint16_t   e_shentsize;
-	uint16_t   e_shnum;    
-	uint16_t   e_shstrndx; 
-};
-
-struct Elf64_Sym {
-	uint32_t   st_name;
-	uint8_t    st_info;
-	uint8_t    st_other;
-	uint16_t   st_shndx;
-	uintptr_t  st_value;
-	uint64_t   st_size;
-};
-
-struct Elf64_Shdr {
-	uint32_t   sh_name;
-	uint32_t   sh_type;
-	uintptr_t  sh_flags;
-	uintptr_t  sh_addr;
-	uintptr_t  sh_offset;
-	uintptr_t  sh_size;
-	uint32_t   sh_link;
-	uint32_t   sh_info;
-	uintptr_t  sh_addralign;
-	uintptr_t  sh_entsize;
+// Labels are interned to ids when first seen. Branches carry the id in Operand::imm
+// and are patched once every label offset is known.
+//
+// Names are stored back to back in one arena and found through an open-addressing table
+// of (hash, id) slots (linear probing, at most half full), so defining or looking up a
+// label is one hash and usually one probe, with no allocation per label. Keeping the hash
+// in the slot means probing past other names never touches `symbols`.
+
+struct Symbol {
+    uint64_t name_ofs;  // into symbol_names
+    int32_t offset;     // word index into code, -1 until encoded
+    int32_t size;       // bytes, -1 when not given by .size
+    uint32_t name_len;
+    uint8_t type;       // STT_* of the ELF symbol, set by .type
+    bool defined : 1;
+    bool global : 1;    // .globl
+    uint16_t section;   // index into sections
 };
 
-struct Elf64_Phdr {
-	uint32_t  ph_type;
-	uint32_t  ph_flags;
-	uint64_t  ph_off;
-	uint64_t  ph_vaddr;
-	uint64_t  ph_paddr;
-	uint64_t  ph_filesz;
-	uint64_t  ph_memsz;
-	uint64_t  ph_align;
+struct SymbolSlot {
+    uint32_t hash;
+    int32_t id; // -1 for an empty slot
 };
 
-#define EM_AARCH64 0xb7
+std::vector<char> symbol_names;
+std::vector<Symbol> symbols;
+std::vector<SymbolSlot> symbol_slots;
 
-#define STB_LOCAL 0
-#define STB_GLOBAL 1
+// FNV-1a
+inline uint32_t hash_name(const char* name, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return h;
+}
 
-#define STT_NOTYPE 0
-#define STT_SECTION 3
+inline const char* symbol_name(Symbol& sym) {
+    return symbol_names.data() + sym.name_ofs;
+}
 
-#define SHT_NULL 0
-#define SHT_PROGBITS 1
-#define SHT_SYMTAB 2
-#define SHT_STRTAB 3
+std::string label_name(int id) {
+    return std::string(symbol_name(symbols[id]), symbols[id].name_len);
+}
 
-#define SHF_ALLOC 0x2
-#define SHF_EXECINSTR 0x4
+void grow_symbol_slots() {
+    std::vector<SymbolSlot> old_slots(symbol_slots.empty() ? 512 : symbol_slots.size() * 2, SymbolSlot { 0, -1 });
+    std::swap(old_slots, symbol_slots);
 
-std::vector<uint32_t> code;
-uint8_t rodata[16] = {};
+    size_t mask = symbol_slots.size() - 1;
+    for (SymbolSlot& slot : old_slots) {
+        if (slot.id < 0) {
+            continue;
+        }
+        size_t i = slot.hash & mask;
+        while (symbol_slots[i].id >= 0) {
+            i = (i + 1) & mask;
+        }
+        symbol_slots[i] = slot;
+    }
+}
 
-void generate_elf() {
-    uint8_t strtab[16] = {
-        0x0,
-        '_', 's', 't', 'a', 'r', 't', '\0',
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+// returns the slot holding `name`, or the empty slot where it belongs
+inline size_t find_symbol_slot(const char* name, size_t len, uint32_t hash) {
+    size_t mask = symbol_slots.size() - 1;
+    size_t i = hash & mask;
+    while (symbol_slots[i].id >= 0) {
+        if (symbol_slots[i].hash == hash) {
+            Symbol& sym = symbols[symbol_slots[i].id];
+            if (sym.name_len == len && memcmp(symbol_name(sym), name, len) == 0) {
+                break;
+            }
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// -1 when the label has never been seen
+int find_label(const std::string& name) {
+    if (symbol_slots.empty()) {
+        return -1;
+    }
+    return symbol_slots[find_symbol_slot(name.data(), name.size(), hash_name(name.data(), name.size()))].id;
+}
+
+int label_id(const std::string& name) {
+    if ((symbols.size() + 1) * 2 > symbol_slots.size()) {
+        grow_symbol_slots();
+    }
+
+    uint32_t hash = hash_name(name.data(), name.size());
+    size_t slot = find_symbol_slot(name.data(), name.size(), hash);
+    if (symbol_slots[slot].id >= 0) {
+        return symbol_slots[slot].id;
+    }
+
+    int id = symbols.size();
+    symbols.push_back(Symbol { symbol_names.size(), -1, -1, (uint32_t)name.size(), 0, false, false, 0 });
+    symbol_names.insert(symbol_names.end(), name.begin(), name.end());
+    symbol_slots[slot] = SymbolSlot { hash, id };
+    return id;
+}
+
+// label is a symbol id, or the number of a numeric label
+struct BranchFixup {
+    size_t code_idx;
+    int section;
+    int label;
+    int line;
+    int file;
+};
+
+// Numeric local labels (`1:`, `1b`, `1f`) are never interned. While encoding, each number
+// keeps only its last definition, for `b` references, and the branches waiting for its
+// next definition, for `f` references, so every reference is resolved in O(1).
+
+#define NUMERIC_LABEL_MAX 65535
+
+struct NumericLabel {
+    int64_t offset = -1;               // word index of the last definition
+    std::vector<BranchFixup> pending;  // `f` references
+};
+
+std::vector<NumericLabel> numeric_labels; // indexed by label number, sized while encoding
+
+NumericLabel& numeric_label_slot(int n) {
+    if ((size_t)n >= numeric_labels.size()) {
+        numeric_labels.resize(n + 1);
+    }
+    return numeric_labels[n];
+}
+
+// Operand::val of a LABEL
+enum LabelRef {
+    LABEL_SYMBOL,   // imm is a symbol id
+    LABEL_BACKWARD, // `1b`, imm is the label number
+    LABEL_FORWARD,  // `1f`, imm is the label number
+};
+
+Operand* new_label(int id) {
+    Operand* op = new Operand;
+    op->kind = LABEL;
+    op->imm = id;
+    op->val = LABEL_SYMBOL;
+
+    return op;
+}
+
+Operand* new_numeric_label(int64_t n, LabelRef ref) {
+    Operand* op = new Operand;
+    op->kind = LABEL;
+    op->imm = n;
+    op->val = ref;
+
+    return op;
+}
+
+// --------------------------------------------------------------------
+// --------------------------------------------------------------------
+// Expressions
+// --------------------------------------------------------------------
+// --------------------------------------------------------------------
+
+// Immediates and offsets are constant expressions over numbers, .equ/.set symbols and labels.
+// Everything that does not involve a label is folded while parsing. The rest is kept in
+// Operand::expr, encoded with a placeholder and re-encoded once every label offset is known.
+
+enum ExprKind {
+    EXPR_NUM,    // value
+    EXPR_LABEL,  // value is a symbol id
+    EXPR_UNARY,  // op lhs
+    EXPR_BINARY, // lhs op rhs
+};
+
+struct Expr {
+    ExprKind kind;
+    char op; // see binary_ops for the binary ones
+    int64_t value;
+    Expr* lhs;
+    Expr* rhs;
+};
+
+std::unordered_map<std::string, Expr*> equ_symbols; // .equ/.set name -> value
+
+struct BinaryOp {
+    std::string token;
+    char op;
+    int precedence; // as in C
+};
+
+// two character tokens first
+std::vector<BinaryOp> binary_ops = {
+    {"<<", 'L', 7}, {">>", 'R', 7}, {"<=", 'l', 6}, {">=", 'g', 6}, {"==", '=', 5}, {"!=", '!', 5}, {"&&", 'A', 1}, {"||", 'O', 0},
+    {"*",  '*', 9}, {"/",  '/', 9}, {"%",  '%', 9}, {"+",  '+', 8}, {"-",  '-', 8}, {"<",  '<', 6}, {">",  '>', 6},
+    {"&",  '&', 4}, {"^",  '^', 3}, {"|",  '|', 2},
+};
+
+Expr* new_expr(ExprKind kind, char op, int64_t value, Expr* lhs, Expr* rhs) {
+    Expr* e = new Expr;
+    e->kind = kind;
+    e->op = op;
+    e->value = value;
+    e->lhs = lhs;
+    e->rhs = rhs;
+
+    return e;
+}
+
+int64_t apply_unary(char op, int64_t a) {
+    switch (op) {
+        case '+': return a;
+        case '-': return (int64_t)(0 - (uint64_t)a);
+        case '~': return ~a;
+        case '!': return !a;
+    }
+    unreachable();
+}
+
+// false on division by zero
+bool apply_binary(char op, int64_t a, int64_t b, int64_t* result) {
+    uint64_t ua = a, ub = b;
+    switch (op) {
+        case '+': *result = ua + ub; return true;
+        case '-': *result = ua - ub; return true;
+        case '*': *result = ua * ub; return true;
+        case '/':
+        case '%':
+            if (b == 0) {
+                return false;
+            }
+            if (a == INT64_MIN && b == -1) {
+                *result = op == '/' ? a : 0;
+            } else {
+                *result = op == '/' ? a / b : a % b;
+            }
+            return true;
+        case 'L': *result = ub >= 64 ? 0 : ua << ub; return true;
+        case 'R': *result = ub >= 64 ? (a < 0 ? -1 : 0) : a >> ub; return true;
+        case '&': *result = a & b; return true;
+        case '^': *result = a ^ b; return true;
+        case '|': *result = a | b; return true;
+        case '<': *result = a < b; return true;
+        case '>': *result = a > b; return true;
+        case 'l': *result = a <= b; return true;
+        case 'g': *result = a >= b; return true;
+        case '=': *result = a == b; return true;
+        case '!': *result = a != b; return true;
+        case 'A': *result = a && b; return true;
+        case 'O': *result = a || b; return true;
+    }
+    unreachable();
+}
+
+// --------------------------------------------------------------------
+// --------------------------------------------------------------------
+// Elf file Generator
+// --------------------------------------------------------------------
+// --------------------------------------------------------------------
+
+struct Elf64_Ehdr {
+	uint8_t    e_ident[16];
+	uint16_t   e_type;     
+	uint16_t   e_machine;  
+	uint32_t   e_version;
+	uintptr_t  e_entry;
+	uintptr_t  e_phoff;
+	uintptr_t  e_shoff;
+	uint32_t   e_flags;
+	uint16_t   e_ehsize;   
+	uint16_t   e_phentsize;
+	uint16_t   e_phnum;    
+	uint16_t   e_shentsize;
+	uint16_t   e_shnum;    
+	uint16_t   e_shstrndx; 
+};
+
+struct Elf64_Sym {
+	uint32_t   st_name;
+	uint8_t    st_info;
+	uint8_t    st_other;
+	uint16_t   st_shndx;
+	uintptr_t  st_value;
+	uint64_t   st_size;
+};
+
+struct Elf64_Shdr {
+	uint32_t   sh_name;
+	uint32_t   sh_type;
+	uintptr_t  sh_flags;
+	uintptr_t  sh_addr;
+	uintptr_t  sh_offset;
+	uintptr_t  sh_size;
+	uint32_t   sh_link;
+	uint32_t   sh_info;
+	uintptr_t  sh_addralign;
+	uintptr_t  sh_entsize;
+};
+
+struct Elf64_Phdr {
+	uint32_t  ph_type;
+	uint32_t  ph_flags;
+	uint64_t  ph_off;
+	uint64_t  ph_vaddr;
+	uint64_t  ph_paddr;
+	uint64_t  ph_filesz;
+	uint64_t  ph_memsz;
+	uint64_t  ph_align;
+};
+
+struct Elf64_Rela {
+	uint64_t  r_offset;
+	uint64_t  r_info;
+	int64_t   r_addend;
+};
+
+#define ET_REL 1
+#define ET_EXEC 2
+
+#define EM_AARCH64 0xb7
+
+#define PT_LOAD 1
+
+#define PF_X 0x1
+#define PF_W 0x2
+#define PF_R 0x4
+
+#define STB_LOCAL 0
+#define STB_GLOBAL 1
+
+#define STT_NOTYPE 0
+#define STT_OBJECT 1
+#define STT_FUNC 2
+#define STT_SECTION 3
+
+#define SHN_UNDEF 0
+
+#define SHT_NULL 0
+#define SHT_PROGBITS 1
+#define SHT_SYMTAB 2
+#define SHT_STRTAB 3
+#define SHT_RELA 4
+
+#define SHF_WRITE 0x1
+#define SHF_ALLOC 0x2
+#define SHF_EXECINSTR 0x4
+#define SHF_INFO_LINK 0x40
+
+#define R_AARCH64_ABS64 257
+#define R_AARCH64_ABS32 258
+#define R_AARCH64_TSTBR14 279
+#define R_AARCH64_CONDBR19 280
+#define R_AARCH64_JUMP26 282
+#define R_AARCH64_CALL26 283
+
+std::vector<uint32_t> code;
+
+// Every section is one contiguous range of code, executable sections first, then read-only
+// and writable ones, so that --exec maps each kind with a single segment.
+struct Section {
+    std::string name;
+    uint64_t flags;   // SHF_*
+    int64_t align;    // largest alignment requested by .p2align/.balign or a literal pool
+    bool function;    // created by --function-sections
+    size_t code_idx;  // first word in code, set while encoding
+    size_t size;      // in words
+    size_t code_end;  // after the last instruction, trailing literal pools and padding excluded
+    uint64_t addr;    // --exec
+};
+
+// with a .rela section each, and st_shndx below SHN_LORESERVE
+#define SECTION_MAX 0x7f00
+
+std::vector<Section> sections = { Section { ".text", SHF_ALLOC | SHF_EXECINSTR, 4, false, 0, 0, 0, 0 } };
+std::unordered_map<std::string, int> section_ids = { { ".text", 0 } };
+int current_section = 0; // while encoding
+
+bool function_sections = false;
+
+// the id of section `name`, created with `flags` on first use; -1 when there are too many
+int section_id(std::string name, uint64_t flags) {
+    auto it = section_ids.find(name);
+    if (it != section_ids.end()) {
+        return it->second;
+    }
+    if (sections.size() == SECTION_MAX) {
+        return -1;
+    }
+    section_ids[name] = sections.size();
+    sections.push_back(Section { name, flags, 4, false, 0, 0, 0, 0 });
+    return sections.size() - 1;
+}
+
+// 0 executable, 1 read-only, 2 writable
+inline int section_kind(Section& sec) {
+    if (sec.flags & SHF_EXECINSTR) {
+        return 0;
+    }
+    return sec.flags & SHF_WRITE ? 2 : 1;
+}
+
+// --exec: a static executable whose segments are aligned to the largest AArch64 page size
+bool emit_exec = false;
+#define EXEC_BASE 0x400000
+#define EXEC_PAGE 0x10000
+
+// one PT_LOAD per kind of section, the executable one always
+int exec_segments() {
+    bool kinds[3] = { true, false, false };
+    for (Section& sec : sections) {
+        kinds[section_kind(sec)] = true;
+    }
+    return kinds[0] + kinds[1] + kinds[2];
+}
+
+// code follows the ELF header and, for --exec, the program headers
+int code_file_offset() {
+    int64_t align = 4;
+    for (Section& sec : sections) {
+        align = std::max(align, sec.align);
+    }
+    int headers = sizeof(Elf64_Ehdr) + (emit_exec ? exec_segments() * sizeof(Elf64_Phdr) : 0);
+    return (headers + align - 1) / align * align;
+}
+
+// section ids in code order
+std::vector<int> section_order() {
+    std::vector<int> order(sections.size());
+    for (size_t i = 0; i < sections.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [](int a, int b) {
+        return std::make_pair(sections[a].code_idx, section_kind(sections[a])) < std::make_pair(sections[b].code_idx, section_kind(sections[b]));
+    });
+    return order;
+}
+
+// Relocatable objects use section-relative addresses. In an executable the first segment maps
+// the file from offset 0 at EXEC_BASE, and every later segment starts on a new page at an
+// address congruent to its file offset.
+void layout_sections() {
+    if (!emit_exec) {
+        return;
+    }
+    uint64_t code_ofs = code_file_offset();
+    uint64_t seg_addr = EXEC_BASE, seg_ofs = 0, end = EXEC_BASE;
+    int kind = 0;
+    for (int id : section_order()) {
+        Section& sec = sections[id];
+        uint64_t ofs = code_ofs + sec.code_idx * 4;
+        if (section_kind(sec) != kind) {
+            kind = section_kind(sec);
+            seg_ofs = ofs;
+            seg_addr = (end + EXEC_PAGE - 1) / EXEC_PAGE * EXEC_PAGE + ofs % EXEC_PAGE;
+        }
+        sec.addr = seg_addr + (ofs - seg_ofs);
+        end = sec.addr + sec.size * 4;
+    }
+}
+
+// branches into another section, relocated against the symbol of the target section
+struct CodeReloc {
+    size_t code_idx;
+    int section; // of the branch
+    uint32_t type;
+    int target;  // section, or -1 - the label id of an undefined global
+    int64_t addend;
+};
+
+std::vector<CodeReloc> code_relocs;
+
+// -g: DebugReloc::section of the DWARF sections, user sections are >= 0
+#define DEBUG_ABBREV -1
+#define DEBUG_LINE -2
+#define DEBUG_RNGLISTS -3
+
+struct DebugReloc {
+    uint64_t offset;
+    uint32_t type;
+    int section; // relocated against the section symbol of this section
+    int64_t addend;
+};
+
+bool emit_debug = false;
+bool debug_ranges = false; // more than one executable section, described by .debug_rnglists
+std::vector<uint8_t> debug_abbrev;
+std::vector<uint8_t> debug_info;
+std::vector<uint8_t> debug_line;
+std::vector<uint8_t> debug_rnglists;
+std::vector<DebugReloc> debug_info_relocs;
+std::vector<DebugReloc> debug_line_relocs;
+std::vector<DebugReloc> debug_rnglists_relocs;
+
+void generate_elf() {
+    std::vector<uint8_t> strtab = { 0x0 };
+
+    auto add_str = [&](const char* name, size_t len) {
+        uint32_t ofs = strtab.size();
+        strtab.insert(strtab.end(), name, name + len);
+        strtab.push_back(0);
+        return ofs;
     };
 
-	int null_nameofs = 0;
+    int code_ofs = code_file_offset();
 
-    int start_nameofs = null_nameofs + strlen("") + 1;
+    // Section header indices: the user sections follow the null section, then come their
+    // .rela sections, .strtab, .symtab, .shstrtab and the DWARF sections.
+    // The symbol of a relocation is filled in once the symbol table is final.
+    std::vector<std::vector<Elf64_Rela>> relas(sections.size());
+    int rela_sections = 0;
+    for (CodeReloc& r : code_relocs) {
+        rela_sections += relas[r.section].empty();
+        relas[r.section].push_back(Elf64_Rela { (r.code_idx - sections[r.section].code_idx) * 4, r.type, r.addend });
+    }
+    uint32_t strtab_index = 1 + sections.size() + rela_sections;
+    uint32_t symtab_index = strtab_index + 1;
+    uint32_t shstrtab_index = symtab_index + 1;
+    uint32_t debug_index = shstrtab_index + 1;
 
-    Elf64_Sym symtab[4] = {
+    // section symbols: the user sections in order, then the DWARF sections relocations refer to
+    std::vector<Elf64_Sym> symtab = {
         Elf64_Sym { // null
-            st_name: (uint32_t)null_nameofs,
-            st_info: ((STB_LOCAL << 4) + (STT_NOTYPE & 0xf)),
-        },
-        Elf64_Sym { // .rodata
             st_name: 0,
-            st_info: ((STB_LOCAL << 4) + (STT_SECTION & 0xf)),
-			st_shndx: 2,
+            st_info: ((STB_LOCAL << 4) + (STT_NOTYPE & 0xf)),
         },
-        Elf64_Sym { // .text
+    };
+    for (size_t i = 0; i < sections.size(); i++) {
+        symtab.push_back(Elf64_Sym {
             st_name: 0,
             st_info: ((STB_LOCAL << 4) + (STT_SECTION & 0xf)),
-			st_shndx: 1,
-        },
-        Elf64_Sym { // _start
-			st_name: (uint32_t)start_nameofs,
-			st_info: ((STB_GLOBAL << 4) + (STT_NOTYPE & 0xf)),
-			st_shndx: 1,
-			st_value: 0,
-		},
+            st_shndx: (uint16_t)(1 + i),
+            st_value: (uintptr_t)sections[i].addr,
+        });
+    }
+    // .debug_abbrev, .debug_line and .debug_rnglists
+    int debug_symbols = sections.size() + 1;
+    if (emit_debug) {
+        for (uint32_t index : { debug_index, debug_index + 3, debug_index + 5 }) {
+            if (index == debug_index + 5 && !debug_ranges) {
+                break;
+            }
+            symtab.push_back(Elf64_Sym {
+                st_name: 0,
+                st_info: ((STB_LOCAL << 4) + (STT_SECTION & 0xf)),
+                st_shndx: (uint16_t)index,
+            });
+        }
+    }
+
+    // One pass over the labels: locals go straight into symtab, globals are appended after
+    // them as the ELF spec requires. .L labels stay assembler-local.
+    auto address = [&](Symbol& sym) {
+        return sections[sym.section].addr + (sym.offset - sections[sym.section].code_idx) * 4;
+    };
+
+    // an executable starts at _start, an object leaves the entry point to the linker
+    int start = find_label("_start");
+    if (emit_exec && (start < 0 || !symbols[start].defined)) {
+        std::cerr << "error: an executable needs a `_start` label" << std::endl;
+        exit(1);
+    }
+    uint64_t entry = emit_exec ? address(symbols[start]) : 0;
+
+    symtab.reserve(symtab.size() + symbols.size());
+    strtab.reserve(symbol_names.size() + symbols.size());
+
+    std::vector<Elf64_Sym> globals;
+    std::unordered_map<int, uint32_t> undefined_globals; // label id -> index in globals
+
+    // functions without .size extend up to the next emitted label or the last instruction of
+    // their section, patched below
+    std::vector<int64_t> label_offsets;
+    std::vector<std::pair<bool, size_t>> unsized_functions; // (global, index)
+    std::vector<int> unsized_sections;
+
+    for (Symbol& sym : symbols) {
+        const char* name = symbol_name(sym);
+        if ((!sym.defined && !sym.global) || (sym.name_len >= 2 && name[0] == '.' && name[1] == 'L')) {
+            continue;
+        }
+        bool global = sym.global;
+
+        if (emit_exec && !sym.defined) {
+            std::cerr << "error: undefined symbol `" << std::string(name, sym.name_len) << "` in an executable" << std::endl;
+            exit(1);
+        }
+
+        std::vector<Elf64_Sym>& table = global ? globals : symtab;
+        if (!sym.defined) {
+            undefined_globals[&sym - symbols.data()] = globals.size();
+        }
+        if (sym.defined) {
+            label_offsets.push_back(sym.offset);
+        }
+        if (sym.defined && sym.type == STT_FUNC && sym.size < 0) {
+            unsized_functions.push_back({ global, table.size() });
+            unsized_sections.push_back(sym.section);
+        }
+
+        table.push_back(Elf64_Sym {
+            st_name: add_str(name, sym.name_len),
+            st_info: (uint8_t)(((global ? STB_GLOBAL : STB_LOCAL) << 4) + (sym.type & 0xf)),
+            st_shndx: (uint16_t)(sym.defined ? 1 + sym.section : SHN_UNDEF),
+            st_value: (uintptr_t)(sym.defined ? address(sym) : 0),
+            st_size: (uint64_t)(sym.size >= 0 ? sym.size : 0),
+        });
+    }
+
+    std::sort(label_offsets.begin(), label_offsets.end());
+    for (size_t k = 0; k < unsized_functions.size(); k++) {
+        auto& [global, i] = unsized_functions[k];
+        Section& sec = sections[unsized_sections[k]];
+        Elf64_Sym& sym = global ? globals[i] : symtab[i];
+        int64_t offset = sec.code_idx + (sym.st_value - sec.addr) / 4;
+        auto next = std::upper_bound(label_offsets.begin(), label_offsets.end(), offset);
+        int64_t end = std::max((int64_t)sec.code_end, offset);
+        sym.st_size = (std::min(next == label_offsets.end() ? end : *next, end) - offset) * 4;
+    }
+
+    uint32_t local_symbols = symtab.size();
+    symtab.insert(symtab.end(), globals.begin(), globals.end());
+
+    // section symbols follow the null symbol, undefined globals are after the locals
+    std::vector<size_t> next_rela(sections.size(), 0);
+    for (CodeReloc& r : code_relocs) {
+        uint64_t sym = r.target >= 0 ? 1 + r.target : local_symbols + undefined_globals[-1 - r.target];
+        relas[r.section][next_rela[r.section]++].r_info |= sym << 32;
+    }
+
+    // DWARF relocations against the section symbols
+    auto to_rela = [&](std::vector<DebugReloc>& relocs) {
+        std::vector<Elf64_Rela> rela;
+        for (DebugReloc& r : relocs) {
+            uint64_t sym = r.section >= 0 ? 1 + r.section : debug_symbols - 1 - r.section;
+            rela.push_back(Elf64_Rela { r.offset, (sym << 32) | r.type, r.addend });
+        }
+        return rela;
     };
+    std::vector<Elf64_Rela> info_rela = to_rela(debug_info_relocs);
+    std::vector<Elf64_Rela> line_rela = to_rela(debug_line_relocs);
+    std::vector<Elf64_Rela> rnglists_rela = to_rela(debug_rnglists_relocs);
 
-	uint8_t shstrtab[64] = {
-		'\0',
-		'.', 't', 'e', 'x', 't', '\0',
-		'.', 'r', 'o', 'd', 'a', 't', 'a', '\0',
-		'.', 's', 't', 'r', 't', 'a', 'b', '\0',
-		'.', 's', 'y', 'm', 't', 'a', 'b', '\0',
-		'.', 's', 'h', 's', 't', 'r', 't', 'a', 'b', '\0',
-		// padding
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    std::vector<uint8_t> shstrtab = { 0x0 };
+
+    auto add_shstr = [&](std::string name) {
+        uint32_t ofs = shstrtab.size();
+        shstrtab.insert(shstrtab.end(), name.begin(), name.end());
+        shstrtab.push_back(0);
+        return ofs;
     };
 
-	int text_nameofs = null_nameofs + strlen("") + 1;
-	int rodata_nameofs = text_nameofs + strlen(".text") + 1;
-	int strtab_nameofs = rodata_nameofs + strlen(".rodata") + 1;
-	int symtab_nameofs = strtab_nameofs + strlen(".strtab") + 1;
-	int shstrtab_nameofs = symtab_nameofs + strlen(".symtab") + 1;
-
-	int code_ofs = sizeof(Elf64_Ehdr);
-	int code_size = code.size() * sizeof(uint32_t);
-
-	int rodata_ofs = code_ofs + code_size;
-	int rodata_size = sizeof(rodata);
-
-	int strtab_ofs = rodata_ofs + rodata_size;
-	int strtab_size = sizeof(strtab);
-
-	int symtab_ofs = strtab_ofs + strtab_size;
-	int symtab_size = sizeof(symtab);
-
-	int shstrtab_ofs = symtab_ofs + symtab_size;
-	int shstrtab_size = sizeof(shstrtab);
-
-	int sectionheader_ofs = shstrtab_ofs + shstrtab_size;
-
-	Elf64_Shdr section_headers[6] = {
-		// NULL
-		Elf64_Shdr {
-			sh_name: (uint32_t)null_nameofs,
-			sh_type: SHT_NULL,
-		},
-		// .text
-		Elf64_Shdr {
-			sh_name: (uint32_t)text_nameofs,
-			sh_type: SHT_PROGBITS,
-			sh_flags: (uintptr_t)(SHF_ALLOC | SHF_EXECINSTR),
-			sh_addr: 0,
-			sh_offset: (uintptr_t)code_ofs,
-			sh_size: (uintptr_t)code_size,
-			sh_link: 0,
-			sh_info: 0,
-			sh_addralign: (uintptr_t)1,
-			sh_entsize: 0,
-		},
-		// .rodata
-		Elf64_Shdr {
-			sh_name: (uint32_t)rodata_nameofs,
-			sh_type: SHT_PROGBITS,
-			sh_flags: (uintptr_t)SHF_ALLOC,
-			sh_addr: 0,
-			sh_offset: (uintptr_t)rodata_ofs,
-			sh_size: (uintptr_t)rodata_size,
-			sh_link: 0,
-			sh_info: 0,
-			sh_addralign: (uintptr_t)1,
-			sh_entsize: 0,
-		},
-		// .strtab
-		Elf64_Shdr {
-			sh_name: (uint32_t)strtab_nameofs,
-			sh_type: SHT_STRTAB,
-			sh_flags: (uintptr_t)0,
-			sh_addr: 0,
-			sh_offset: (uintptr_t)strtab_ofs,
-			sh_size: (uintptr_t)strtab_size,
-			sh_link: 0,
-			sh_info: 0,
-			sh_addralign: (uintptr_t)1,
-			sh_entsize: 0,
-		},
-		// .symtab
-		Elf64_Shdr {
-			sh_name: (uint32_t)symtab_nameofs,
-			sh_type: SHT_SYMTAB,
-			sh_flags: (uintptr_t)0,
-			sh_addr: 0,
-			sh_offset: (uintptr_t)symtab_ofs,
-			sh_size: (uintptr_t)symtab_size,
-			sh_link: 3, // section number of .strtab
-			sh_info: 3, // Number of local symbols
-			sh_addralign: (uintptr_t)8,
-			sh_entsize: (uintptr_t)sizeof(Elf64_Sym),
-		},
-		// .shstrtab
-		Elf64_Shdr {
-			sh_name: (uint32_t)shstrtab_nameofs,
-			sh_type: SHT_STRTAB,
-			sh_flags: 0,
-			sh_addr: 0,
-			sh_offset: (uintptr_t)shstrtab_ofs,
-			sh_size: (uintptr_t)shstrtab_size,
-			sh_link: 0,
-			sh_info: 0,
-			sh_addralign: (uintptr_t)1,
-			sh_entsize: 0,
-		},
+    // every section but the null one and the user sections, written in this order after code
+    std::vector<Elf64_Shdr> section_headers = {
+        Elf64_Shdr { // NULL
+            sh_name: 0,
+            sh_type: SHT_NULL,
+        },
     };
+    std::vector<const void*> contents = { nullptr };
+
+    auto add_section = [&](std::string name, uint32_t type, uint64_t flags, uint32_t link, uint32_t info,
+                           const void* data, size_t size, size_t align, size_t entsize) {
+        section_headers.push_back(Elf64_Shdr {
+            sh_name: add_shstr(name),
+            sh_type: type,
+            sh_flags: (uintptr_t)flags,
+            sh_addr: 0,
+            sh_offset: 0,
+            sh_size: (uintptr_t)size,
+            sh_link: link,
+            sh_info: info,
+            sh_addralign: (uintptr_t)align,
+            sh_entsize: (uintptr_t)entsize,
+        });
+        contents.push_back(data);
+    };
+
+    for (Section& sec : sections) {
+        add_section(sec.name, SHT_PROGBITS, sec.flags, 0, 0, nullptr, sec.size * 4, sec.align, 0);
+        section_headers.back().sh_addr = sec.addr;
+        section_headers.back().sh_offset = code_ofs + sec.code_idx * 4;
+    }
+    for (size_t i = 0; i < sections.size(); i++) {
+        if (!relas[i].empty()) {
+            add_section(".rela" + sections[i].name, SHT_RELA, SHF_INFO_LINK, symtab_index, 1 + i,
+                        relas[i].data(), relas[i].size() * sizeof(Elf64_Rela), 8, sizeof(Elf64_Rela));
+        }
+    }
+    add_section(".strtab", SHT_STRTAB, 0, 0, 0, strtab.data(), strtab.size(), 1, 0);
+    add_section(".symtab", SHT_SYMTAB, 0, strtab_index, local_symbols, symtab.data(), symtab.size() * sizeof(Elf64_Sym), 8, sizeof(Elf64_Sym));
+    add_section(".shstrtab", SHT_STRTAB, 0, 0, 0, nullptr, 0, 1, 0);
+    if (emit_debug) {
+        add_section(".debug_abbrev", SHT_PROGBITS, 0, 0, 0, debug_abbrev.data(), debug_abbrev.size(), 1, 0);
+        add_section(".debug_info", SHT_PROGBITS, 0, 0, 0, debug_info.data(), debug_info.size(), 1, 0);
+        add_section(".rela.debug_info", SHT_RELA, SHF_INFO_LINK, symtab_index, debug_index + 1,
+                    info_rela.data(), info_rela.size() * sizeof(Elf64_Rela), 8, sizeof(Elf64_Rela));
+        add_section(".debug_line", SHT_PROGBITS, 0, 0, 0, debug_line.data(), debug_line.size(), 1, 0);
+        add_section(".rela.debug_line", SHT_RELA, SHF_INFO_LINK, symtab_index, debug_index + 3,
+                    line_rela.data(), line_rela.size() * sizeof(Elf64_Rela), 8, sizeof(Elf64_Rela));
+        if (debug_ranges) {
+            add_section(".debug_rnglists", SHT_PROGBITS, 0, 0, 0, debug_rnglists.data(), debug_rnglists.size(), 1, 0);
+            add_section(".rela.debug_rnglists", SHT_RELA, SHF_INFO_LINK, symtab_index, debug_index + 5,
+                        rnglists_rela.data(), rnglists_rela.size() * sizeof(Elf64_Rela), 8, sizeof(Elf64_Rela));
+        }
+    }
+    // all names are in, so .shstrtab is final
+    section_headers[shstrtab_index].sh_size = shstrtab.size();
+    contents[shstrtab_index] = shstrtab.data();
+
+    // offsets of everything after code, each aligned
+    uint64_t ofs = code_ofs + code.size() * 4;
+    for (size_t i = strtab_index - rela_sections; i < section_headers.size(); i++) {
+        Elf64_Shdr& shdr = section_headers[i];
+        ofs = (ofs + shdr.sh_addralign - 1) / shdr.sh_addralign * shdr.sh_addralign;
+        shdr.sh_offset = ofs;
+        ofs += shdr.sh_size;
+    }
+    uint64_t sectionheader_ofs = (ofs + 7) / 8 * 8;
+
+    // --exec: the headers and the executable sections in an R+X segment, then an R segment for
+    // read-only and an RW segment for writable sections
+    std::vector<Elf64_Phdr> program_headers;
+    if (emit_exec) {
+        int kind = -1;
+        for (int id : section_order()) {
+            Section& sec = sections[id];
+            uint64_t sec_ofs = code_ofs + sec.code_idx * 4;
+            if (section_kind(sec) != kind) {
+                kind = section_kind(sec);
+                uint64_t seg_ofs = kind == 0 ? 0 : sec_ofs;
+                uint64_t seg_addr = kind == 0 ? EXEC_BASE : sec.addr;
+                program_headers.push_back(Elf64_Phdr {
+                    ph_type: PT_LOAD,
+                    ph_flags: (uint32_t)(kind == 0 ? PF_R | PF_X : kind == 1 ? PF_R : PF_R | PF_W),
+                    ph_off: seg_ofs,
+                    ph_vaddr: seg_addr,
+                    ph_paddr: seg_addr,
+                    ph_align: EXEC_PAGE,
+                });
+            }
+            Elf64_Phdr& seg = program_headers.back();
+            seg.ph_filesz = seg.ph_memsz = sec_ofs + sec.size * 4 - seg.ph_off;
+        }
+    }
+    int phnum = program_headers.size();
 
     // https://github.com/ARM-software/abi-aa/blob/main/aaelf64/aaelf64.rst#elf-header
 
@@ -1896,298 +4629,4228 @@ void generate_elf() {
 			0x00,
 			0x00,
         },
-		e_type: 1, // 1 = realocatable
+		e_type: (uint16_t)(emit_exec ? ET_EXEC : ET_REL),
 		e_machine: EM_AARCH64, 
 		e_version: 1,
-		e_entry: 0,
-		e_phoff: 0,
+		e_entry: (uintptr_t)entry,
+		e_phoff: (uintptr_t)(phnum ? sizeof(Elf64_Ehdr) : 0),
 		e_shoff: (uintptr_t)sectionheader_ofs,
 		e_flags: 0x0,
 		e_ehsize: sizeof(Elf64_Ehdr),
 		e_phentsize: sizeof(Elf64_Phdr),
-		e_phnum: 0,
+		e_phnum: (uint16_t)phnum,
 		e_shentsize: sizeof(Elf64_Shdr),
-		e_shnum: sizeof(section_headers) / sizeof(Elf64_Shdr),
-		e_shstrndx: sizeof(section_headers) / sizeof(Elf64_Shdr) - 1,
+		e_shnum: (uint16_t)section_headers.size(),
+		e_shstrndx: (uint16_t)shstrtab_index,
 	};
 
     // elf header
     write(1, reinterpret_cast<char*>(&ehdr), sizeof(Elf64_Ehdr));
 
-    // .text
+    // program headers
+    write(1, reinterpret_cast<char*>(program_headers.data()), phnum * sizeof(Elf64_Phdr));
+
+    // padding up to the code alignment
+    std::vector<uint8_t> padding(code_ofs - sizeof(Elf64_Ehdr) - phnum * sizeof(Elf64_Phdr), 0);
+    write(1, padding.data(), padding.size());
+
+    // the user sections
     write(1, code.data(), code.size() * sizeof(uint32_t));
 
-    // .rodata
-    write(1, reinterpret_cast<char*>(&rodata), sizeof(rodata));
+    // .rela sections, .strtab, .symtab, .shstrtab and the DWARF sections
+    ofs = code_ofs + code.size() * 4;
+    for (size_t i = strtab_index - rela_sections; i < section_headers.size(); i++) {
+        padding.assign(section_headers[i].sh_offset - ofs, 0);
+        write(1, padding.data(), padding.size());
+        write(1, contents[i], section_headers[i].sh_size);
+        ofs = section_headers[i].sh_offset + section_headers[i].sh_size;
+    }
+
+    // section headers
+    padding.assign(sectionheader_ofs - ofs, 0);
+    write(1, padding.data(), padding.size());
+    write(1, section_headers.data(), section_headers.size() * sizeof(Elf64_Shdr));
+}
+
+// --------------------------------------------------------------------
+// --------------------------------------------------------------------
+// Peephole optimizer (-O)
+// --------------------------------------------------------------------
+// --------------------------------------------------------------------
+
+struct Instr {
+    std::string name;
+    Operand** operands;
+    int operand_length;
+    int line;
+    int file = 0; // index into source_files
+};
+
+std::vector<Instr> instrs;
+
+// 0 is the input file, .include adds the others
+struct SourceFile {
+    std::string path; // as opened, for diagnostics
+    std::string content;
+    bool once;         // .pragma once
+    std::string guard; // the whole file is inside `.ifndef guard`
+};
+
+std::vector<SourceFile> source_files;
+
+// --pipeline encodes while the parser may still add files, so paths for diagnostics
+// raised while encoding are read under the lock
+std::mutex source_files_lock;
+
+std::string source_path(int file) {
+    std::lock_guard<std::mutex> guard(source_files_lock);
+    return source_files[file].path;
+}
 
-    // .strtab
-    write(1, reinterpret_cast<char*>(&strtab), sizeof(strtab));
+bool optimize = false;
+
+std::string format_operand(Operand* op) {
+    switch (op->kind) {
+        case XR:                return op->regi_bits == 31 ? "xzr" : "x" + std::to_string(op->regi_bits);
+        case WR:                return op->regi_bits == 31 ? "wzr" : "w" + std::to_string(op->regi_bits);
+        case XSP:               return "sp";
+        case WSP:               return "wsp";
+        case IMM:               return "#" + std::to_string(op->imm);
+        case MEM_OP_BASE:       return "[" + format_operand(op->base_register) + "]";
+        case MEM_OP_IMM_OFFSET: return "[" + format_operand(op->base_register) + ", " + format_operand(op->offset) + "]";
+        default:                return "...";
+    }
+}
 
-    // .symtab
-    for (int i = 0; i < sizeof(symtab)/sizeof(Elf64_Sym); i++) {
-        write(1, reinterpret_cast<char*>(&(symtab[i])), sizeof(Elf64_Sym));
+// b.<cond> is kept in the instruction stream as `b cond, label`
+std::string instr_mnemonic(Instr& in) {
+    if (in.name == "b" && in.operand_length == 2 && in.operands[0]->kind == COND) {
+        return std::string("b.") + cond_names[in.operands[0]->val];
+    }
+    return in.name;
+}
+
+std::string format_instr(Instr& in) {
+    std::string str = in.name;
+    for (int i = 0; i < in.operand_length; i++) {
+        str += (i == 0 ? " " : ", ") + format_operand(in.operands[i]);
+    }
+    return str;
+}
+
+void report_rewrite(std::string file_path, int line, std::string msg) {
+    std::cerr << file_path << ":" << line << ": peephole: " << msg << std::endl;
+}
+
+inline bool same_regi(Operand* a, Operand* b) {
+    return a->kind == b->kind && a->regi_bits == b->regi_bits;
+}
+
+// `mov x0, x0` and `add x0, x0, #0` leave the register untouched.
+// The 32bit forms are kept since writing a w register clears the upper half of the x register.
+bool is_redundant(Instr& in) {
+    Operand** operands = in.operands;
+    int operand_length = in.operand_length;
+
+    if (in.name == "mov" && operand_length == 2 && pattern2(xr_or_xsp, xr_or_xsp)) {
+        return same_regi(operands[0], operands[1]);
+    }
+    if ((in.name == "add" || in.name == "sub") && operand_length == 3 && pattern3(xr_or_xsp, xr_or_xsp, imm)) {
+        return same_regi(operands[0], operands[1]) && operands[2]->imm == 0 && !operands[2]->expr;
+    }
+    return false;
+}
+
+// [base] and [base, #imm]
+bool mem_op_offset(Operand* op, int* offset) {
+    if (op->kind == MEM_OP_BASE) {
+        *offset = 0;
+        return true;
+    }
+    if (op->kind == MEM_OP_IMM_OFFSET && !op->offset->expr) {
+        *offset = op->offset->imm;
+        return true;
+    }
+    return false;
+}
+
+// ldr xA, [xB, #n]; ldr xC, [xB, #n+8] -> ldp xA, xC, [xB, #n]
+// str xA, [xB, #n]; str xC, [xB, #n+8] -> stp xA, xC, [xB, #n]
+bool fuse_pair(Instr& first, Instr& second, Instr* fused) {
+    if ((first.name != "ldr" && first.name != "str") || second.name != first.name || first.operand_length != 2 || second.operand_length != 2) {
+        return false;
+    }
+    bool load = first.name == "ldr";
+
+    Operand* rt1 = first.operands[0];
+    Operand* rt2 = second.operands[0];
+    if (rt1->kind != rt2->kind || (rt1->kind != XR && rt1->kind != WR)) {
+        return false;
+    }
+
+    int offset1, offset2;
+    if (!mem_op_offset(first.operands[1], &offset1) || !mem_op_offset(second.operands[1], &offset2)) {
+        return false;
+    }
+
+    Operand* base = first.operands[1]->base_register;
+    if (!same_regi(base, second.operands[1]->base_register)) {
+        return false;
+    }
+
+    // the second load must still see the original base, and both loads must target distinct registers
+    if (load && (same_regi(rt1, base) || same_regi(rt1, rt2))) {
+        return false;
+    }
+
+    int size = rt1->kind == XR ? 8 : 4;
+    Operand* lo;
+    Operand* hi;
+    int offset;
+    if (offset2 == offset1 + size) {
+        lo = rt1; hi = rt2; offset = offset1;
+    } else if (offset1 == offset2 + size) {
+        lo = rt2; hi = rt1; offset = offset2;
+    } else {
+        return false;
+    }
+
+    // imm7 scaled by the register size
+    if (offset % size != 0 || offset < -64 * size || offset > 63 * size) {
+        return false;
+    }
+
+    Operand* mem_op = new Operand;
+    mem_op->kind = MEM_OP_IMM_OFFSET;
+    mem_op->base_register = base;
+    mem_op->offset = new_imm(offset);
+
+    Operand** operands = new Operand*[3] { lo, hi, mem_op };
+    *fused = Instr { load ? "ldp" : "stp", operands, 3, first.line, first.file };
+    return true;
+}
+
+void peephole() {
+    std::vector<Instr> out;
+    out.reserve(instrs.size());
+
+    for (Instr& in : instrs) {
+        if (is_redundant(in)) {
+            report_rewrite(source_files[in.file].path, in.line, "removed `" + format_instr(in) + "`");
+            continue;
+        }
+
+        Instr fused;
+        if (!out.empty() && fuse_pair(out.back(), in, &fused)) {
+            report_rewrite(source_files[in.file].path, in.line, "`" + format_instr(out.back()) + "` + `" + format_instr(in) + "` -> `" + format_instr(fused) + "`");
+            out.back() = fused;
+            continue;
+        }
+
+        out.push_back(in);
+    }
+
+    instrs.swap(out);
+}
+
+// --------------------------------------------------------------------
+// --------------------------------------------------------------------
+// Instruction scheduler (--schedule=<core>)
+// --------------------------------------------------------------------
+// --------------------------------------------------------------------
+
+// List scheduling over straight-line blocks for in-order cores.
+// Instructions missing from `sched_table` (branches, system, atomics, exclusives, ...) end a block.
+
+enum SchedClass {
+    SCHED_ALU,
+    SCHED_ALU_SHIFT,
+    SCHED_MUL,
+    SCHED_DIV,
+    SCHED_LOAD,
+    SCHED_STORE,
+    SCHED_CLASS_COUNT,
+};
+
+enum SchedUnit {
+    UNIT_ALU,
+    UNIT_MAC,
+    UNIT_DIV,
+    UNIT_LS,
+    SCHED_UNIT_COUNT,
+};
+
+struct CoreModel {
+    int issue_width;
+    int unit_count[SCHED_UNIT_COUNT];
+    SchedUnit unit[SCHED_CLASS_COUNT];
+    int latency[SCHED_CLASS_COUNT];
+};
+
+// Approximate figures from the Cortex-A53/A55 software optimization guides
+std::unordered_map<std::string, CoreModel> core_models = {
+    //                         width   ALU MAC DIV LS   ALU       ALU_SHIFT MUL       DIV       LOAD     STORE
+    {"cortex-a53", CoreModel { 2,     {2,  1,  1,  1}, {UNIT_ALU, UNIT_ALU, UNIT_MAC, UNIT_DIV, UNIT_LS, UNIT_LS}, {1, 2, 3, 12, 3, 1} }},
+    {"cortex-a55", CoreModel { 2,     {2,  1,  1,  1}, {UNIT_ALU, UNIT_ALU, UNIT_MAC, UNIT_DIV, UNIT_LS, UNIT_LS}, {1, 2, 4, 12, 4, 1} }},
+};
+
+struct SchedInfo {
+    SchedClass sched_class;
+    int def_count;      // leading register operands written by the instruction
+    bool reads_flags;
+    bool writes_flags;
+    bool reads_dest;    // movk merges into its destination
+};
+
+std::unordered_map<std::string, SchedInfo> sched_table = {
+    {"add",    {SCHED_ALU, 1}},             {"sub",    {SCHED_ALU, 1}},             {"orr",    {SCHED_ALU, 1}},             {"orn",    {SCHED_ALU, 1}},
+    {"and",    {SCHED_ALU, 1}},             {"bic",    {SCHED_ALU, 1}},             {"eor",    {SCHED_ALU, 1}},             {"eon",    {SCHED_ALU, 1}},
+    {"mov",    {SCHED_ALU, 1}},             {"mvn",    {SCHED_ALU, 1}},             {"neg",    {SCHED_ALU, 1}},             {"movz",   {SCHED_ALU, 1}},
+    {"movn",   {SCHED_ALU, 1}},             {"movk",   {SCHED_ALU, 1, false, false, true}},
+    {"lsl",    {SCHED_ALU, 1}},             {"lslv",   {SCHED_ALU, 1}},             {"lsr",    {SCHED_ALU, 1}},             {"lsrv",   {SCHED_ALU, 1}},
+    {"asr",    {SCHED_ALU, 1}},             {"asrv",   {SCHED_ALU, 1}},             {"ror",    {SCHED_ALU, 1}},             {"rorv",   {SCHED_ALU, 1}},
+    {"extr",   {SCHED_ALU, 1}},             {"rbit",   {SCHED_ALU, 1}},             {"rev",    {SCHED_ALU, 1}},             {"rev16",  {SCHED_ALU, 1}},
+    {"rev32",  {SCHED_ALU, 1}},             {"rev64",  {SCHED_ALU, 1}},             {"clz",    {SCHED_ALU, 1}},             {"cls",    {SCHED_ALU, 1}},
+    {"sxtb",   {SCHED_ALU, 1}},             {"sxth",   {SCHED_ALU, 1}},             {"sxtw",   {SCHED_ALU, 1}},             {"uxtb",   {SCHED_ALU, 1}},
+    {"uxth",   {SCHED_ALU, 1}},
+    {"adc",    {SCHED_ALU, 1, true}},       {"sbc",    {SCHED_ALU, 1, true}},       {"ngc",    {SCHED_ALU, 1, true}},       {"csel",   {SCHED_ALU, 1, true}},
+    {"csinc",  {SCHED_ALU, 1, true}},       {"csinv",  {SCHED_ALU, 1, true}},       {"csneg",  {SCHED_ALU, 1, true}},       {"cset",   {SCHED_ALU, 1, true}},
+    {"csetm",  {SCHED_ALU, 1, true}},       {"cinc",   {SCHED_ALU, 1, true}},       {"cinv",   {SCHED_ALU, 1, true}},       {"cneg",   {SCHED_ALU, 1, true}},
+    {"adds",   {SCHED_ALU, 1, false, true}}, {"subs",  {SCHED_ALU, 1, false, true}}, {"negs",  {SCHED_ALU, 1, false, true}},
+    {"adcs",   {SCHED_ALU, 1, true, true}}, {"sbcs",   {SCHED_ALU, 1, true, true}}, {"ngcs",   {SCHED_ALU, 1, true, true}},
+    {"ands",   {SCHED_ALU, 1, false, true}}, {"bics",  {SCHED_ALU, 1, false, true}},
+    {"cmp",    {SCHED_ALU, 0, false, true}}, {"cmn",   {SCHED_ALU, 0, false, true}}, {"tst",   {SCHED_ALU, 0, false, true}},
+    {"ccmp",   {SCHED_ALU, 0, true, true}}, {"ccmn",   {SCHED_ALU, 0, true, true}},
+    {"mul",    {SCHED_MUL, 1}},             {"madd",   {SCHED_MUL, 1}},             {"msub",   {SCHED_MUL, 1}},             {"mneg",   {SCHED_MUL, 1}},
+    {"smaddl", {SCHED_MUL, 1}},             {"smsubl", {SCHED_MUL, 1}},             {"smnegl", {SCHED_MUL, 1}},             {"smull",  {SCHED_MUL, 1}},
+    {"umaddl", {SCHED_MUL, 1}},             {"umsubl", {SCHED_MUL, 1}},             {"umnegl", {SCHED_MUL, 1}},             {"umull",  {SCHED_MUL, 1}},
+    {"smulh",  {SCHED_MUL, 1}},             {"umulh",  {SCHED_MUL, 1}},
+    {"crc32b", {SCHED_MUL, 1}},             {"crc32h", {SCHED_MUL, 1}},             {"crc32w", {SCHED_MUL, 1}},             {"crc32x", {SCHED_MUL, 1}},
+    {"crc32cb", {SCHED_MUL, 1}},            {"crc32ch", {SCHED_MUL, 1}},            {"crc32cw", {SCHED_MUL, 1}},            {"crc32cx", {SCHED_MUL, 1}},
+    {"sdiv",   {SCHED_DIV, 1}},             {"udiv",   {SCHED_DIV, 1}},
+    {"ldr",    {SCHED_LOAD, 1}},            {"ldrb",   {SCHED_LOAD, 1}},            {"ldrh",   {SCHED_LOAD, 1}},            {"ldrsb",  {SCHED_LOAD, 1}},
+    {"ldrsh",  {SCHED_LOAD, 1}},            {"ldrsw",  {SCHED_LOAD, 1}},            {"ldur",   {SCHED_LOAD, 1}},            {"ldurb",  {SCHED_LOAD, 1}},
+    {"ldurh",  {SCHED_LOAD, 1}},            {"ldursb", {SCHED_LOAD, 1}},            {"ldursh", {SCHED_LOAD, 1}},            {"ldursw", {SCHED_LOAD, 1}},
+    {"ldp",    {SCHED_LOAD, 2}},            {"ldpsw",  {SCHED_LOAD, 2}},            {"ldnp",   {SCHED_LOAD, 2}},
+    {"str",    {SCHED_STORE, 0}},           {"strb",   {SCHED_STORE, 0}},           {"strh",   {SCHED_STORE, 0}},           {"stur",   {SCHED_STORE, 0}},
+    {"sturb",  {SCHED_STORE, 0}},           {"sturh",  {SCHED_STORE, 0}},           {"stp",    {SCHED_STORE, 0}},           {"stnp",   {SCHED_STORE, 0}},
+};
+
+// register numbers 0-31 (x/w share a number, sp is 31), NZCV is tracked as register 64
+#define SCHED_FLAGS 64
+#define SCHED_REGS  65
+#define SCHED_REGION_MAX 256
+
+struct SchedNode {
+    SchedClass sched_class;
+    uint64_t defs;
+    uint64_t uses;
+    bool reads_flags;
+    bool writes_flags;
+};
+
+inline uint64_t regi_mask(Operand* op) {
+    switch (op->kind) {
+        case XR: case WR: // register 31 is xzr/wzr, which carries no dependency
+            return op->regi_bits == 31 ? 0 : 1ull << op->regi_bits;
+        case XSP: case WSP:
+            return 1ull << op->regi_bits;
+        default:
+            return 0;
+    }
+}
+
+bool sched_node(Instr& in, SchedNode* node) {
+    auto it = sched_table.find(in.name);
+    if (it == sched_table.end()) {
+        return false;
+    }
+    SchedInfo& info = it->second;
+
+    node->sched_class = info.sched_class;
+    node->defs = 0;
+    node->uses = 0;
+    node->reads_flags = info.reads_flags;
+    node->writes_flags = info.writes_flags;
+
+    for (int i = 0; i < in.operand_length; i++) {
+        Operand* op = in.operands[i];
+        switch (op->kind) {
+            case XR: case WR: case XSP: case WSP:
+                if (i < info.def_count) {
+                    node->defs |= regi_mask(op);
+                    if (info.reads_dest) node->uses |= regi_mask(op);
+                } else {
+                    node->uses |= regi_mask(op);
+                }
+                break;
+            case SHIFT: case EXTEND:
+                if (node->sched_class == SCHED_ALU && (op->kind == EXTEND || op->amount != 0)) {
+                    node->sched_class = SCHED_ALU_SHIFT;
+                }
+                break;
+            case MEM_OP_REGI_OFFSET:
+                node->uses |= regi_mask(op->offset);
+                // fallthrough
+            case MEM_OP_BASE: case MEM_OP_IMM_OFFSET:
+                node->uses |= regi_mask(op->base_register);
+                // [base], #imm writes back the base register
+                if (i + 1 < in.operand_length && in.operands[i+1]->kind == IMM) {
+                    node->defs |= regi_mask(op->base_register);
+                }
+                break;
+            case MEM_OP_BASE_PRE: case MEM_OP_IMM_OFFSET_PRE:
+                node->uses |= regi_mask(op->base_register);
+                node->defs |= regi_mask(op->base_register);
+                break;
+            case IMM: case COND: case LITERAL: case FP_IMM:
+                break;
+            default:
+                // SIMD&FP and SVE registers are not modeled, treat the instruction as a barrier
+                return false;
+        }
+    }
+    return true;
+}
+
+// conditional branches are fused with the flag-setting instruction right before them
+inline bool fuses_with_flags(Instr& in) {
+    return in.name == "b" && in.operand_length == 2 && in.operands[0]->kind == COND;
+}
+
+#define for_each_regi(mask, r) for (uint64_t m_ = (mask); m_ && ((r) = __builtin_ctzll(m_), true); m_ &= m_ - 1)
+
+void schedule_region(Instr* region, int n, bool pin_flags, CoreModel& model) {
+    std::vector<SchedNode> nodes(n);
+    for (int i = 0; i < n; i++) {
+        sched_node(region[i], &nodes[i]);
+    }
+
+    auto latency = [&](int i) { return model.latency[nodes[i].sched_class]; };
+
+    std::vector<std::vector<std::pair<int, int>>> succs(n);
+    std::vector<int> pred_count(n, 0);
+    auto add_edge = [&](int from, int to, int lat) {
+        succs[from].push_back({to, lat});
+        pred_count[to]++;
+    };
+
+    int last_def[SCHED_REGS];
+    std::fill(last_def, last_def + SCHED_REGS, -1);
+    std::vector<int> uses_since_def[SCHED_REGS];
+    int last_store = -1;
+    std::vector<int> loads_since_store;
+
+    for (int i = 0; i < n; i++) {
+        SchedNode& node = nodes[i];
+        int r;
+
+        // read after write
+        for_each_regi(node.uses, r) {
+            if (last_def[r] >= 0) add_edge(last_def[r], i, latency(last_def[r]));
+        }
+        if (node.reads_flags && last_def[SCHED_FLAGS] >= 0) {
+            add_edge(last_def[SCHED_FLAGS], i, latency(last_def[SCHED_FLAGS]));
+        }
+
+        // write after write, write after read
+        auto add_def = [&](int r) {
+            if (last_def[r] >= 0) add_edge(last_def[r], i, 0);
+            for (int u : uses_since_def[r]) {
+                if (u != i) add_edge(u, i, 0);
+            }
+        };
+        for_each_regi(node.defs, r) add_def(r);
+        if (node.writes_flags) add_def(SCHED_FLAGS);
+
+        for_each_regi(node.uses, r) uses_since_def[r].push_back(i);
+        if (node.reads_flags) uses_since_def[SCHED_FLAGS].push_back(i);
+        for_each_regi(node.defs, r) {
+            last_def[r] = i;
+            uses_since_def[r].clear();
+        }
+        if (node.writes_flags) {
+            last_def[SCHED_FLAGS] = i;
+            uses_since_def[SCHED_FLAGS].clear();
+        }
+
+        // memory: loads may pass each other, stores stay ordered against every memory access
+        if (node.sched_class == SCHED_LOAD) {
+            if (last_store >= 0) add_edge(last_store, i, latency(last_store));
+            loads_since_store.push_back(i);
+        } else if (node.sched_class == SCHED_STORE) {
+            if (last_store >= 0) add_edge(last_store, i, 0);
+            for (int l : loads_since_store) add_edge(l, i, 0);
+            loads_since_store.clear();
+            last_store = i;
+        }
+    }
+
+    // keep the last flag setter right before the conditional branch so the pair can be fused
+    if (pin_flags) {
+        int f = last_def[SCHED_FLAGS];
+        if (f >= 0 && succs[f].empty()) {
+            for (int i = 0; i < n; i++) {
+                if (i != f) add_edge(i, f, 0);
+            }
+        }
+    }
+
+    // priority: longest latency path to the end of the block
+    std::vector<int> height(n);
+    for (int i = n - 1; i >= 0; i--) {
+        height[i] = latency(i);
+        for (auto& [s, lat] : succs[i]) {
+            height[i] = std::max(height[i], lat + height[s]);
+        }
+    }
+
+    std::vector<int> earliest(n, 0);
+    std::vector<int> ready;
+    std::vector<int> order;
+    order.reserve(n);
+    for (int i = 0; i < n; i++) {
+        if (pred_count[i] == 0) ready.push_back(i);
+    }
+
+    for (int cycle = 0; (int)order.size() < n; cycle++) {
+        int issued = 0;
+        int unit_used[SCHED_UNIT_COUNT] = {};
+        while (issued < model.issue_width) {
+            int best = -1;
+            for (size_t k = 0; k < ready.size(); k++) {
+                int i = ready[k];
+                SchedUnit unit = model.unit[nodes[i].sched_class];
+                if (earliest[i] > cycle || unit_used[unit] >= model.unit_count[unit]) continue;
+                if (best < 0 || height[i] > height[ready[best]] || (height[i] == height[ready[best]] && i < ready[best])) {
+                    best = k;
+                }
+            }
+            if (best < 0) break;
+
+            int i = ready[best];
+            ready[best] = ready.back();
+            ready.pop_back();
+            order.push_back(i);
+            issued++;
+            unit_used[model.unit[nodes[i].sched_class]]++;
+            for (auto& [s, lat] : succs[i]) {
+                earliest[s] = std::max(earliest[s], cycle + lat);
+                if (--pred_count[s] == 0) ready.push_back(s);
+            }
+        }
+    }
+
+    std::vector<Instr> scheduled(n);
+    for (int k = 0; k < n; k++) {
+        scheduled[k] = region[order[k]];
+    }
+    std::copy(scheduled.begin(), scheduled.end(), region);
+}
+
+// Static in-order issue model: cycles lost waiting on operands or a busy unit.
+int count_stalls(CoreModel& model) {
+    int regi_ready[SCHED_REGS] = {};
+    int cycle = 0;
+    int issued = 0;
+    int unit_used[SCHED_UNIT_COUNT] = {};
+    int stalls = 0;
+
+    for (Instr& in : instrs) {
+        int min_cycle = issued < model.issue_width ? cycle : cycle + 1;
+
+        SchedNode node;
+        if (!sched_node(in, &node)) {
+            // everything else issues on its own
+            cycle = min_cycle + 1;
+            issued = 0;
+            std::fill(unit_used, unit_used + SCHED_UNIT_COUNT, 0);
+            continue;
+        }
+
+        SchedUnit unit = model.unit[node.sched_class];
+        int t = min_cycle;
+        int r;
+        for_each_regi(node.uses, r) t = std::max(t, regi_ready[r]);
+        if (node.reads_flags) t = std::max(t, regi_ready[SCHED_FLAGS]);
+        if (t == cycle && unit_used[unit] >= model.unit_count[unit]) t = cycle + 1;
+
+        if (t > cycle) {
+            cycle = t;
+            issued = 0;
+            std::fill(unit_used, unit_used + SCHED_UNIT_COUNT, 0);
+        }
+        stalls += t - min_cycle;
+        issued++;
+        unit_used[unit]++;
+
+        int ready_at = t + model.latency[node.sched_class];
+        for_each_regi(node.defs, r) regi_ready[r] = ready_at;
+        if (node.writes_flags) regi_ready[SCHED_FLAGS] = ready_at;
+    }
+    return stalls;
+}
+
+void schedule(std::string core_name, CoreModel& model) {
+    int stalls_before = count_stalls(model);
+    int blocks = 0;
+
+    size_t i = 0;
+    while (i < instrs.size()) {
+        SchedNode node;
+        if (!sched_node(instrs[i], &node)) {
+            i++;
+            continue;
+        }
+        size_t start = i;
+        while (i < instrs.size() && i - start < SCHED_REGION_MAX && sched_node(instrs[i], &node)) {
+            i++;
+        }
+        bool pin_flags = i < instrs.size() && fuses_with_flags(instrs[i]);
+        schedule_region(&instrs[start], i - start, pin_flags, model);
+        blocks++;
+    }
+
+    int stalls_after = count_stalls(model);
+    std::cerr << "schedule (" << core_name << "): " << blocks << " blocks, stall cycles " << stalls_before << " -> " << stalls_after << std::endl;
+}
+
+// --------------------------------------------------------------------
+// --------------------------------------------------------------------
+// Static throughput analyzer (--analyze=<core>)
+// --------------------------------------------------------------------
+// --------------------------------------------------------------------
+
+// Every straight-line block (label to branch) is treated as a loop body and run through
+// a simple out-of-order model: in-order dispatch of `dispatch_width` instructions per
+// cycle, issue once the operands are ready and a pipe of the right kind is free.
+// Memory is assumed not to alias, like llvm-mca.
+
+enum AnalyzeClass {
+    // the first classes mirror SchedClass, so sched_table entries map directly
+    A_ALU,
+    A_ALU_SHIFT,
+    A_MUL,
+    A_DIV,
+    A_LOAD,
+    A_STORE,
+    A_ATOMIC,
+    A_BRANCH,
+    A_FP,
+    A_FP_MUL,
+    A_FP_DIV,
+    A_VEC,
+    A_VEC_MUL,
+    A_PRED,
+    A_SYS,
+    A_NOP,
+    A_CLASS_COUNT,
+};
+
+struct UopCost {
+    int latency;
+    int pipe;       // index into MicroArch::pipes, -1 for none
+    int occupancy;  // cycles the pipe stays busy
+};
+
+struct MicroArch {
+    int dispatch_width;
+    std::vector<std::pair<std::string, int>> pipes; // name, count
+    UopCost cost[A_CLASS_COUNT];
+    std::unordered_map<std::string, UopCost> overrides; // by mnemonic
+};
+
+// Approximate figures from the Cortex-A72 and Neoverse N1/V1 software optimization guides
+std::unordered_map<std::string, MicroArch> micro_archs = {
+    {"cortex-a72", MicroArch {
+        3,
+        { {"branch", 1}, {"integer", 2}, {"multi-cycle", 1}, {"load", 1}, {"store", 1}, {"fp/asimd", 2} },
+        {
+            {1, 1, 1},   // ALU
+            {2, 2, 1},   // ALU_SHIFT
+            {3, 2, 1},   // MUL
+            {12, 2, 12}, // DIV
+            {4, 3, 1},   // LOAD
+            {1, 4, 1},   // STORE
+            {4, 3, 1},   // ATOMIC
+            {1, 0, 1},   // BRANCH
+            {4, 5, 1},   // FP
+            {4, 5, 1},   // FP_MUL
+            {12, 5, 10}, // FP_DIV
+            {3, 5, 1},   // VEC
+            {4, 5, 1},   // VEC_MUL
+            {3, 5, 1},   // PRED
+            {1, 0, 1},   // SYS
+            {0, -1, 0},  // NOP
+        },
+        {
+            {"fmla", {7, 5, 1}}, {"fmls", {7, 5, 1}}, {"fmadd", {7, 5, 1}}, {"fmsub", {7, 5, 1}},
+            {"fnmadd", {7, 5, 1}}, {"fnmsub", {7, 5, 1}}, {"fsqrt", {17, 5, 15}},
+        },
+    }},
+    {"neoverse-n1", MicroArch {
+        4,
+        { {"branch", 1}, {"integer", 3}, {"multi-cycle", 1}, {"load/store", 2}, {"fp/asimd", 2} },
+        {
+            {1, 1, 1},   // ALU
+            {2, 2, 1},   // ALU_SHIFT
+            {2, 2, 1},   // MUL
+            {12, 2, 12}, // DIV
+            {4, 3, 1},   // LOAD
+            {1, 3, 1},   // STORE
+            {6, 3, 1},   // ATOMIC
+            {1, 0, 1},   // BRANCH
+            {2, 4, 1},   // FP
+            {3, 4, 1},   // FP_MUL
+            {10, 4, 7},  // FP_DIV
+            {2, 4, 1},   // VEC
+            {4, 4, 1},   // VEC_MUL
+            {2, 4, 1},   // PRED
+            {1, 0, 1},   // SYS
+            {0, -1, 0},  // NOP
+        },
+        {
+            {"fmla", {4, 4, 1}}, {"fmls", {4, 4, 1}}, {"fmadd", {4, 4, 1}}, {"fmsub", {4, 4, 1}},
+            {"fnmadd", {4, 4, 1}}, {"fnmsub", {4, 4, 1}}, {"fsqrt", {17, 4, 14}},
+        },
+    }},
+    {"neoverse-v1", MicroArch {
+        8,
+        { {"branch", 2}, {"integer", 4}, {"multi-cycle", 2}, {"load/store", 3}, {"fp/asimd", 4}, {"predicate", 2} },
+        {
+            {1, 1, 1},   // ALU
+            {2, 2, 1},   // ALU_SHIFT
+            {2, 2, 1},   // MUL
+            {12, 2, 12}, // DIV
+            {4, 3, 1},   // LOAD
+            {1, 3, 1},   // STORE
+            {6, 3, 1},   // ATOMIC
+            {1, 0, 1},   // BRANCH
+            {2, 4, 1},   // FP
+            {3, 4, 1},   // FP_MUL
+            {10, 4, 5},  // FP_DIV
+            {2, 4, 1},   // VEC
+            {4, 4, 1},   // VEC_MUL
+            {2, 5, 1},   // PRED
+            {1, 0, 1},   // SYS
+            {0, -1, 0},  // NOP
+        },
+        {
+            {"fmla", {4, 4, 1}}, {"fmls", {4, 4, 1}}, {"fmadd", {4, 4, 1}}, {"fmsub", {4, 4, 1}},
+            {"fnmadd", {4, 4, 1}}, {"fnmsub", {4, 4, 1}}, {"fsqrt", {16, 4, 7}},
+        },
+    }},
+};
+
+struct AnalyzeInfo {
+    AnalyzeClass analyze_class;
+    uint8_t defs;       // bit i: operand i is written
+    bool reads_flags;
+    bool writes_flags;
+    bool reads_dest;
+};
+
+// instructions not covered by sched_table
+std::unordered_map<std::string, AnalyzeInfo> analyze_table = {
+    {"b",        {A_BRANCH, 0}},             {"bl",       {A_BRANCH, 0}},             {"blr",      {A_BRANCH, 0}},             {"br",       {A_BRANCH, 0}},
+    {"ret",      {A_BRANCH, 0}},             {"retaa",    {A_BRANCH, 0}},             {"retab",    {A_BRANCH, 0}},             {"cbz",      {A_BRANCH, 0}},
+    {"cbnz",     {A_BRANCH, 0}},             {"tbz",      {A_BRANCH, 0}},             {"tbnz",     {A_BRANCH, 0}},             {"eret",     {A_BRANCH, 0}},
+    {"eretaa",   {A_BRANCH, 0}},             {"eretab",   {A_BRANCH, 0}},
+    {"dmb",      {A_SYS, 0}},                {"dsb",      {A_SYS, 0}},                {"isb",      {A_SYS, 0}},                {"sb",       {A_SYS, 0}},
+    {"csdb",     {A_SYS, 0}},                {"ssbb",     {A_SYS, 0}},                {"pssbb",    {A_SYS, 0}},                {"esb",      {A_SYS, 0}},
+    {"clrex",    {A_SYS, 0}},                {"hint",     {A_SYS, 0}},                {"yield",    {A_SYS, 0}},                {"wfe",      {A_SYS, 0}},
+    {"wfi",      {A_SYS, 0}},                {"sev",      {A_SYS, 0}},                {"sevl",     {A_SYS, 0}},                {"svc",      {A_SYS, 0}},
+    {"hvc",      {A_SYS, 0}},                {"smc",      {A_SYS, 0}},                {"hlt",      {A_SYS, 0}},                {"udf",      {A_SYS, 0}},
+    {"dcps1",    {A_SYS, 0}},                {"dcps2",    {A_SYS, 0}},                {"dcps3",    {A_SYS, 0}},                {"drps",     {A_SYS, 0}},
+    {"dc",       {A_SYS, 0}},                {"ic",       {A_SYS, 0}},                {"msr",      {A_SYS, 0}},                {"mrs",      {A_SYS, 1}},
+    {"nop",      {A_NOP, 0}},
+    {"cfinv",    {A_ALU, 0, true, true}},    {"setf8",    {A_ALU, 0, false, true}},   {"setf16",   {A_ALU, 0, false, true}},   {"rmif",     {A_ALU, 0, false, true}},
+    {"pacia",    {A_MUL, 1, false, false, true}}, {"pacib",    {A_MUL, 1, false, false, true}}, {"pacda",    {A_MUL, 1, false, false, true}}, {"pacdb",    {A_MUL, 1, false, false, true}},
+    {"autia",    {A_MUL, 1, false, false, true}}, {"autib",    {A_MUL, 1, false, false, true}}, {"autda",    {A_MUL, 1, false, false, true}}, {"autdb",    {A_MUL, 1, false, false, true}},
+    {"paciza",   {A_MUL, 1}},                {"pacizb",   {A_MUL, 1}},                {"pacdza",   {A_MUL, 1}},                {"pacdzb",   {A_MUL, 1}},
+    {"autiza",   {A_MUL, 1}},                {"autizb",   {A_MUL, 1}},                {"autdza",   {A_MUL, 1}},                {"autdzb",   {A_MUL, 1}},
+    {"xpaci",    {A_MUL, 1, false, false, true}}, {"xpacd",    {A_MUL, 1, false, false, true}}, {"pacga",    {A_MUL, 1}},                {"pacia1716", {A_MUL, 0}},
+    {"pacib1716", {A_MUL, 0}},               {"paciasp",  {A_MUL, 0}},                {"pacibsp",  {A_MUL, 0}},                {"paciaz",   {A_MUL, 0}},
+    {"pacibz",   {A_MUL, 0}},                {"autia1716", {A_MUL, 0}},               {"autib1716", {A_MUL, 0}},               {"autiasp",  {A_MUL, 0}},
+    {"autibsp",  {A_MUL, 0}},                {"autiaz",   {A_MUL, 0}},                {"autibz",   {A_MUL, 0}},                {"xpaclri",  {A_MUL, 0}},
+    {"ldar",     {A_LOAD, 1}},               {"ldarb",    {A_LOAD, 1}},               {"ldarh",    {A_LOAD, 1}},               {"ldapr",    {A_LOAD, 1}},
+    {"ldaprb",   {A_LOAD, 1}},               {"ldaprh",   {A_LOAD, 1}},               {"ldapur",   {A_LOAD, 1}},               {"ldapurb",  {A_LOAD, 1}},
+    {"ldapurh",  {A_LOAD, 1}},               {"ldapursb", {A_LOAD, 1}},               {"ldapursh", {A_LOAD, 1}},               {"ldapursw", {A_LOAD, 1}},
+    {"ldlar",    {A_LOAD, 1}},               {"ldlarb",   {A_LOAD, 1}},               {"ldlarh",   {A_LOAD, 1}},               {"ldtr",     {A_LOAD, 1}},
+    {"ldtrb",    {A_LOAD, 1}},               {"ldtrh",    {A_LOAD, 1}},               {"ldtrsb",   {A_LOAD, 1}},               {"ldtrsh",   {A_LOAD, 1}},
+    {"ldtrsw",   {A_LOAD, 1}},               {"ldxr",     {A_LOAD, 1}},               {"ldxrb",    {A_LOAD, 1}},               {"ldxrh",    {A_LOAD, 1}},
+    {"ldaxr",    {A_LOAD, 1}},               {"ldaxrb",   {A_LOAD, 1}},               {"ldaxrh",   {A_LOAD, 1}},               {"ldraa",    {A_LOAD, 1}},
+    {"ldrab",    {A_LOAD, 1}},               {"ldxp",     {A_LOAD, 0b11}},            {"ldaxp",    {A_LOAD, 0b11}},            {"prfm",     {A_LOAD, 0}},
+    {"prfum",    {A_LOAD, 0}},               {"ld1",      {A_LOAD, 1}},               {"ld2",      {A_LOAD, 1}},               {"ld3",      {A_LOAD, 1}},
+    {"ld4",      {A_LOAD, 1}},               {"ld1b",     {A_LOAD, 1}},               {"ld1h",     {A_LOAD, 1}},               {"ld1w",     {A_LOAD, 1}},
+    {"ld1d",     {A_LOAD, 1}},
+    {"stlr",     {A_STORE, 0}},              {"stlrb",    {A_STORE, 0}},              {"stlrh",    {A_STORE, 0}},              {"stllr",    {A_STORE, 0}},
+    {"stllrb",   {A_STORE, 0}},              {"stllrh",   {A_STORE, 0}},              {"stlur",    {A_STORE, 0}},              {"stlurb",   {A_STORE, 0}},
+    {"stlurh",   {A_STORE, 0}},              {"sttr",     {A_STORE, 0}},              {"sttrb",    {A_STORE, 0}},              {"sttrh",    {A_STORE, 0}},
+    {"st1",      {A_STORE, 0}},              {"st2",      {A_STORE, 0}},              {"st3",      {A_STORE, 0}},              {"st4",      {A_STORE, 0}},
+    {"st1b",     {A_STORE, 0}},              {"st1h",     {A_STORE, 0}},              {"st1w",     {A_STORE, 0}},              {"st1d",     {A_STORE, 0}},
+    {"stxr",     {A_STORE, 1}},              {"stxrb",    {A_STORE, 1}},              {"stxrh",    {A_STORE, 1}},              {"stlxr",    {A_STORE, 1}},
+    {"stlxrb",   {A_STORE, 1}},              {"stlxrh",   {A_STORE, 1}},              {"stxp",     {A_STORE, 1}},              {"stlxp",    {A_STORE, 1}},
+    {"cas",      {A_ATOMIC, 1, false, false, true}}, {"casa",     {A_ATOMIC, 1, false, false, true}}, {"casab",    {A_ATOMIC, 1, false, false, true}}, {"casah",    {A_ATOMIC, 1, false, false, true}},
+    {"casal",    {A_ATOMIC, 1, false, false, true}}, {"casalb",   {A_ATOMIC, 1, false, false, true}}, {"casalh",   {A_ATOMIC, 1, false, false, true}}, {"casb",     {A_ATOMIC, 1, false, false, true}},
+    {"cash",     {A_ATOMIC, 1, false, false, true}}, {"ldadd",    {A_ATOMIC, 0b10}},          {"ldaddb",   {A_ATOMIC, 0b10}},          {"ldaddh",   {A_ATOMIC, 0b10}},
+    {"ldadda",   {A_ATOMIC, 0b10}},          {"ldaddab",  {A_ATOMIC, 0b10}},          {"ldaddah",  {A_ATOMIC, 0b10}},          {"ldaddal",  {A_ATOMIC, 0b10}},
+    {"ldaddalb", {A_ATOMIC, 0b10}},          {"ldaddalh", {A_ATOMIC, 0b10}},          {"ldaddl",   {A_ATOMIC, 0b10}},          {"ldaddlb",  {A_ATOMIC, 0b10}},
+    {"ldaddlh",  {A_ATOMIC, 0b10}},          {"ldclr",    {A_ATOMIC, 0b10}},          {"ldclrb",   {A_ATOMIC, 0b10}},          {"ldclrh",   {A_ATOMIC, 0b10}},
+    {"ldclra",   {A_ATOMIC, 0b10}},          {"ldclrab",  {A_ATOMIC, 0b10}},          {"ldclrah",  {A_ATOMIC, 0b10}},          {"ldclral",  {A_ATOMIC, 0b10}},
+    {"ldclralb", {A_ATOMIC, 0b10}},          {"ldclralh", {A_ATOMIC, 0b10}},          {"ldclrl",   {A_ATOMIC, 0b10}},          {"ldclrlb",  {A_ATOMIC, 0b10}},
+    {"ldclrlh",  {A_ATOMIC, 0b10}},          {"ldeor",    {A_ATOMIC, 0b10}},          {"ldeorb",   {A_ATOMIC, 0b10}},          {"ldeorh",   {A_ATOMIC, 0b10}},
+    {"ldeora",   {A_ATOMIC, 0b10}},          {"ldeorab",  {A_ATOMIC, 0b10}},          {"ldeorah",  {A_ATOMIC, 0b10}},          {"ldeoral",  {A_ATOMIC, 0b10}},
+    {"ldeoralb", {A_ATOMIC, 0b10}},          {"ldeoralh", {A_ATOMIC, 0b10}},          {"ldeorl",   {A_ATOMIC, 0b10}},          {"ldeorlb",  {A_ATOMIC, 0b10}},
+    {"ldeorlh",  {A_ATOMIC, 0b10}},          {"ldset",    {A_ATOMIC, 0b10}},          {"ldsetb",   {A_ATOMIC, 0b10}},          {"ldseth",   {A_ATOMIC, 0b10}},
+    {"ldseta",   {A_ATOMIC, 0b10}},          {"ldsetab",  {A_ATOMIC, 0b10}},          {"ldsetah",  {A_ATOMIC, 0b10}},          {"ldsetal",  {A_ATOMIC, 0b10}},
+    {"ldsetalb", {A_ATOMIC, 0b10}},          {"ldsetalh", {A_ATOMIC, 0b10}},          {"ldsetl",   {A_ATOMIC, 0b10}},          {"ldsetlb",  {A_ATOMIC, 0b10}},
+    {"ldsetlh",  {A_ATOMIC, 0b10}},          {"ldsmax",   {A_ATOMIC, 0b10}},          {"ldsmaxb",  {A_ATOMIC, 0b10}},          {"ldsmaxh",  {A_ATOMIC, 0b10}},
+    {"ldsmaxa",  {A_ATOMIC, 0b10}},          {"ldsmaxab", {A_ATOMIC, 0b10}},          {"ldsmaxah", {A_ATOMIC, 0b10}},          {"ldsmaxal", {A_ATOMIC, 0b10}},
+    {"ldsmaxalb", {A_ATOMIC, 0b10}},         {"ldsmaxalh", {A_ATOMIC, 0b10}},         {"ldsmaxl",  {A_ATOMIC, 0b10}},          {"ldsmaxlb", {A_ATOMIC, 0b10}},
+    {"ldsmaxlh", {A_ATOMIC, 0b10}},          {"ldsmin",   {A_ATOMIC, 0b10}},          {"ldsminb",  {A_ATOMIC, 0b10}},          {"ldsminh",  {A_ATOMIC, 0b10}},
+    {"ldsmina",  {A_ATOMIC, 0b10}},          {"ldsminab", {A_ATOMIC, 0b10}},          {"ldsminah", {A_ATOMIC, 0b10}},          {"ldsminal", {A_ATOMIC, 0b10}},
+    {"ldsminalb", {A_ATOMIC, 0b10}},         {"ldsminalh", {A_ATOMIC, 0b10}},         {"ldsminl",  {A_ATOMIC, 0b10}},          {"ldsminlb", {A_ATOMIC, 0b10}},
+    {"ldsminlh", {A_ATOMIC, 0b10}},          {"ldumax",   {A_ATOMIC, 0b10}},          {"ldumaxb",  {A_ATOMIC, 0b10}},          {"ldumaxh",  {A_ATOMIC, 0b10}},
+    {"ldumaxa",  {A_ATOMIC, 0b10}},          {"ldumaxab", {A_ATOMIC, 0b10}},          {"ldumaxah", {A_ATOMIC, 0b10}},          {"ldumaxal", {A_ATOMIC, 0b10}},
+    {"ldumaxalb", {A_ATOMIC, 0b10}},         {"ldumaxalh", {A_ATOMIC, 0b10}},         {"ldumaxl",  {A_ATOMIC, 0b10}},          {"ldumaxlb", {A_ATOMIC, 0b10}},
+    {"ldumaxlh", {A_ATOMIC, 0b10}},          {"ldumin",   {A_ATOMIC, 0b10}},          {"lduminb",  {A_ATOMIC, 0b10}},          {"lduminh",  {A_ATOMIC, 0b10}},
+    {"ldumina",  {A_ATOMIC, 0b10}},          {"lduminab", {A_ATOMIC, 0b10}},          {"lduminah", {A_ATOMIC, 0b10}},          {"lduminal", {A_ATOMIC, 0b10}},
+    {"lduminalb", {A_ATOMIC, 0b10}},         {"lduminalh", {A_ATOMIC, 0b10}},         {"lduminl",  {A_ATOMIC, 0b10}},          {"lduminlb", {A_ATOMIC, 0b10}},
+    {"lduminlh", {A_ATOMIC, 0b10}},
+    {"fabs",     {A_FP, 1}},                 {"fneg",     {A_FP, 1}},                 {"fmov",     {A_FP, 1}},                 {"fcvt",     {A_FP, 1}},
+    {"fcvtas",   {A_FP, 1}},                 {"fcvtau",   {A_FP, 1}},                 {"fcvtms",   {A_FP, 1}},                 {"fcvtmu",   {A_FP, 1}},
+    {"fcvtns",   {A_FP, 1}},                 {"fcvtnu",   {A_FP, 1}},                 {"fcvtps",   {A_FP, 1}},                 {"fcvtpu",   {A_FP, 1}},
+    {"fcvtzs",   {A_FP, 1}},                 {"fcvtzu",   {A_FP, 1}},                 {"scvtf",    {A_FP, 1}},                 {"ucvtf",    {A_FP, 1}},
+    {"frinta",   {A_FP, 1}},                 {"frinti",   {A_FP, 1}},                 {"frintm",   {A_FP, 1}},                 {"frintn",   {A_FP, 1}},
+    {"frintp",   {A_FP, 1}},                 {"frintx",   {A_FP, 1}},                 {"frintz",   {A_FP, 1}},                 {"fadd",     {A_FP, 1}},
+    {"fsub",     {A_FP, 1}},                 {"fabd",     {A_FP, 1}},                 {"fmax",     {A_FP, 1}},                 {"fmaxnm",   {A_FP, 1}},
+    {"fmin",     {A_FP, 1}},                 {"fminnm",   {A_FP, 1}},                 {"faddp",    {A_FP, 1}},                 {"fcmeq",    {A_FP, 1}},
+    {"fcmge",    {A_FP, 1}},                 {"fcmgt",    {A_FP, 1}},                 {"fdup",     {A_FP, 1}},                 {"faddv",    {A_FP, 1}},
+    {"fcmp",     {A_FP, 0, false, true}},    {"fcmpe",    {A_FP, 0, false, true}},    {"fccmp",    {A_FP, 0, true, true}},     {"fccmpe",   {A_FP, 0, true, true}},
+    {"fcsel",    {A_FP, 1, true, false}},
+    {"fmul",     {A_FP_MUL, 1}},             {"fnmul",    {A_FP_MUL, 1}},             {"fmadd",    {A_FP_MUL, 1}},             {"fmsub",    {A_FP_MUL, 1}},
+    {"fnmadd",   {A_FP_MUL, 1}},             {"fnmsub",   {A_FP_MUL, 1}},             {"fmla",     {A_FP_MUL, 1, false, false, true}}, {"fmls",     {A_FP_MUL, 1, false, false, true}},
+    {"fdiv",     {A_FP_DIV, 1}},             {"fsqrt",    {A_FP_DIV, 1}},
+    {"abs",      {A_VEC, 1}},                {"addp",     {A_VEC, 1}},                {"cmeq",     {A_VEC, 1}},                {"cmge",     {A_VEC, 1}},
+    {"cmgt",     {A_VEC, 1}},                {"cmhi",     {A_VEC, 1}},                {"cmhs",     {A_VEC, 1}},                {"cnt",      {A_VEC, 1}},
+    {"dup",      {A_VEC, 1}},                {"ext",      {A_VEC, 1}},                {"not",      {A_VEC, 1}},                {"shl",      {A_VEC, 1}},
+    {"sshr",     {A_VEC, 1}},                {"ushr",     {A_VEC, 1}},                {"sshl",     {A_VEC, 1}},                {"ushl",     {A_VEC, 1}},
+    {"smax",     {A_VEC, 1}},                {"smin",     {A_VEC, 1}},                {"umax",     {A_VEC, 1}},                {"umin",     {A_VEC, 1}},
+    {"sqadd",    {A_VEC, 1}},                {"sqsub",    {A_VEC, 1}},                {"uqadd",    {A_VEC, 1}},                {"uqsub",    {A_VEC, 1}},
+    {"smov",     {A_VEC, 1}},                {"umov",     {A_VEC, 1}},                {"tbl",      {A_VEC, 1}},                {"bif",      {A_VEC, 1, false, false, true}},
+    {"bit",      {A_VEC, 1, false, false, true}}, {"bsl",      {A_VEC, 1, false, false, true}}, {"ins",      {A_VEC, 1, false, false, true}}, {"tbx",      {A_VEC, 1, false, false, true}},
+    {"mla",      {A_VEC_MUL, 1, false, false, true}}, {"mls",      {A_VEC_MUL, 1, false, false, true}},
+    {"cntb",     {A_ALU, 1}},                {"cnth",     {A_ALU, 1}},                {"cntw",     {A_ALU, 1}},                {"cntd",     {A_ALU, 1}},
+    {"incb",     {A_ALU, 1, false, false, true}}, {"inch",     {A_ALU, 1, false, false, true}}, {"incw",     {A_ALU, 1, false, false, true}}, {"incd",     {A_ALU, 1, false, false, true}},
+    {"ptrue",    {A_PRED, 1}},               {"whilele",  {A_PRED, 1, false, true}},  {"whilelo",  {A_PRED, 1, false, true}},  {"whilels",  {A_PRED, 1, false, true}},
+    {"whilelt",  {A_PRED, 1, false, true}},
+};
+
+AnalyzeInfo analyze_info(std::string& name) {
+    auto it = analyze_table.find(name);
+    if (it != analyze_table.end()) {
+        return it->second;
+    }
+    auto sched = sched_table.find(name);
+    if (sched != sched_table.end()) {
+        SchedInfo& info = sched->second;
+        return AnalyzeInfo { (AnalyzeClass)info.sched_class, (uint8_t)((1 << info.def_count) - 1), info.reads_flags, info.writes_flags, info.reads_dest };
+    }
+    return AnalyzeInfo { A_SYS, 0 };
+}
+
+// register numbers: x/w 0-31 (sp is 31), b/h/s/d/q/v/z 32-63, p 64-79, NZCV 80
+#define ANALYZE_FLAGS 80
+#define ANALYZE_REGS  81
+
+void operand_regs(Operand* op, std::vector<int>& regs) {
+    switch (op->kind) {
+        case XR: case WR:
+            if (op->regi_bits != 31) { // xzr/wzr
+                regs.push_back(op->regi_bits);
+            }
+            break;
+        case XSP: case WSP:
+            regs.push_back(op->regi_bits);
+            break;
+        case VREG: case VREG_ELEM: case BR: case HR: case SR: case DR: case QR: case ZREG:
+            regs.push_back(32 + op->regi_bits);
+            break;
+        case VREG_LIST: case ZREG_LIST:
+            for (int k = 0; k < op->amount; k++) {
+                regs.push_back(32 + (op->regi_bits + k) % 32);
+            }
+            break;
+        case PREG: case PREG_ZERO: case PREG_MERGE:
+            regs.push_back(64 + op->regi_bits);
+            break;
+        default:
+            break;
+    }
+}
+
+inline bool is_vector_regi(Operand* op) {
+    switch (op->kind) {
+        case VREG: case VREG_ELEM: case VREG_LIST: case ZREG: case ZREG_LIST:
+            return true;
+        default:
+            return false;
+    }
+}
+
+struct AnalyzeNode {
+    UopCost cost;
+    std::vector<int> defs;
+    std::vector<int> uses;
+};
+
+AnalyzeNode analyze_node(Instr& in, MicroArch& arch) {
+    AnalyzeInfo info = analyze_info(in.name);
+    AnalyzeNode node;
+
+    for (int i = 0; i < in.operand_length; i++) {
+        Operand* op = in.operands[i];
+        switch (op->kind) {
+            case SHIFT: case EXTEND:
+                if (info.analyze_class == A_ALU && (op->kind == EXTEND || op->amount != 0)) {
+                    info.analyze_class = A_ALU_SHIFT;
+                }
+                break;
+            case MEM_OP_REGI_OFFSET:
+                operand_regs(op->offset, node.uses);
+                // fallthrough
+            case MEM_OP_BASE: case MEM_OP_IMM_OFFSET: case MEM_OP_VL_OFFSET:
+                operand_regs(op->base_register, node.uses);
+                // post-index writes back the base register
+                if (i + 1 < in.operand_length && (in.operands[i+1]->kind == IMM || in.operands[i+1]->kind == XR)) {
+                    operand_regs(op->base_register, node.defs);
+                }
+                break;
+            case MEM_OP_BASE_PRE: case MEM_OP_IMM_OFFSET_PRE:
+                operand_regs(op->base_register, node.uses);
+                operand_regs(op->base_register, node.defs);
+                break;
+            case PREG_MERGE:
+                info.reads_dest = true;
+                operand_regs(op, i < 8 && (info.defs >> i & 1) ? node.defs : node.uses);
+                break;
+            default:
+                if (i < 8 && (info.defs >> i & 1)) {
+                    operand_regs(op, node.defs);
+                    if (info.reads_dest) operand_regs(op, node.uses);
+                } else {
+                    operand_regs(op, node.uses);
+                }
+                break;
+        }
+    }
+
+    // the same mnemonic on vector registers runs on the SIMD pipes
+    if (in.operand_length > 0 && is_vector_regi(in.operands[0])) {
+        if (info.analyze_class == A_ALU || info.analyze_class == A_ALU_SHIFT) info.analyze_class = A_VEC;
+        if (info.analyze_class == A_MUL) info.analyze_class = A_VEC_MUL;
+    }
+
+    if (fuses_with_flags(in)) {
+        info.reads_flags = true;
+    }
+    if (in.name == "bl" || in.name == "blr") {
+        node.defs.push_back(30);
+    }
+    if (info.reads_flags) node.uses.push_back(ANALYZE_FLAGS);
+    if (info.writes_flags) node.defs.push_back(ANALYZE_FLAGS);
+
+    auto it = arch.overrides.find(in.name);
+    node.cost = it != arch.overrides.end() ? it->second : arch.cost[info.analyze_class];
+    return node;
+}
+
+// up to 100 iterations, fewer for very long blocks
+#define ANALYZE_ITERATIONS 100
+#define ANALYZE_MAX_STEPS 1000000
+
+// cycles for `iterations` iterations; unlimited = no dispatch or pipe limits
+int64_t simulate_block(std::vector<AnalyzeNode>& nodes, MicroArch& arch, int iterations, bool unlimited) {
+    int64_t regi_ready[ANALYZE_REGS] = {};
+    // pipe_used[k][cycle]: units of pipe kind k busy in that cycle
+    std::vector<std::vector<uint8_t>> pipe_used(arch.pipes.size());
+
+    int64_t dispatch_cycle = 0;
+    int dispatched = 0;
+    int64_t end = 0;
+    for (int it = 0; it < iterations; it++) {
+        for (AnalyzeNode& node : nodes) {
+            if (!unlimited && dispatched == arch.dispatch_width) {
+                dispatch_cycle++;
+                dispatched = 0;
+            }
+            dispatched++;
+
+            int64_t t = unlimited ? 0 : dispatch_cycle;
+            for (int r : node.uses) t = std::max(t, regi_ready[r]);
+
+            if (!unlimited && node.cost.pipe >= 0) {
+                std::vector<uint8_t>& used = pipe_used[node.cost.pipe];
+                int count = arch.pipes[node.cost.pipe].second;
+                int occupancy = node.cost.occupancy;
+                // earliest cycle from which a unit is free for `occupancy` cycles
+                for (int64_t c = t; c < t + occupancy; c++) {
+                    if (c >= (int64_t)used.size()) {
+                        used.resize(c + 64, 0);
+                    }
+                    if (used[c] >= count) {
+                        t = c + 1;
+                    }
+                }
+                if (t + occupancy > (int64_t)used.size()) {
+                    used.resize(t + occupancy + 64, 0);
+                }
+                for (int64_t c = t; c < t + occupancy; c++) {
+                    used[c]++;
+                }
+            }
+
+            int64_t done = t + node.cost.latency;
+            for (int r : node.defs) regi_ready[r] = done;
+            end = std::max(end, std::max(done, t + 1));
+        }
+    }
+    return end;
+}
+
+void analyze_block(Instr* block, int n, MicroArch& arch, std::string core_name) {
+    std::vector<AnalyzeNode> nodes;
+    for (int i = 0; i < n; i++) {
+        nodes.push_back(analyze_node(block[i], arch));
+    }
+
+    int iterations = std::max(1, std::min(ANALYZE_ITERATIONS, ANALYZE_MAX_STEPS / n));
+    double cycles = (double)simulate_block(nodes, arch, iterations, false) / iterations;
+    double dependency = (double)simulate_block(nodes, arch, iterations, true) / iterations;
+
+    // lower bounds from dispatch and from each pipe kind
+    std::string bottleneck = "dispatch";
+    double bound = (double)n / arch.dispatch_width;
+    std::vector<double> pressure(arch.pipes.size(), 0);
+    for (AnalyzeNode& node : nodes) {
+        if (node.cost.pipe >= 0) pressure[node.cost.pipe] += node.cost.occupancy;
+    }
+    for (size_t k = 0; k < arch.pipes.size(); k++) {
+        pressure[k] /= arch.pipes[k].second;
+        if (pressure[k] > bound) {
+            bound = pressure[k];
+            bottleneck = arch.pipes[k].first + " pipes";
+        }
+    }
+    if (dependency > bound) {
+        bottleneck = "dependency chain";
+    }
+
+    // longest latency path through one iteration
+    std::vector<int> chain(n, 0);
+    std::vector<int> chain_prev(n, -1);
+    int last_def[ANALYZE_REGS];
+    std::fill(last_def, last_def + ANALYZE_REGS, -1);
+    int chain_end = 0;
+    for (int i = 0; i < n; i++) {
+        for (int r : nodes[i].uses) {
+            if (last_def[r] >= 0 && chain[last_def[r]] > chain[i]) {
+                chain[i] = chain[last_def[r]];
+                chain_prev[i] = last_def[r];
+            }
+        }
+        chain[i] += nodes[i].cost.latency;
+        for (int r : nodes[i].defs) last_def[r] = i;
+        if (chain[i] > chain[chain_end]) chain_end = i;
+    }
+    std::vector<int> path;
+    for (int i = chain_end; i >= 0; i = chain_prev[i]) {
+        path.push_back(i);
+    }
+
+    char buf[64];
+    std::cout << source_files[block[0].file].path << ":" << block[0].line << "-" << block[n - 1].line << " (" << n << " instructions, " << core_name << ")" << std::endl;
+    snprintf(buf, sizeof(buf), "%.2f (IPC %.2f)", cycles, n / cycles);
+    std::cout << "  cycles/iteration  " << buf << std::endl;
+    std::cout << "  bottleneck        " << bottleneck << std::endl;
+    snprintf(buf, sizeof(buf), "%.2f", (double)n / arch.dispatch_width);
+    std::cout << "  dispatch          " << buf << std::endl;
+    std::cout << "  pipes            ";
+    for (size_t k = 0; k < arch.pipes.size(); k++) {
+        snprintf(buf, sizeof(buf), " %s %.2f", arch.pipes[k].first.c_str(), pressure[k]);
+        std::cout << buf;
+    }
+    std::cout << std::endl;
+    snprintf(buf, sizeof(buf), "%.2f", dependency);
+    std::cout << "  loop-carried      " << buf << std::endl;
+    std::cout << "  critical chain    " << chain[chain_end] << " cycles:";
+    for (int k = path.size() - 1; k >= 0; k--) {
+        std::cout << " " << block[path[k]].line << " " << instr_mnemonic(block[path[k]]) << (k > 0 ? " ->" : "");
+    }
+    std::cout << std::endl;
+}
+
+void analyze(std::string core_name, MicroArch& arch) {
+    size_t i = 0;
+    while (i < instrs.size()) {
+        std::vector<Instr> block;
+        while (i < instrs.size()) {
+            Instr& in = instrs[i];
+            if ((in.name == ".label" || in.name == ".nlabel" || in.name == ".section") && !block.empty()) {
+                break;
+            }
+            i++;
+            if (in.name[0] == '.') {
+                continue;
+            }
+            block.push_back(in);
+            if (analyze_info(in.name).analyze_class == A_BRANCH) {
+                break;
+            }
+        }
+        if (!block.empty()) {
+            analyze_block(block.data(), block.size(), arch, core_name);
+        }
+    }
+}
+
+// an open .if
+struct Conditional {
+    int line;
+    bool in_else;
+};
+
+struct SourceStream;
+
+struct Parser {
+    int idx;
+    int line;
+    int file; // index into source_files
+    std::string file_path;
+    std::string program;
+    std::vector<Conditional> conds;
+    std::string guard;    // symbol of a leading .ifndef that may be an include guard
+    SourceStream* stream; // --pipeline: program is still being read
+};
+
+void pipeline_next_line(Parser* p);
+void pipeline_read_all(Parser* p);
+
+Parser* new_parser(std::string file_path, std::string program) {
+    Parser *p = new Parser;
+    p->program = program;
+    p->file_path = file_path;
+    p->file = 0;
+    p->idx = 0;
+    p->line = 1;
+    p->stream = nullptr;
+    return p;
+}
+
+// _exit, with --pipeline the other stages are still running and must not see global
+// destructors
+[[noreturn]] void syntax_error(Parser* p, std::string msg) {
+    std::cerr << "\u001b[1m" << p->file_path << ":" << p->line << ": \x1b[91merror:\x1b[0m\u001b[1m " << msg << "\033[0m" << std::endl;
+    _exit(1);
+}
+
+inline bool at_eof(Parser *p) {
+    return (size_t)p->idx >= p->program.size();
+}
+
+inline void parser_advance(Parser *p, int n) {
+    p->idx += n;
+}
+
+void skip_white_space(Parser *p) {
+    while (!at_eof(p)) {
+        char c = p->program[p->idx];
+        if (c == ' ' || c == '\t') {
+            parser_advance(p, 1);
+        } else {
+            break;
+        }
+    }
+}
+
+std::string read_ident(Parser* p) {
+    skip_white_space(p);
+
+    int start = p->idx;
+    while (std::isalpha(p->program[p->idx]) || std::isdigit(p->program[p->idx]) || p->program[p->idx] == '_') {
+        parser_advance(p, 1);
+    }
+
+    std::string str = p->program.substr(start, p->idx-start);
+
+    skip_white_space(p);
+
+    return str;
+}
+
+// symbol names may start with `.` (.L labels)
+std::string read_symbol(Parser* p) {
+    skip_white_space(p);
+    if (p->program[p->idx] == '.') {
+        parser_advance(p, 1);
+        return "." + read_ident(p);
+    }
+    std::string name = read_ident(p);
+    if (name.empty()) {
+        syntax_error(p, "expected a symbol name");
+    }
+    return name;
+}
+
+// `1b`, `12f`
+bool is_numeric_label_ref(std::string& ident) {
+    return ident.size() >= 2 && (ident.back() == 'b' || ident.back() == 'f') && std::all_of(ident.begin(), ident.end() - 1, ::isdigit);
+}
+
+// number of `1:`, `1b` or `1f`
+int numeric_label(Parser* p, std::string digits) {
+    if (digits.size() > 5 || std::stoi(digits) > NUMERIC_LABEL_MAX) {
+        syntax_error(p, "local label number too large");
+    }
+    return std::stoi(digits);
+}
+
+int64_t read_number(Parser* p) {
+    skip_white_space(p);
+
+    bool negative = p->program[p->idx] == '-';
+    if (negative) {
+        parser_advance(p, 1);
+    }
+
+    uint64_t base = 10;
+    if (p->program[p->idx] == '0' && (p->program[p->idx+1] == 'x' || p->program[p->idx+1] == 'X')) {
+        parser_advance(p, 2);
+        base = 16;
+    } else if (p->program[p->idx] == '0' && (p->program[p->idx+1] == 'b' || p->program[p->idx+1] == 'B') && (p->program[p->idx+2] == '0' || p->program[p->idx+2] == '1')) {
+        parser_advance(p, 2);
+        base = 2;
+    }
+
+    // any 64 bit pattern, or down to INT64_MIN with a minus
+    uint64_t imm_val = 0;
+    while (std::isxdigit(p->program[p->idx])) {
+        char c = std::tolower(p->program[p->idx]);
+        uint64_t digit = std::isdigit(c) ? c - '0' : c - 'a' + 10;
+        if (digit >= base) {
+            break;
+        }
+        if (imm_val > (UINT64_MAX - digit) / base || (negative && imm_val * base + digit > (uint64_t)1 << 63)) {
+            syntax_error(p, "number too large");
+        }
+        imm_val = imm_val * base + digit;
+        parser_advance(p, 1);
+    }
+
+    skip_white_space(p);
+
+    return (int64_t)(negative ? 0 - imm_val : imm_val);
+}
+
+// #1.0, #-0.5, #2e-3, but not #16 or #0x10
+bool at_fp_number(Parser* p) {
+    int i = p->idx;
+    if (p->program[i] == '-') {
+        i++;
+    }
+    if (!std::isdigit(p->program[i]) || (p->program[i] == '0' && (p->program[i+1] == 'x' || p->program[i+1] == 'X'))) {
+        return false;
+    }
+    while (std::isdigit(p->program[i])) {
+        i++;
+    }
+    return p->program[i] == '.' || p->program[i] == 'e' || p->program[i] == 'E';
+}
+
+double read_fp_number(Parser* p) {
+    const char* start = p->program.c_str() + p->idx;
+    char* end;
+    double value = strtod(start, &end);
+    parser_advance(p, end - start);
+    skip_white_space(p);
+    return value;
+}
+
+Expr* read_expr(Parser* p);
+
+// number, symbol, (expr), -x, ~x, +x, !x
+Expr* read_primary(Parser* p) {
+    skip_white_space(p);
+
+    char c = p->program[p->idx];
+    if (c == '(') {
+        parser_advance(p, 1);
+        Expr* e = read_expr(p);
+        if (p->program[p->idx] != ')') {
+            syntax_error(p, "expected `)`");
+        }
+        parser_advance(p, 1);
+        skip_white_space(p);
+        return e;
+    }
+
+    if (c == '-' || c == '~' || c == '+' || c == '!') {
+        parser_advance(p, 1);
+        Expr* operand = read_primary(p);
+        if (operand->kind == EXPR_NUM) {
+            return new_expr(EXPR_NUM, 0, apply_unary(c, operand->value), nullptr, nullptr);
+        }
+        return new_expr(EXPR_UNARY, c, 0, operand, nullptr);
+    }
+
+    if (std::isdigit(c)) {
+        return new_expr(EXPR_NUM, 0, read_number(p), nullptr, nullptr);
+    }
+
+    if (c == '.' || c == '_' || std::isalpha(c)) {
+        std::string name = read_symbol(p);
+        if (equ_symbols.find(name) != equ_symbols.end()) {
+            return equ_symbols[name];
+        }
+        return new_expr(EXPR_LABEL, 0, label_id(name), nullptr, nullptr);
+    }
+
+    syntax_error(p, "expected an expression");
+}
+
+// the binary operator at p->idx, or nullptr
+BinaryOp* peek_binary_op(Parser* p) {
+    for (BinaryOp& op : binary_ops) {
+        if (p->program.compare(p->idx, op.token.size(), op.token) == 0) {
+            return &op;
+        }
+    }
+    return nullptr;
+}
+
+Expr* read_binary(Parser* p, int min_precedence) {
+    Expr* lhs = read_primary(p);
+
+    BinaryOp* binary;
+    while ((binary = peek_binary_op(p)) != nullptr && binary->precedence >= min_precedence) {
+        char op = binary->op;
+        parser_advance(p, binary->token.size());
+        Expr* rhs = read_binary(p, binary->precedence + 1);
+
+        if (lhs->kind == EXPR_NUM && rhs->kind == EXPR_NUM) {
+            int64_t value;
+            if (!apply_binary(op, lhs->value, rhs->value, &value)) {
+                syntax_error(p, "division by zero");
+            }
+            lhs = new_expr(EXPR_NUM, 0, value, nullptr, nullptr);
+        } else {
+            lhs = new_expr(EXPR_BINARY, op, 0, lhs, rhs);
+        }
+    }
+
+    return lhs;
+}
+
+Expr* read_expr(Parser* p) {
+    return read_binary(p, 0);
+}
+
+// an expression that must fold while parsing
+int64_t read_constant(Parser* p) {
+    Expr* e = read_expr(p);
+    if (e->kind != EXPR_NUM) {
+        syntax_error(p, "expected a constant expression");
+    }
+    return e->value;
+}
+
+// #imm and [base, #imm]; labels leave the value to resolve_exprs
+Operand* read_imm(Parser* p) {
+    Expr* e = read_expr(p);
+    if (e->kind == EXPR_NUM) {
+        return new_imm(e->value);
+    }
+    Operand* imm = new_imm(0);
+    imm->expr = e;
+    return imm;
+}
+
+inline Operand* parse_register(Parser* p) {
+
+    std::string ident = read_ident(p);
+    if (registers.find(ident) != registers.end()) {
+        skip_white_space(p);
+        return registers[ident];
+    }
+
+    syntax_error(p, "expected register operand");
+}
+
+inline Operand* parse_extend(Parser* p) {
+    std::string ident = read_ident(p);
+
+    // [base, Xm, LSL #amount] is encoded as UXTX
+    if (ident == "LSL" || ident == "lsl") {
+        ident = "UXTX";
+    }
+
+    if (extend_types.find(ident) != extend_types.end()) {
+        int extend_amout = 0;
+        if (p->program[p->idx] == '#') {
+            parser_advance(p, 1);
+            extend_amout = read_constant(p);
+        }
+        return new_extend(extend_types[ident], extend_amout);
+    }
+
+    syntax_error(p, "expected extend operand");
+}
+
+inline Operand* parse_shift(Parser* p) {
+    std::string ident = read_ident(p);
+
+    if (shift_types.find(ident) != shift_types.end()) {
+        int shift_amout = 0;
+        if (p->program[p->idx] == '#') {
+            parser_advance(p, 1);
+            shift_amout = read_constant(p);
+        }
+        return new_shift(shift_types[ident], shift_amout);
+    }
+
+    syntax_error(p, "expected shift operand");
+}
+
+// v0.4s, v0.s[1]
+Operand* parse_vector_register(Parser* p, Operand* regi) {
+    if (p->program[p->idx] != '.') {
+        syntax_error(p, "expected arrangement specifier");
+    }
+    parser_advance(p, 1); // skip `.`
+
+    Operand* op = new Operand(*regi);
+    std::string suffix = read_ident(p);
+
+    if (arrangements.find(suffix) != arrangements.end()) {
+        op->val = arrangements[suffix];
+        return op;
+    }
+
+    if (element_sizes.find(suffix) != element_sizes.end()) {
+        op->kind = VREG_ELEM;
+        op->val = element_sizes[suffix];
+        if (p->program[p->idx] != '[') {
+            syntax_error(p, "expected element index");
+        }
+        parser_advance(p, 1); // skip `[`
+        op->imm = read_constant(p);
+        if (p->program[p->idx] != ']') {
+            syntax_error(p, "expected `]`");
+        }
+        parser_advance(p, 1); // skip `]`
+        skip_white_space(p);
+        return op;
+    }
+
+    syntax_error(p, "unknown arrangement specifier");
+}
+
+// named system registers, pstate fields and the generic s<op0>_<op1>_c<n>_c<m>_<op2>
+Operand* parse_system_register(std::string ident) {
+    std::transform(ident.begin(), ident.end(), ident.begin(), ::tolower);
+
+    int sysreg = -1;
+    int pstate = -1;
+    if (system_registers.find(ident) != system_registers.end()) {
+        sysreg = system_registers[ident].encoding;
+    }
+    if (pstate_fields.find(ident) != pstate_fields.end()) {
+        pstate = pstate_fields[ident].encoding;
+    }
+
+    int op0, op1, crn, crm, op2, len = 0;
+    if (sscanf(ident.c_str(), "s%d_%d_c%d_c%d_%d%n", &op0, &op1, &crn, &crm, &op2, &len) == 5 && len == (int)ident.size() &&
+        op0 >= 2 && op0 <= 3 && op1 >= 0 && op1 <= 7 && crn >= 0 && crn <= 15 && crm >= 0 && crm <= 15 && op2 >= 0 && op2 <= 7) {
+        sysreg = SYS_REG(op0, op1, crn, crm, op2);
+    }
+
+    if (sysreg < 0 && pstate < 0) {
+        return nullptr;
+    }
+
+    Operand* op = new Operand;
+    op->kind = SYSREG;
+    op->val = sysreg;
+    op->amount = pstate;
+    return op;
+}
+
+// z0.s, p0, p0.s, p0/z, p0/m
+Operand* parse_sve_register(Parser* p, Operand* regi) {
+    Operand* op = new Operand(*regi);
+    op->val = -1;
+
+    if (p->program[p->idx] == '.') {
+        parser_advance(p, 1); // skip `.`
+        std::string suffix = read_ident(p);
+        if (element_sizes.find(suffix) == element_sizes.end()) {
+            syntax_error(p, "unknown element size specifier");
+        }
+        op->val = element_sizes[suffix];
+    } else if (p->program[p->idx] == '/' && regi->kind == PREG) {
+        parser_advance(p, 1); // skip `/`
+        std::string qualifier = read_ident(p);
+        if (qualifier == "z") {
+            op->kind = PREG_ZERO;
+        } else if (qualifier == "m") {
+            op->kind = PREG_MERGE;
+        } else {
+            syntax_error(p, "expected predicate qualifier `/z` or `/m`");
+        }
+    }
+
+    if (op->kind == ZREG && op->val < 0) {
+        syntax_error(p, "expected element size specifier");
+    }
+    return op;
+}
+
+// { v0.4s, v1.4s }, { v0.4s-v3.4s }, { z0.s }
+Operand* parse_vector_list(Parser* p) {
+    parser_advance(p, 1); // skip `{`
+
+    Operand* list = new Operand;
+    list->kind = VREG_LIST;
+    list->amount = 0;
+
+    while (true) {
+        Operand* vreg = parse_register(p);
+        if (vreg->kind == ZREG) {
+            list->kind = ZREG_LIST;
+            vreg = parse_sve_register(p, vreg);
+        } else if (vreg->kind == VREG) {
+            vreg = parse_vector_register(p, vreg);
+            if (vreg->kind != VREG) {
+                syntax_error(p, "expected vector arrangement");
+            }
+        } else {
+            syntax_error(p, "expected vector register");
+        }
+
+        if (list->amount == 0) {
+            list->regi_bits = vreg->regi_bits;
+            list->val = vreg->val;
+            list->amount = 1;
+        } else {
+            if (vreg->val != list->val || vreg->regi_bits != (list->regi_bits + list->amount) % 32) {
+                syntax_error(p, "vector list registers must be consecutive with the same arrangement");
+            }
+            list->amount++;
+        }
+
+        if (p->program[p->idx] == '-') {
+            parser_advance(p, 1); // skip `-`
+            Operand* last = parse_register(p);
+            if (last->kind != VREG && last->kind != ZREG) {
+                syntax_error(p, "expected vector register");
+            }
+            last = last->kind == ZREG ? parse_sve_register(p, last) : parse_vector_register(p, last);
+            if (last->val != list->val) {
+                syntax_error(p, "vector list registers must have the same arrangement");
+            }
+            list->amount = (last->regi_bits - list->regi_bits + 32) % 32 + 1;
+        }
+
+        if (p->program[p->idx] == ',') {
+            parser_advance(p, 1); // skip `,`
+            continue;
+        }
+        if (p->program[p->idx] != '}') {
+            syntax_error(p, "expected `}`");
+        }
+        parser_advance(p, 1); // skip `}`
+        skip_white_space(p);
+        break;
+    }
+
+    if (list->amount > 4) {
+        syntax_error(p, "too many registers in vector list");
+    }
+    return list;
+}
+
+/*
+    MEM_OP_BASE            -> [ register ]
+
+    MEM_OP_IMM_OFFSET      -> [ register, immediate ]
+
+    MEM_OP_IMM_OFFSET_PRE  -> [ register, immediate ]!
+
+    MEM_OP_REGI_OFFSET     -> [ register, register ]
+    MEM_OP_REGI_OFFSET     -> [ register, register, LSL #0 ]
+
+    LITERAL                -> =immediate
+
+    FP_IMM                 -> #1.0 | #-2.5e-1
+
+    VREG                   -> v0.4s
+    VREG_ELEM              -> v0.s[1]
+    VREG_LIST              -> { v0.4s, v1.4s } | { v0.4s-v3.4s }
+
+    ZREG                   -> z0.s
+    ZREG_LIST              -> { z0.s }
+    PREG                   -> p0 | p0.s
+    PREG_ZERO              -> p0/z
+    PREG_MERGE             -> p0/m
+    SVE_PATTERN            -> pow2 | vl1 ... vl256 | mul4 | mul3 | all
+    SVE_MUL                -> mul #immediate
+    MEM_OP_VL_OFFSET       -> [ register, immediate, mul vl ]
+
+    SYSREG                 -> cntvct_el0 | s3_3_c14_c0_2 | daifset
+
+    LABEL                  -> identifier | .identifier | 1b | 1f
+*/
+
+Operand* parse_operand(Parser* p) {
+    skip_white_space(p);
+
+    if (p->program[p->idx] == '#') {
+        parser_advance(p, 1);
+
+        if (at_fp_number(p)) {
+            Operand* fp_imm = new Operand;
+            fp_imm->kind = FP_IMM;
+            fp_imm->fp_imm = read_fp_number(p);
+            return fp_imm;
+        }
+
+        return read_imm(p);
+    }
+
+    if (p->program[p->idx] == '=') {
+        parser_advance(p, 1);
+
+        Operand* literal = new_imm(read_constant(p));
+        literal->kind = LITERAL;
+
+        return literal;
+    }
+
+    if (p->program[p->idx] == '[') {
+        Operand* mem_op = new Operand;
+        parser_advance(p, 1); // skip `[`
+        mem_op->base_register = parse_register(p);
+        if (mem_op->base_register->kind == XR && mem_op->base_register->regi_bits == 31) {
+            syntax_error(p, "xzr can't be a base register");
+        }
+        switch (p->program[p->idx]) {
+            case ']':
+                mem_op->kind = MEM_OP_BASE;
+                mem_op->offset = new_imm(0); // [base] is also [base, #0]
+                break;
+            case ',':
+                parser_advance(p, 1); // skip `,`
+                skip_white_space(p);
+                if (p->program[p->idx] == '#') { // imm offset
+                    mem_op->kind = MEM_OP_IMM_OFFSET;
+                    parser_advance(p, 1); // skip `#`
+                    mem_op->offset = read_imm(p);
+                    if (p->program[p->idx] == ',') { // SVE vector length multiple
+                        parser_advance(p, 1); // skip `,`
+                        if (read_ident(p) != "mul" || read_ident(p) != "vl") {
+                            syntax_error(p, "expected `mul vl`");
+                        }
+                        mem_op->kind = MEM_OP_VL_OFFSET;
+                    }
+                } else { // register offset
+                    mem_op->kind = MEM_OP_REGI_OFFSET;
+                    mem_op->offset = parse_register(p);
+                    if (p->program[p->idx] == ',') {
+                        parser_advance(p, 1); // skip `,`
+                        mem_op->extend_offset = parse_extend(p);
+                    } else {
+                        mem_op->extend_offset = new_extend(UXTX, 0);
+                    }
+                }
+                break;
+        }
+        if (p->program[p->idx] != ']') {
+            syntax_error(p, "expected `]`");
+        }
+        parser_advance(p, 1); // skip `]`
+        skip_white_space(p);
+        if (p->program[p->idx] == '!') {
+            switch (mem_op->kind) {
+                case MEM_OP_BASE:
+                    mem_op->kind = MEM_OP_BASE_PRE;
+                    break;
+                case MEM_OP_IMM_OFFSET:
+                    mem_op->kind = MEM_OP_IMM_OFFSET_PRE;
+                    break;
+                default:
+                    syntax_error(p, "expected `!`");
+            }
+            parser_advance(p, 1); // skip `!`
+        }
+        return mem_op;
+    }
+
+    if (p->program[p->idx] == '{') {
+        return parse_vector_list(p);
+    }
+
+    if (p->program[p->idx] == '.') { // local label
+        parser_advance(p, 1);
+        return new_label(label_id("." + read_ident(p)));
+    }
+
+    std::string ident = read_ident(p);
+
+    if (is_numeric_label_ref(ident)) {
+        return new_numeric_label(numeric_label(p, ident.substr(0, ident.size() - 1)), ident.back() == 'b' ? LABEL_BACKWARD : LABEL_FORWARD);
+    }
+
+    if (registers.find(ident) != registers.end()) {
+        if (registers[ident]->kind == VREG) {
+            return parse_vector_register(p, registers[ident]);
+        }
+        if (registers[ident]->kind == ZREG || registers[ident]->kind == PREG) {
+            return parse_sve_register(p, registers[ident]);
+        }
+        return registers[ident];
+    }
+
+    if (shift_types.find(ident) != shift_types.end()) {
+        int shift_amout = 0;
+        if (p->program[p->idx] == '#') {
+            parser_advance(p, 1);
+            shift_amout = read_constant(p);
+        }
+        return new_shift(shift_types[ident], shift_amout);
+    }
+
+    if (extend_types.find(ident) != extend_types.end()) {
+        int extend_amout = 0;
+        if (p->program[p->idx] == '#') {
+            parser_advance(p, 1);
+            extend_amout = read_constant(p);
+        }
+        return new_extend(extend_types[ident], extend_amout);
+    }
+
+    if (cond_types.find(ident) != cond_types.end()) {
+        return new_cond(cond_types[ident]);
+    }
+
+    if (barrier_options.find(ident) != barrier_options.end()) {
+        return new_named_op(BARRIER_OPT, barrier_options[ident]);
+    }
+
+    if (prefetch_ops.find(ident) != prefetch_ops.end()) {
+        return new_named_op(PRFOP, prefetch_ops[ident]);
+    }
+
+    if (dc_ops.find(ident) != dc_ops.end()) {
+        return new_named_op(DC_OP, dc_ops[ident]);
+    }
+
+    if (ic_ops.find(ident) != ic_ops.end()) {
+        return new_named_op(IC_OP, ic_ops[ident]);
+    }
+
+    if (Operand* sysreg = parse_system_register(ident)) {
+        return sysreg;
+    }
+
+    if (sve_patterns.find(ident) != sve_patterns.end()) {
+        Operand* pattern = new Operand;
+        pattern->kind = SVE_PATTERN;
+        pattern->val = sve_patterns[ident];
+        return pattern;
+    }
+
+    if (ident == "mul" && p->program[p->idx] == '#') {
+        parser_advance(p, 1); // skip `#`
+        Operand* mul = new Operand;
+        mul->kind = SVE_MUL;
+        mul->amount = read_constant(p);
+        return mul;
+    }
+
+    if (ident.empty()) {
+        syntax_error(p, "unkown operand found");
+    }
+
+    return new_label(label_id(ident));
+}
+
+inline uint64_t imm_chunk(uint64_t value, int hw) {
+    return (value >> (hw * 16)) & 0xffff;
+}
+
+Instr new_mov_chunk(std::string name, Operand* rd, uint64_t chunk, int hw, int line) {
+    return Instr { name, new Operand*[3] { rd, new_imm(chunk), new_shift(LSL, hw * 16) }, 3, line };
+}
+
+// mov rd, #imm -> the shortest of
+//   mov (movz, movn or orr bitmask)
+//   movz + movk for every other non-zero chunk
+//   movn + movk for every other chunk that is not 0xffff
+//   orr bitmask matching all but one or two chunks + movk for those chunks
+void expand_mov_imm(Parser* p, Operand* rd, int64_t imm, int line) {
+    int reg_size = rd->kind == WR ? 32 : 64;
+    if (reg_size == 32 && (imm < INT32_MIN || imm > UINT32_MAX)) {
+        syntax_error(p, "immediate out of range for a 32bit register");
+    }
+
+    uint64_t value = (uint64_t)imm & reg_mask(reg_size);
+    int chunks = reg_size / 16;
+
+    if (wide_imm_hw(value, reg_size) >= 0 || wide_imm_hw(~value, reg_size) >= 0 || bitmask_imm(value, reg_size, nullptr)) {
+        instrs.push_back(Instr { "mov", new Operand*[2] { rd, new_imm(value) }, 2, line });
+        return;
+    }
+
+    int movz_len = 0;
+    int movn_len = 0;
+    for (int hw = 0; hw < chunks; hw++) {
+        if (imm_chunk(value, hw) != 0) movz_len++;
+        if (imm_chunk(value, hw) != 0xffff) movn_len++;
+    }
+
+    int best_len = std::min(movz_len, movn_len);
+    int orr_patch = 0;
+    uint64_t orr_value = 0;
+    for (int n = 1; n <= 2 && 1 + n < best_len && orr_patch == 0; n++) {
+        for (int patch = 1; patch < (1 << chunks) && orr_patch == 0; patch++) {
+            if (__builtin_popcount(patch) != n) continue;
+
+            std::vector<uint64_t> fillers = { 0, 0xffff };
+            for (int hw = 0; hw < chunks; hw++) {
+                if (!(patch & (1 << hw))) fillers.push_back(imm_chunk(value, hw));
+            }
+
+            // every assignment of fillers to the patched chunks
+            int combinations = n == 1 ? fillers.size() : fillers.size() * fillers.size();
+            for (int c = 0; c < combinations; c++) {
+                uint64_t candidate = value;
+                int k = c;
+                for (int hw = 0; hw < chunks; hw++) {
+                    if (!(patch & (1 << hw))) continue;
+                    candidate = (candidate & ~(0xffffull << (hw * 16))) | (fillers[k % fillers.size()] << (hw * 16));
+                    k /= fillers.size();
+                }
+                if (bitmask_imm(candidate, reg_size, nullptr)) {
+                    orr_patch = patch;
+                    orr_value = candidate;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (orr_patch != 0) {
+        instrs.push_back(Instr { "mov", new Operand*[2] { rd, new_imm(orr_value) }, 2, line });
+        for (int hw = 0; hw < chunks; hw++) {
+            if (orr_patch & (1 << hw)) instrs.push_back(new_mov_chunk("movk", rd, imm_chunk(value, hw), hw, line));
+        }
+        return;
+    }
+
+    bool use_movn = movn_len < movz_len;
+    uint64_t skip = use_movn ? 0xffff : 0;
+    bool first = true;
+    for (int hw = 0; hw < chunks; hw++) {
+        uint64_t chunk = imm_chunk(value, hw);
+        if (chunk == skip) continue;
+        if (first) {
+            instrs.push_back(new_mov_chunk(use_movn ? "movn" : "movz", rd, use_movn ? ~chunk & 0xffff : chunk, hw, line));
+            first = false;
+        } else {
+            instrs.push_back(new_mov_chunk("movk", rd, chunk, hw, line));
+        }
+    }
+}
+
+// .p2align n[, , max] and .balign n[, , max]. Padding in .text is always nop.
+void parse_align(Parser* p, bool power_of_two) {
+    int line = p->line;
+
+    int64_t n = read_constant(p);
+    if (power_of_two && (n < 0 || n > 16)) {
+        syntax_error(p, "alignment too large");
+    }
+    int64_t align = power_of_two ? 1ll << n : n;
+    if (align <= 0 || (align & (align - 1)) != 0) {
+        syntax_error(p, "alignment must be a power of 2");
+    }
+
+    int64_t max_skip = align;
+    if (p->program[p->idx] == ',') {
+        parser_advance(p, 1);
+        skip_white_space(p);
+        if (p->program[p->idx] != ',') {
+            syntax_error(p, "fill values are not supported in .text");
+        }
+        parser_advance(p, 1);
+        max_skip = read_constant(p);
+    }
+
+    // instructions are always 4 byte aligned
+    if (align > 4) {
+        instrs.push_back(Instr { ".align", new Operand*[2] { new_imm(align), new_imm(max_skip) }, 2, line });
+    }
+}
+
+void expect_comma(Parser* p) {
+    skip_white_space(p);
+    if (p->program[p->idx] != ',') {
+        syntax_error(p, "expected `,`");
+    }
+    parser_advance(p, 1);
+    skip_white_space(p);
+}
+
+std::unordered_map<std::string, uint8_t> symbol_types = {
+    {"%function", STT_FUNC},
+    {"@function", STT_FUNC},
+    {"%object", STT_OBJECT},
+    {"@object", STT_OBJECT},
+    {"%notype", STT_NOTYPE},
+    {"@notype", STT_NOTYPE},
+};
+
+// .globl sym
+void parse_globl(Parser* p) {
+    symbols[label_id(read_symbol(p))].global = true;
+}
+
+// .type sym, %function
+void parse_type(Parser* p) {
+    int id = label_id(read_symbol(p));
+    expect_comma(p);
+
+    char prefix = p->program[p->idx];
+    parser_advance(p, 1);
+    std::string type = prefix + read_ident(p);
+    if (symbol_types.find(type) == symbol_types.end()) {
+        syntax_error(p, "unknown symbol type `" + type + "`");
+    }
+    symbols[id].type = symbol_types[type];
+}
+
+// .size sym, n and .size sym, . - sym
+void parse_size(Parser* p) {
+    int line = p->line;
+    int id = label_id(read_symbol(p));
+    expect_comma(p);
+
+    if (p->program[p->idx] != '.') {
+        int64_t size = read_constant(p);
+        if (size < 0 || size > INT32_MAX) {
+            syntax_error(p, "symbol size out of range");
+        }
+        symbols[id].size = size;
+        return;
+    }
+
+    parser_advance(p, 1);
+    skip_white_space(p);
+    if (p->program[p->idx] != '-') {
+        syntax_error(p, "expected `. - " + label_name(id) + "`");
+    }
+    parser_advance(p, 1);
+    if (label_id(read_symbol(p)) != id) {
+        syntax_error(p, "expected `. - " + label_name(id) + "`");
+    }
+    instrs.push_back(Instr { ".size", new Operand*[1] { new_label(id) }, 1, line });
+}
+
+// flags of a section without a flags string
+uint64_t default_section_flags(std::string& name) {
+    auto is = [&](std::string prefix) {
+        return name == prefix || name.compare(0, prefix.size() + 1, prefix + ".") == 0;
+    };
+    if (is(".text")) {
+        return SHF_ALLOC | SHF_EXECINSTR;
+    }
+    if (is(".data")) {
+        return SHF_ALLOC | SHF_WRITE;
+    }
+    if (is(".rodata")) {
+        return SHF_ALLOC;
+    }
+    return 0;
+}
+
+// The flags of an existing section are kept.
+void switch_section(Parser* p, std::string name, uint64_t flags) {
+    int id = section_id(name, flags);
+    if (id < 0) {
+        syntax_error(p, "too many sections");
+    }
+    instrs.push_back(Instr { ".section", new Operand*[1] { new_imm(id) }, 1, p->line });
+}
+
+// .section name[, "flags"[, @progbits]]
+void parse_section(Parser* p) {
+    skip_white_space(p);
+    int start = p->idx;
+    while (std::isalnum(p->program[p->idx]) || p->program[p->idx] == '_' || p->program[p->idx] == '.' || p->program[p->idx] == '$') {
+        parser_advance(p, 1);
+    }
+    std::string name = p->program.substr(start, p->idx - start);
+    if (name.empty()) {
+        syntax_error(p, "expected a section name");
+    }
+    skip_white_space(p);
+
+    uint64_t flags = default_section_flags(name);
+    if (p->program[p->idx] == ',') {
+        expect_comma(p);
+        if (p->program[p->idx] != '"') {
+            syntax_error(p, "expected `\"flags\"`");
+        }
+        parser_advance(p, 1);
+        flags = 0;
+        for (; p->program[p->idx] != '"'; parser_advance(p, 1)) {
+            switch (p->program[p->idx]) {
+                case 'a': flags |= SHF_ALLOC; break;
+                case 'w': flags |= SHF_WRITE; break;
+                case 'x': flags |= SHF_EXECINSTR; break;
+                default:  syntax_error(p, "unsupported section flag `" + std::string(1, p->program[p->idx]) + "`");
+            }
+        }
+        parser_advance(p, 1);
+        skip_white_space(p);
+
+        if (p->program[p->idx] == ',') {
+            expect_comma(p);
+            char prefix = p->program[p->idx];
+            parser_advance(p, 1);
+            if ((prefix != '@' && prefix != '%') || read_ident(p) != "progbits") {
+                syntax_error(p, "only progbits sections are supported");
+            }
+        }
+    }
+    switch_section(p, name, flags);
+}
+
+// .equ name, expr and .set name, expr. Uses see the value of the latest definition before them.
+void parse_equ(Parser* p) {
+    std::string name = read_symbol(p);
+    int id = find_label(name);
+    if (id >= 0 && symbols[id].defined) {
+        syntax_error(p, "`" + name + "` is already defined as a label");
+    }
+    expect_comma(p);
+    equ_symbols[name] = read_expr(p);
+}
+
+// .include "file" parses the file in place. Every file is read once, later includes reuse
+// its content, and a file with `.pragma once` or a defined include guard is skipped without
+// being parsed again.
+
+#define INCLUDE_MAX_DEPTH 64
+
+std::vector<std::string> include_dirs;            // -I, in order
+std::unordered_map<std::string, int> source_ids; // realpath -> index into source_files
+int include_depth = 0;
+
+std::string read_file(std::string file_path);
+void parse_program(Parser* p);
+
+// .equ/.set symbols and labels defined so far
+bool is_defined(std::string name) {
+    if (equ_symbols.find(name) != equ_symbols.end()) {
+        return true;
+    }
+    int id = find_label(name);
+    return id >= 0 && symbols[id].defined;
+}
+
+int load_source(std::string path, std::string real_path) {
+    if (source_ids.find(real_path) != source_ids.end()) {
+        return source_ids[real_path];
+    }
+    std::string content = read_file(path);
+    {
+        std::lock_guard<std::mutex> guard(source_files_lock);
+        source_files.push_back(SourceFile { path, std::move(content), false, "" });
+    }
+    source_ids[real_path] = source_files.size() - 1;
+    return source_files.size() - 1;
+}
+
+// relative to the working directory, then to every -I directory
+std::string find_include(Parser* p, std::string name, std::string* real_path) {
+    std::vector<std::string> candidates = { name };
+    if (name[0] != '/') {
+        for (std::string& dir : include_dirs) {
+            candidates.push_back(dir + "/" + name);
+        }
+    }
+
+    char buf[PATH_MAX];
+    for (std::string& path : candidates) {
+        if (realpath(path.c_str(), buf) != nullptr) {
+            *real_path = buf;
+            return path;
+        }
+    }
+    syntax_error(p, "include file `" + name + "` not found");
+}
+
+void parse_include(Parser* p) {
+    if (p->stream != nullptr) {
+        pipeline_read_all(p);
+    }
+    skip_white_space(p);
+    if (p->program[p->idx] != '"') {
+        syntax_error(p, "expected `\"file\"`");
+    }
+    parser_advance(p, 1);
+    size_t end = p->program.find('"', p->idx);
+    if (end == std::string::npos || p->program.find('\n', p->idx) < end) {
+        syntax_error(p, "expected closing `\"`");
+    }
+    std::string name = p->program.substr(p->idx, end - p->idx);
+    parser_advance(p, end + 1 - p->idx);
+    skip_white_space(p);
+
+    std::string real_path;
+    std::string path = find_include(p, name, &real_path);
+    int file = load_source(path, real_path);
+    if (source_files[file].once || (!source_files[file].guard.empty() && is_defined(source_files[file].guard))) {
+        return;
+    }
+    if (include_depth == INCLUDE_MAX_DEPTH) {
+        syntax_error(p, "includes nested too deeply");
+    }
+
+    size_t first = instrs.size();
+    Parser* included = new_parser(path, source_files[file].content);
+    included->file = file;
+    include_depth++;
+    parse_program(included);
+    include_depth--;
+    delete included;
+
+    // instructions of nested includes already have their file
+    for (size_t i = first; i < instrs.size(); i++) {
+        if (instrs[i].file == 0) {
+            instrs[i].file = file;
+        }
+    }
+}
+
+// --- conditional assembly: .if expr, .ifdef sym, .ifndef sym, .else, .endif
+
+// `.name` at the start of a line, or "" when there is none. The name is read like read_ident
+// does, so `.endif_x` is not `.endif`.
+std::string line_directive(const char* c, const char* end) {
+    if (c == end || *c != '.') {
+        return "";
+    }
+    const char* start = c++;
+    while (c < end && (std::isalnum(*c) || *c == '_')) {
+        c++;
+    }
+    return std::string(start, c);
+}
+
+// Skips a disabled block and stops after its `.endif`, or after its `.else` when stop_at_else.
+// Only lines starting with `.` can open or close a block, so instead of parsing every line
+// the scan jumps from `.` to `.` with memchr and skips those that are not at a line start.
+// Lines are counted once per skipped range, again with a single vectorized pass.
+// Returns true when it stopped at `.else`. A missing `.endif` is reported at if_line, the
+// line of the block's `.if`.
+bool skip_conditional(Parser* p, bool stop_at_else, int if_line) {
+    if (p->stream != nullptr) {
+        pipeline_read_all(p);
+    }
+    const char* begin = p->program.data();
+    const char* end = begin + p->program.size();
+    const char* c = begin + p->idx;
+    const char* counted = c;
+    int depth = 0;
+
+    while ((c = (const char*)memchr(c, '.', end - c)) != nullptr) {
+        const char* line_start = c;
+        while (line_start > begin && (line_start[-1] == ' ' || line_start[-1] == '\t')) {
+            line_start--;
+        }
+        if (line_start > begin && line_start[-1] != '\n') {
+            c++;
+            continue;
+        }
+
+        std::string name = line_directive(c, end);
+        c += name.size();
+        if (name == ".if" || name == ".ifdef" || name == ".ifndef") {
+            depth++;
+        } else if (name == ".endif" || name == ".else") {
+            if (depth == 0 && name == ".else" && !stop_at_else) {
+                p->line += std::count(counted, c, '\n');
+                syntax_error(p, "unexpected .else");
+            }
+            if (depth == 0) {
+                p->line += std::count(counted, c, '\n');
+                p->idx = c - begin;
+                skip_white_space(p);
+                return name == ".else";
+            }
+            if (name == ".endif") {
+                depth--;
+            }
+        }
+    }
+
+    p->line = if_line;
+    syntax_error(p, "missing .endif");
+}
+
+void begin_conditional(Parser* p, bool enabled) {
+    int line = p->line;
+    if (enabled || skip_conditional(p, true, line)) {
+        p->conds.push_back(Conditional { line, !enabled });
+    }
+}
+
+// .ifndef GUARD at the very start of a file
+void parse_ifndef(Parser* p) {
+    size_t first = p->program.find_first_not_of(" \t\n");
+    bool leading = p->conds.empty() && p->program.find('\n', first) >= (size_t)p->idx;
+
+    std::string name = read_symbol(p);
+    if (leading && !is_defined(name)) {
+        p->guard = name;
+    }
+    begin_conditional(p, !is_defined(name));
+}
+
+void parse_else(Parser* p) {
+    if (p->conds.empty() || p->conds.back().in_else) {
+        syntax_error(p, "unexpected .else");
+    }
+    if (p->conds.size() == 1) {
+        p->guard.clear();
+    }
+    // the .if branch was assembled, so the .else branch is not
+    skip_conditional(p, false, p->conds.back().line);
+    p->conds.pop_back();
+}
+
+void parse_endif(Parser* p) {
+    if (p->conds.empty()) {
+        syntax_error(p, "unexpected .endif");
+    }
+    p->conds.pop_back();
+
+    // the leading .ifndef encloses the whole file
+    if (p->conds.empty() && !p->guard.empty()) {
+        if (p->stream != nullptr) {
+            pipeline_read_all(p);
+        }
+        if (p->program.find_first_not_of(" \t\n", p->idx) == std::string::npos) {
+            source_files[p->file].guard = p->guard;
+        }
+        p->guard.clear();
+    }
+}
+
+std::unordered_map<std::string, std::function<void(Parser*)>> directive_table = {
+    {".ltorg", [](Parser* p) {
+        instrs.push_back(Instr { ".ltorg", nullptr, 0, p->line });
+    }},
+    {".p2align", [](Parser* p) {
+        parse_align(p, true);
+    }},
+    {".balign", [](Parser* p) {
+        parse_align(p, false);
+    }},
+    {".globl", [](Parser* p) {
+        parse_globl(p);
+    }},
+    {".global", [](Parser* p) {
+        parse_globl(p);
+    }},
+    {".type", [](Parser* p) {
+        parse_type(p);
+    }},
+    {".size", [](Parser* p) {
+        parse_size(p);
+    }},
+    {".equ", [](Parser* p) {
+        parse_equ(p);
+    }},
+    {".set", [](Parser* p) {
+        parse_equ(p);
+    }},
+    {".section", [](Parser* p) {
+        parse_section(p);
+    }},
+    {".text", [](Parser* p) {
+        switch_section(p, ".text", SHF_ALLOC | SHF_EXECINSTR);
+    }},
+    {".data", [](Parser* p) {
+        switch_section(p, ".data", SHF_ALLOC | SHF_WRITE);
+    }},
+    {".rodata", [](Parser* p) {
+        switch_section(p, ".rodata", SHF_ALLOC);
+    }},
+    {".include", [](Parser* p) {
+        parse_include(p);
+    }},
+    {".if", [](Parser* p) {
+        begin_conditional(p, read_constant(p) != 0);
+    }},
+    {".ifdef", [](Parser* p) {
+        begin_conditional(p, is_defined(read_symbol(p)));
+    }},
+    {".ifndef", [](Parser* p) {
+        parse_ifndef(p);
+    }},
+    {".else", [](Parser* p) {
+        parse_else(p);
+    }},
+    {".endif", [](Parser* p) {
+        parse_endif(p);
+    }},
+    {".pragma", [](Parser* p) {
+        if (read_ident(p) != "once") {
+            syntax_error(p, "unknown pragma");
+        }
+        source_files[p->file].once = true;
+    }},
+};
+
+void define_label(Parser* p, std::string name) {
+    parser_advance(p, 1); // skip `:`
+
+    if (std::all_of(name.begin(), name.end(), ::isdigit)) {
+        instrs.push_back(Instr { ".nlabel", new Operand*[1] { new_imm(numeric_label(p, name)) }, 1, p->line });
+        return;
+    }
+
+    if (equ_symbols.find(name) != equ_symbols.end()) {
+        syntax_error(p, "`" + name + "` is already defined by .equ/.set");
+    }
+    int id = label_id(name);
+    if (symbols[id].defined) {
+        syntax_error(p, "label `" + name + "` is already defined");
+    }
+    symbols[id].defined = true;
+    instrs.push_back(Instr { ".label", new Operand*[1] { new_label(id) }, 1, p->line });
+}
+
+void parse_program(Parser* p) {
+    while (!at_eof(p)) {
+        if (p->stream != nullptr) {
+            pipeline_next_line(p);
+        }
+        skip_white_space(p);
+
+        if (p->program[p->idx] == '\n') {
+            parser_advance(p, 1);
+            p->line++;
+            continue;
+        }
+
+        if (p->program[p->idx] == '.') {
+            parser_advance(p, 1);
+            std::string directive_name = "." + read_ident(p);
+
+            if (p->program[p->idx] == ':') {
+                define_label(p, directive_name);
+                continue;
+            }
+
+            if (directive_table.find(directive_name) == directive_table.end()) {
+                syntax_error(p, "unknown directive `" + directive_name + "`");
+            }
+            directive_table[directive_name](p);
+        } else {
+            int line = p->line;
+            std::string instr_name = read_ident(p);
+
+            if (p->program[p->idx] == ':') {
+                define_label(p, instr_name);
+                continue;
+            }
+
+            Operand** operands = new Operand*[5];
+
+            int operand_length = 0;
+
+            // b.<cond> is parsed as `b cond, label`; `b .Llabel` is a plain branch
+            if (instr_name == "b" && p->program[p->idx] == '.' && p->program[p->idx - 1] == 'b') {
+                parser_advance(p, 1); // skip `.`
+                std::string cond = read_ident(p);
+                if (cond_types.find(cond) != cond_types.end()) {
+                    operands[operand_length++] = new_cond(cond_types[cond]);
+                } else if (sve_cond_aliases.find(cond) != sve_cond_aliases.end()) {
+                    operands[operand_length++] = new_cond(sve_cond_aliases[cond]);
+                } else {
+                    syntax_error(p, "unknown condition `" + cond + "`");
+                }
+            }
+
+            while (p->program[p->idx] != '\n' && p->program[p->idx] != '\0') {
+                if (operand_length > 4) {
+                    break;
+                }
+
+                operands[operand_length++] = parse_operand(p);
+                skip_white_space(p);
+                if (p->program[p->idx] == ',') {
+                    parser_advance(p, 1);
+                } else {
+                    break;
+                }
+            }
+
+            if (instr_name == "mov" && operand_length == 2 && (operands[0]->kind == XR || operands[0]->kind == WR) && operands[1]->kind == IMM && !operands[1]->expr) {
+                expand_mov_imm(p, operands[0], operands[1]->imm, line);
+            } else {
+                instrs.push_back(Instr { instr_name, operands, operand_length, line });
+            }
+        }
+
+        char c = p->program[p->idx];
+
+        if (c == '\n' || c == '\0') {
+            parser_advance(p, 1);
+            p->line++;
+        } else {
+            syntax_error(p, "expected a new line or EOF");
+        }
+    }
+
+    if (!p->conds.empty()) {
+        p->line = p->conds.back().line;
+        syntax_error(p, "missing .endif");
+    }
+}
+
+[[noreturn]] void encode_error(std::string file_path, int line, std::string msg) {
+    std::cerr << "\u001b[1m" << file_path << ":" << line << ": \x1b[91merror:\x1b[0m\u001b[1m " << msg << "\033[0m" << std::endl;
+    _exit(1);
+}
+
+// the instruction instr_table is encoding, for operand_error
+Instr* encoding_instr = nullptr;
+
+[[noreturn]] void operand_error(std::string msg) {
+    if (encoding_instr == nullptr) {
+        std::cerr << "unreachable" << std::endl;
+        _exit(1);
+    }
+    encode_error(source_path(encoding_instr->file), encoding_instr->line, msg + " for `" + encoding_instr->name + "`");
+}
+
+// --function-sections: every function label in .text starts a section .text.<name>. This runs
+// after parsing, so .type may come after the label and a parsed IR can be split as well.
+void split_function_sections() {
+    std::vector<Instr> split;
+    split.reserve(instrs.size() + sections.size());
+
+    int section = 0;
+    for (Instr& in : instrs) {
+        if (in.name == ".section") {
+            section = in.operands[0]->imm;
+        } else if (in.name == ".label" && symbols[in.operands[0]->imm].type == STT_FUNC && (section == 0 || sections[section].function)) {
+            section = section_id(".text." + label_name(in.operands[0]->imm), SHF_ALLOC | SHF_EXECINSTR);
+            if (section < 0) {
+                encode_error(source_files[in.file].path, in.line, "too many sections");
+            }
+            sections[section].function = true;
+            split.push_back(Instr { ".section", new Operand*[1] { new_imm(section) }, 1, in.line, in.file });
+        }
+        split.push_back(std::move(in));
+    }
+    instrs = std::move(split);
+}
+
+// the alignment in needs from its section
+int64_t section_align(Instr& in) {
+    if (in.name == ".align") {
+        return in.operands[0]->imm;
+    }
+    // 8 byte literals are 8 byte aligned in the pool
+    if (in.operand_length == 2 && in.operands[1]->kind == LITERAL && (in.operands[0]->kind == XR || in.operands[0]->kind == DR)) {
+        return 8;
+    }
+    return 4;
+}
+
+// Moves the instructions of every section together, executable sections first, so that
+// each section becomes one range of code, and gives every section the largest alignment
+// requested in it. Every range after .text starts with its .section.
+void group_sections() {
+    std::vector<size_t> counts(sections.size());
+    bool markers = false;
+    int section = 0;
+    for (Instr& in : instrs) {
+        if (in.name == ".section") {
+            section = in.operands[0]->imm;
+            markers = true;
+            continue;
+        }
+
+        sections[section].align = std::max(sections[section].align, section_align(in));
+        counts[section]++;
+    }
+
+    if (sections.size() == 1) {
+        if (!markers) {
+            return;
+        }
+        instrs.erase(std::remove_if(instrs.begin(), instrs.end(), [](Instr& in) { return in.name == ".section"; }), instrs.end());
+        return;
+    }
+
+    std::vector<std::vector<Instr>> groups(sections.size());
+    for (size_t i = 0; i < sections.size(); i++) {
+        groups[i].reserve(counts[i]);
+    }
+    section = 0;
+    for (Instr& in : instrs) {
+        if (in.name == ".section") {
+            section = in.operands[0]->imm;
+            continue;
+        }
+        groups[section].push_back(std::move(in));
+    }
+
+    std::vector<int> order(sections.size());
+    for (size_t i = 0; i < sections.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [](int a, int b) {
+        return section_kind(sections[a]) < section_kind(sections[b]);
+    });
+
+    instrs.clear();
+    for (int id : order) {
+        if (id != 0) {
+            instrs.push_back(Instr { ".section", new Operand*[1] { new_imm(id) }, 1, 0 });
+        }
+        instrs.insert(instrs.end(), std::make_move_iterator(groups[id].begin()), std::make_move_iterator(groups[id].end()));
+    }
+}
+
+// --------------------------------------------------------------------
+// Intermediate representation (--emit-ir)
+// --------------------------------------------------------------------
+
+// The parsed program, as it is before any option changes it, so a source assembled with
+// different options is lexed and parsed once. The file is mapped and read in place:
+//
+//   IrHeader
+//   strings   symbol names back to back in id order, then mnemonics, section names and paths
+//   files     IrString, the paths of the source files
+//   sections  IrSection
+//   symbols   IrSymbol
+//   forms     IrForm, a mnemonic with the kinds of its operands
+//   code      one record per instruction, in LEB128 varints:
+//               (form << 1) | new file, [file], line delta (zigzag), operands
+//             an operand is a mask of its nonzero IrFields, those fields, then the nested
+//             operands as kind byte + operand and the expression in prefix order
+//
+// Every table starts 8 byte aligned. Anything but IR_VERSION is rejected, there is no
+// compatibility between versions.
+
+#define IR_VERSION 1
+
+const char IR_MAGIC[8] = { 'I', 'A', 'S', '-', 'I', 'R', '\n', '\0' };
+
+struct IrHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t file_count;
+    uint32_t section_count;
+    uint32_t form_count;
+    uint64_t symbol_count;
+    uint64_t instr_count;
+    uint64_t slot_count; // operands of instructions
+    uint64_t expr_count;
+    uint64_t strings_size;
+    uint64_t code_size;
+};
+
+struct IrString {
+    uint64_t ofs; // into strings
+    uint64_t len;
+};
+
+struct IrSection {
+    IrString name;
+    uint64_t flags;
+};
+
+// the name is the next name_len bytes of strings
+struct IrSymbol {
+    uint32_t name_len;
+    int32_t size;
+    uint8_t type;
+    uint8_t defined;
+    uint8_t global;
+    uint8_t reserved;
+};
+
+struct IrForm {
+    IrString name;
+    uint8_t operand_count;
+    uint8_t kinds[7]; // OperandKind, at most 5 are used
+};
+
+enum IrField {
+    IR_REGI   = 1 << 0,
+    IR_IMM    = 1 << 1,
+    IR_FP_IMM = 1 << 2,
+    IR_VAL    = 1 << 3,
+    IR_AMOUNT = 1 << 4,
+    IR_BASE   = 1 << 5,
+    IR_OFFSET = 1 << 6,
+    IR_EXTEND = 1 << 7,
+    IR_EXPR   = 1 << 8,
+};
+
+bool emit_ir = false;
+
+void ir_put(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out += (char)(v | 0x80);
+        v >>= 7;
+    }
+    out += (char)v;
+}
+
+void ir_put_signed(std::string& out, int64_t v) {
+    ir_put(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+void ir_align(std::string& out) {
+    out.resize((out.size() + 7) / 8 * 8, '\0');
+}
+
+void ir_put_expr(std::string& out, Expr* e, IrHeader& header) {
+    header.expr_count++;
+    out += (char)e->kind;
+    out += e->op;
+    switch (e->kind) {
+        case EXPR_NUM:
+        case EXPR_LABEL:
+            ir_put_signed(out, e->value);
+            break;
+        case EXPR_UNARY:
+            ir_put_expr(out, e->lhs, header);
+            break;
+        case EXPR_BINARY:
+            ir_put_expr(out, e->lhs, header);
+            ir_put_expr(out, e->rhs, header);
+            break;
+    }
+}
+
+void ir_put_operand(std::string& out, Operand* op, IrHeader& header) {
+    uint64_t fields = (op->regi_bits ? IR_REGI : 0) | (op->imm ? IR_IMM : 0) | (op->fp_imm != 0 ? IR_FP_IMM : 0) |
+                      (op->val ? IR_VAL : 0) | (op->amount ? IR_AMOUNT : 0) | (op->base_register ? IR_BASE : 0) |
+                      (op->offset ? IR_OFFSET : 0) | (op->extend_offset ? IR_EXTEND : 0) | (op->expr ? IR_EXPR : 0);
+    ir_put(out, fields);
+    if (fields & IR_REGI) {
+        ir_put_signed(out, op->regi_bits);
+    }
+    if (fields & IR_IMM) {
+        ir_put_signed(out, op->imm);
+    }
+    if (fields & IR_FP_IMM) {
+        out.append(reinterpret_cast<char*>(&op->fp_imm), sizeof(double));
+    }
+    if (fields & IR_VAL) {
+        ir_put_signed(out, op->val);
+    }
+    if (fields & IR_AMOUNT) {
+        ir_put_signed(out, op->amount);
+    }
+    for (Operand* nested : { op->base_register, op->offset, op->extend_offset }) {
+        if (nested) {
+            out += (char)nested->kind;
+            ir_put_operand(out, nested, header);
+        }
+    }
+    if (op->expr) {
+        ir_put_expr(out, op->expr, header);
+    }
+}
+
+// writes the parsed program to stdout in place of the object file
+void write_ir() {
+    IrHeader header = {};
+    memcpy(header.magic, IR_MAGIC, sizeof(IR_MAGIC));
+    header.version = IR_VERSION;
+    header.file_count = source_files.size();
+    header.section_count = sections.size();
+    header.symbol_count = symbols.size();
+    header.instr_count = instrs.size();
+
+    std::string strings(symbol_names.begin(), symbol_names.end());
+    auto add_string = [&](const std::string& str) {
+        IrString ref = { strings.size(), str.size() };
+        strings += str;
+        return ref;
+    };
+
+    std::vector<IrString> files;
+    for (SourceFile& file : source_files) {
+        files.push_back(add_string(file.path));
+    }
+
+    std::vector<IrSection> ir_sections;
+    for (Section& sec : sections) {
+        ir_sections.push_back(IrSection { add_string(sec.name), sec.flags });
+    }
+
+    std::vector<IrSymbol> ir_symbols;
+    ir_symbols.reserve(symbols.size());
+    for (Symbol& sym : symbols) {
+        ir_symbols.push_back(IrSymbol { sym.name_len, sym.size, sym.type, sym.defined, sym.global, 0 });
+    }
+
+    // instructions with the same mnemonic and operand kinds share a form
+    std::vector<IrForm> forms;
+    std::unordered_map<std::string, uint64_t> form_ids;
+    std::string code;
+    int file = 0;
+    int line = 0;
+    for (Instr& in : instrs) {
+        std::string signature = in.name + '\0';
+        for (int i = 0; i < in.operand_length; i++) {
+            signature += (char)in.operands[i]->kind;
+        }
+        auto it = form_ids.find(signature);
+        if (it == form_ids.end()) {
+            IrForm form = { add_string(in.name), (uint8_t)in.operand_length, {} };
+            for (int i = 0; i < in.operand_length; i++) {
+                form.kinds[i] = in.operands[i]->kind;
+            }
+            it = form_ids.emplace(signature, forms.size()).first;
+            forms.push_back(form);
+        }
+
+        ir_put(code, it->second << 1 | (in.file != file));
+        if (in.file != file) {
+            file = in.file;
+            ir_put(code, file);
+        }
+        ir_put_signed(code, in.line - line);
+        line = in.line;
+
+        header.slot_count += in.operand_length;
+        for (int i = 0; i < in.operand_length; i++) {
+            ir_put_operand(code, in.operands[i], header);
+        }
+    }
+    header.form_count = forms.size();
+    header.strings_size = strings.size();
+    header.code_size = code.size();
+
+    std::string out(reinterpret_cast<char*>(&header), sizeof(header));
+    out += strings;
+    ir_align(out);
+    out.append(reinterpret_cast<char*>(files.data()), files.size() * sizeof(IrString));
+    out.append(reinterpret_cast<char*>(ir_sections.data()), ir_sections.size() * sizeof(IrSection));
+    out.append(reinterpret_cast<char*>(ir_symbols.data()), ir_symbols.size() * sizeof(IrSymbol));
+    ir_align(out);
+    out.append(reinterpret_cast<char*>(forms.data()), forms.size() * sizeof(IrForm));
+    out += code;
+
+    write(1, out.data(), out.size());
+}
+
+[[noreturn]] void ir_error(std::string file_path, std::string msg) {
+    std::cerr << "error: " << file_path << ": " << msg << std::endl;
+    exit(1);
+}
+
+#define IR_OPERAND_CHUNK 4096
+#define IR_SHARED_REGI 64
+#define IR_SHARED_IMM 4096
+
+struct IrReader {
+    const char* file_path;
+    const uint8_t* p;
+    const uint8_t* end;
+    Operand* operands; // allocated IR_OPERAND_CHUNK at a time, taken in order
+    Operand* operands_end;
+    Expr* exprs; // preallocated, taken in order
+    Expr* exprs_end;
+    // operands with nothing but a register number, and small immediates, are shared like the
+    // parser's registers; nothing changes an operand once it is parsed
+    Operand* shared_regi[SYSREG + 1][IR_SHARED_REGI];
+    Operand* shared_imm[IR_SHARED_IMM];
+};
+
+uint64_t ir_get(IrReader& r) {
+    uint64_t v = 0;
+    for (int shift = 0; r.p < r.end && shift < 64; shift += 7) {
+        uint8_t b = *r.p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return v;
+        }
+    }
+    ir_error(r.file_path, "truncated or corrupt IR");
+}
+
+int64_t ir_get_signed(IrReader& r) {
+    uint64_t v = ir_get(r);
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+uint8_t ir_get_byte(IrReader& r) {
+    if (r.p == r.end) {
+        ir_error(r.file_path, "truncated or corrupt IR");
+    }
+    return *r.p++;
+}
+
+OperandKind ir_get_kind(IrReader& r) {
+    uint8_t kind = ir_get_byte(r);
+    if (kind > SYSREG) {
+        ir_error(r.file_path, "truncated or corrupt IR");
+    }
+    return (OperandKind)kind;
+}
+
+void ir_numeric_label(IrReader& r, int64_t n) {
+    if (n < 0 || n > NUMERIC_LABEL_MAX) {
+        ir_error(r.file_path, "truncated or corrupt IR");
+    }
+}
+
+Expr* ir_get_expr(IrReader& r) {
+    if (r.exprs == r.exprs_end) {
+        ir_error(r.file_path, "truncated or corrupt IR");
+    }
+    Expr* e = r.exprs++;
+    e->kind = (ExprKind)ir_get_byte(r);
+    e->op = ir_get_byte(r);
+    e->value = 0;
+    e->lhs = e->rhs = nullptr;
+    switch (e->kind) {
+        case EXPR_NUM:
+            e->value = ir_get_signed(r);
+            break;
+        case EXPR_LABEL:
+            e->value = ir_get_signed(r);
+            if (e->value < 0 || e->value >= (int64_t)symbols.size()) {
+                ir_error(r.file_path, "truncated or corrupt IR");
+            }
+            break;
+        case EXPR_UNARY:
+            e->lhs = ir_get_expr(r);
+            break;
+        case EXPR_BINARY:
+            e->lhs = ir_get_expr(r);
+            e->rhs = ir_get_expr(r);
+            break;
+        default:
+            ir_error(r.file_path, "truncated or corrupt IR");
+    }
+    return e;
+}
+
+Operand* ir_get_operand(IrReader& r, OperandKind kind) {
+    uint64_t fields = ir_get(r);
+    if ((fields & ~IR_REGI) == 0) {
+        int64_t regi_bits = fields ? ir_get_signed(r) : 0;
+        if (regi_bits >= 0 && regi_bits < IR_SHARED_REGI) {
+            Operand*& shared = r.shared_regi[kind][regi_bits];
+            if (!shared) {
+                shared = new_regi(kind, regi_bits);
+            }
+            return shared;
+        }
+        return new_regi(kind, regi_bits);
+    }
+    if (fields == IR_IMM && kind == IMM) {
+        int64_t imm = ir_get_signed(r);
+        if (imm >= 0 && imm < IR_SHARED_IMM) {
+            Operand*& shared = r.shared_imm[imm];
+            if (!shared) {
+                shared = new_imm(imm);
+            }
+            return shared;
+        }
+        return new_imm(imm);
+    }
+
+    if (r.operands == r.operands_end) {
+        r.operands = new Operand[IR_OPERAND_CHUNK];
+        r.operands_end = r.operands + IR_OPERAND_CHUNK;
+    }
+    Operand* op = r.operands++;
+    op->kind = kind;
+
+    if (fields & IR_REGI) {
+        op->regi_bits = ir_get_signed(r);
+    }
+    if (fields & IR_IMM) {
+        op->imm = ir_get_signed(r);
+    }
+    if (fields & IR_FP_IMM) {
+        if (r.end - r.p < (ptrdiff_t)sizeof(double)) {
+            ir_error(r.file_path, "truncated or corrupt IR");
+        }
+        memcpy(&op->fp_imm, r.p, sizeof(double));
+        r.p += sizeof(double);
+    }
+    if (fields & IR_VAL) {
+        op->val = ir_get_signed(r);
+    }
+    if (fields & IR_AMOUNT) {
+        op->amount = ir_get_signed(r);
+    }
+    if (fields & IR_BASE) {
+        op->base_register = ir_get_operand(r, ir_get_kind(r));
+    }
+    if (fields & IR_OFFSET) {
+        op->offset = ir_get_operand(r, ir_get_kind(r));
+    }
+    if (fields & IR_EXTEND) {
+        op->extend_offset = ir_get_operand(r, ir_get_kind(r));
+    }
+    if (fields & IR_EXPR) {
+        op->expr = ir_get_expr(r);
+    }
+
+    // branches index symbols directly
+    if (kind == LABEL && op->val == LABEL_SYMBOL && (op->imm < 0 || op->imm >= (int64_t)symbols.size())) {
+        ir_error(r.file_path, "truncated or corrupt IR");
+    }
+    if (kind == LABEL && op->val != LABEL_SYMBOL) {
+        ir_numeric_label(r, op->imm);
+    }
+    return op;
+}
+
+bool is_ir_file(std::string file_path) {
+    char magic[sizeof(IR_MAGIC)] = {};
+    std::ifstream input_file(file_path, std::ios::binary);
+    input_file.read(magic, sizeof(magic));
+    return memcmp(magic, IR_MAGIC, sizeof(IR_MAGIC)) == 0;
+}
+
+// Fills source_files, sections, symbols and instrs as parse_program would. Expressions and
+// operand arrays are allocated once for the whole program, operands in chunks.
+void load_ir(const char* file_path) {
+    int fd = open(file_path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        std::cerr << "error: failed to open file: " << file_path << std::endl;
+        exit(1);
+    }
+    size_t file_size = st.st_size;
+    void* map = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "error: failed to map file: " << file_path << std::endl;
+        exit(1);
+    }
+    const uint8_t* data = (const uint8_t*)map;
+
+    IrHeader header;
+    if (file_size < sizeof(header)) {
+        ir_error(file_path, "truncated or corrupt IR");
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.version != IR_VERSION) {
+        ir_error(file_path, "IR version " + std::to_string(header.version) + " is not supported (expected " + std::to_string(IR_VERSION) + "), emit it again");
+    }
+
+    auto aligned = [](uint64_t n) { return (n + 7) / 8 * 8; };
+    uint64_t strings_ofs = sizeof(header);
+    uint64_t files_ofs = strings_ofs + aligned(header.strings_size);
+    uint64_t sections_ofs = files_ofs + header.file_count * sizeof(IrString);
+    uint64_t symbols_ofs = sections_ofs + header.section_count * sizeof(IrSection);
+    uint64_t forms_ofs = symbols_ofs + aligned(header.symbol_count * sizeof(IrSymbol));
+    uint64_t code_ofs = forms_ofs + header.form_count * sizeof(IrForm);
+    if (header.strings_size > file_size || header.symbol_count > file_size || header.code_size > file_size ||
+        code_ofs + header.code_size != file_size || header.file_count == 0 || header.section_count == 0 ||
+        header.section_count > SECTION_MAX || header.slot_count > file_size || header.expr_count > file_size) {
+        ir_error(file_path, "truncated or corrupt IR");
+    }
+
+    const char* strings = (const char*)data + strings_ofs;
+    auto string_at = [&](const IrString& ref) {
+        if (ref.ofs > header.strings_size || ref.len > header.strings_size - ref.ofs) {
+            ir_error(file_path, "truncated or corrupt IR");
+        }
+        return std::string(strings + ref.ofs, ref.len);
+    };
+
+    const IrString* files = (const IrString*)(data + files_ofs);
+    for (uint32_t i = 0; i < header.file_count; i++) {
+        source_files.push_back(SourceFile { string_at(files[i]), "", false, "" });
+    }
+
+    const IrSection* ir_sections = (const IrSection*)(data + sections_ofs);
+    sections.clear();
+    section_ids.clear();
+    for (uint32_t i = 0; i < header.section_count; i++) {
+        section_id(string_at(ir_sections[i].name), ir_sections[i].flags);
+    }
+
+    // the names come first in strings; the table is rebuilt as label_id would have
+    const IrSymbol* ir_symbols = (const IrSymbol*)(data + symbols_ofs);
+    symbols.reserve(header.symbol_count);
+    uint64_t name_ofs = 0;
+    for (uint64_t i = 0; i < header.symbol_count; i++) {
+        const IrSymbol& sym = ir_symbols[i];
+        symbols.push_back(Symbol { name_ofs, -1, sym.size, sym.name_len, sym.type, sym.defined != 0, sym.global != 0, 0 });
+        name_ofs += sym.name_len;
+    }
+    if (name_ofs > header.strings_size) {
+        ir_error(file_path, "truncated or corrupt IR");
+    }
+    symbol_names.assign(strings, strings + name_ofs);
+
+    size_t slots = 512;
+    while ((symbols.size() + 1) * 2 > slots) {
+        slots *= 2;
+    }
+    symbol_slots.assign(slots, SymbolSlot { 0, -1 });
+    for (size_t id = 0; id < symbols.size(); id++) {
+        const char* name = symbol_name(symbols[id]);
+        uint32_t hash = hash_name(name, symbols[id].name_len);
+        symbol_slots[find_symbol_slot(name, symbols[id].name_len, hash)] = SymbolSlot { hash, (int32_t)id };
+    }
+
+    const IrForm* forms = (const IrForm*)(data + forms_ofs);
+    std::vector<std::string> form_names;
+    std::vector<bool> numeric_label_forms;
+    for (uint32_t i = 0; i < header.form_count; i++) {
+        if (forms[i].operand_count > 5) {
+            ir_error(file_path, "truncated or corrupt IR");
+        }
+        for (int k = 0; k < forms[i].operand_count; k++) {
+            if (forms[i].kinds[k] > SYSREG) {
+                ir_error(file_path, "truncated or corrupt IR");
+            }
+        }
+        form_names.push_back(string_at(forms[i].name));
+        numeric_label_forms.push_back(form_names.back() == ".nlabel" && forms[i].operand_count == 1);
+    }
+
+    IrReader* reader = new IrReader {};
+    IrReader& r = *reader;
+    r.file_path = file_path;
+    r.p = data + code_ofs;
+    r.end = data + file_size;
+    r.exprs = new Expr[header.expr_count];
+    r.exprs_end = r.exprs + header.expr_count;
+    Operand** slot = new Operand*[header.slot_count];
+    Operand** slots_end = slot + header.slot_count;
+
+    instrs.reserve(header.instr_count);
+    int file = 0;
+    int line = 0;
+    for (uint64_t i = 0; i < header.instr_count; i++) {
+        uint64_t v = ir_get(r);
+        uint64_t form_id = v >> 1;
+        if (form_id >= header.form_count) {
+            ir_error(file_path, "truncated or corrupt IR");
+        }
+        if (v & 1) {
+            uint64_t file_id = ir_get(r);
+            if (file_id >= header.file_count) {
+                ir_error(file_path, "truncated or corrupt IR");
+            }
+            file = file_id;
+        }
+        line += ir_get_signed(r);
+
+        const IrForm& form = forms[form_id];
+        if (slots_end - slot < form.operand_count) {
+            ir_error(file_path, "truncated or corrupt IR");
+        }
+        Operand** operands = slot;
+        for (int k = 0; k < form.operand_count; k++) {
+            *slot++ = ir_get_operand(r, (OperandKind)form.kinds[k]);
+        }
+        if (numeric_label_forms[form_id]) {
+            ir_numeric_label(r, operands[0]->imm);
+        }
+        instrs.push_back(Instr { form_names[form_id], operands, form.operand_count, line, file });
+    }
+    if (r.p != r.end) {
+        ir_error(file_path, "truncated or corrupt IR");
+    }
+
+    delete reader;
+    munmap(map, file_size);
+}
+
+// --------------------------------------------------------------------
+// Literal pools
+// --------------------------------------------------------------------
+
+// `ldr xN, =imm` loads imm from a pool placed at the next .ltorg or at the end of .text.
+
+struct LiteralRef {
+    size_t code_idx;
+    int line;
+    int file;
+    int size;
+    uint64_t value;
+};
+
+std::vector<LiteralRef> pending_literals;
+
+void emit_literal_pool() {
+    if (pending_literals.empty()) {
+        return;
+    }
+
+    // equal constants share one slot, 8 byte constants come first and are 8 byte aligned
+    std::unordered_map<uint64_t, size_t> slots8;
+    std::unordered_map<uint32_t, size_t> slots4;
+
+    for (LiteralRef& ref : pending_literals) {
+        if (ref.size != 8 || slots8.find(ref.value) != slots8.end()) {
+            continue;
+        }
+        if (slots8.empty() && code.size() % 2 != 0) {
+            code.push_back(0);
+        }
+        slots8[ref.value] = code.size();
+        code.push_back((uint32_t)ref.value);
+        code.push_back((uint32_t)(ref.value >> 32));
+    }
+
+    for (LiteralRef& ref : pending_literals) {
+        if (ref.size != 4 || slots4.find((uint32_t)ref.value) != slots4.end()) {
+            continue;
+        }
+        slots4[(uint32_t)ref.value] = code.size();
+        code.push_back((uint32_t)ref.value);
+    }
+
+    for (LiteralRef& ref : pending_literals) {
+        size_t slot = ref.size == 8 ? slots8[ref.value] : slots4[(uint32_t)ref.value];
+        // imm19 word offset, +-1MB
+        size_t delta = slot - ref.code_idx;
+        if (delta >= (1 << 18)) {
+            encode_error(source_path(ref.file), ref.line, "literal pool out of range, place a .ltorg closer to the load");
+        }
+        code[ref.code_idx] |= (uint32_t)delta << 5;
+    }
+
+    pending_literals.clear();
+}
+
+// --------------------------------------------------------------------
+// Alignment
+// --------------------------------------------------------------------
+
+#define NOP_INSTR 0b11010101000000110010000000011111
+
+// padding of at least this many words is jumped over with a `b` instead of executing the nops
+#define ALIGN_BRANCH_OVER 4
+
+// data sections are padded with zeros
+void emit_align_padding(int64_t align, int64_t max_skip) {
+    int64_t pad = (align - (code.size() * 4) % align) % align;
+    if (pad == 0 || pad > max_skip) {
+        return;
+    }
+
+    int64_t words = pad / 4;
+    if (!(sections[current_section].flags & SHF_EXECINSTR)) {
+        code.resize(code.size() + words, 0);
+        return;
+    }
+    if (words >= ALIGN_BRANCH_OVER) {
+        code.push_back(0b00010100000000000000000000000000 | words);
+        words--;
+    }
+    while (words-- > 0) {
+        code.push_back(NOP_INSTR);
+    }
+}
+
+// --------------------------------------------------------------------
+// Line map
+// --------------------------------------------------------------------
+
+// code index -> source line, recorded while encoding. Only changes are stored, as
+// (word delta, line delta) pairs in LEB128, so the words of one source line cost
+// nothing and a new line usually costs 2 bytes. Line 0 marks words without a source line.
+// An entry is held back until code grows past it, so lines that emit nothing (labels,
+// directives) leave no trace.
+
+bool track_lines = false;
+
+struct LineMap {
+    std::vector<uint8_t> bytes;
+    size_t last_idx = 0;
+    int last_line = 0;
+    size_t pending_idx = 0;
+    int pending_line = 0;
+};
+
+LineMap line_map;
+
+void push_uleb(std::vector<uint8_t>& out, uint64_t value) {
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        out.push_back(value ? byte | 0x80 : byte);
+    } while (value);
+}
+
+void push_sleb(std::vector<uint8_t>& out, int64_t value) {
+    while (true) {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        if ((value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40))) {
+            out.push_back(byte);
+            return;
+        }
+        out.push_back(byte | 0x80);
+    }
+}
+
+uint64_t read_uleb(const uint8_t*& p) {
+    uint64_t value = 0;
+    for (int shift = 0; ; shift += 7) {
+        value |= (uint64_t)(*p & 0x7f) << shift;
+        if (!(*p++ & 0x80)) {
+            return value;
+        }
+    }
+}
+
+int64_t read_sleb(const uint8_t*& p) {
+    int64_t value = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = *p++;
+        value |= (int64_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    if (shift < 64 && (byte & 0x40)) {
+        value |= -(1ll << shift);
+    }
+    return value;
+}
+
+void line_map_flush() {
+    if (line_map.pending_line == line_map.last_line) {
+        return;
+    }
+    push_uleb(line_map.bytes, line_map.pending_idx - line_map.last_idx);
+    push_sleb(line_map.bytes, line_map.pending_line - line_map.last_line);
+    line_map.last_idx = line_map.pending_idx;
+    line_map.last_line = line_map.pending_line;
+}
+
+inline void line_map_add(size_t code_idx, int line) {
+    if (code_idx != line_map.pending_idx) {
+        line_map_flush();
+    }
+    line_map.pending_idx = code_idx;
+    line_map.pending_line = line;
+}
+
+// walks the line map in code order
+struct LineMapCursor {
+    const uint8_t* p;
+    const uint8_t* end;
+    size_t next_idx;
+    int next_line;
+    int line;
+};
+
+LineMapCursor line_map_cursor() {
+    LineMapCursor c { line_map.bytes.data(), line_map.bytes.data() + line_map.bytes.size(), SIZE_MAX, 0, 0 };
+    if (c.p < c.end) {
+        c.next_idx = read_uleb(c.p);
+        c.next_line = read_sleb(c.p);
+    }
+    return c;
+}
+
+// Returns true when code_idx starts a new line entry. Must be called with increasing code_idx.
+inline bool line_map_seek(LineMapCursor& c, size_t code_idx) {
+    bool changed = false;
+    while (c.next_idx <= code_idx) {
+        c.line = c.next_line;
+        changed = true;
+        if (c.p < c.end) {
+            c.next_idx += read_uleb(c.p);
+            c.next_line += read_sleb(c.p);
+        } else {
+            c.next_idx = SIZE_MAX;
+        }
+    }
+    return changed;
+}
+
+// --------------------------------------------------------------------
+// DWARF (-g)
+// --------------------------------------------------------------------
+
+// DWARF v5: one compile unit whose line program is translated from the line map, with one
+// sequence per executable section. Several executable sections make the unit's address range
+// a .debug_rnglists list.
+// https://dwarfstd.org/doc/DWARF5.pdf
+
+#define DW_TAG_compile_unit 0x11
+#define DW_CHILDREN_no 0
+#define DW_AT_name 0x03
+#define DW_AT_stmt_list 0x10
+#define DW_AT_low_pc 0x11
+#define DW_AT_high_pc 0x12
+#define DW_AT_language 0x13
+#define DW_AT_comp_dir 0x1b
+#define DW_AT_producer 0x25
+#define DW_AT_ranges 0x55
+#define DW_FORM_addr 0x01
+#define DW_FORM_data2 0x05
+#define DW_FORM_data8 0x07
+#define DW_FORM_string 0x08
+#define DW_FORM_udata 0x0f
+#define DW_FORM_sec_offset 0x17
+#define DW_LANG_Mips_Assembler 0x8001
+#define DW_UT_compile 0x01
+#define DW_LNCT_path 0x1
+#define DW_LNCT_directory_index 0x2
+#define DW_LNS_copy 0x01
+#define DW_LNS_advance_pc 0x02
+#define DW_LNS_advance_line 0x03
+#define DW_LNE_end_sequence 0x01
+#define DW_LNE_set_address 0x02
+#define DW_RLE_end_of_list 0x00
+#define DW_RLE_start_length 0x07
+
+// line program parameters: addresses advance in whole instructions
+#define LINE_BASE -5
+#define LINE_RANGE 14
+#define OPCODE_BASE 13
+
+void push_bytes(std::vector<uint8_t>& out, uint64_t value, int size) {
+    for (int i = 0; i < size; i++) {
+        out.push_back(value >> (i * 8));
+    }
+}
+
+void push_string(std::vector<uint8_t>& out, std::string str) {
+    out.insert(out.end(), str.begin(), str.end());
+    out.push_back(0);
+}
+
+void patch_bytes(std::vector<uint8_t>& out, size_t ofs, uint64_t value, int size) {
+    for (int i = 0; i < size; i++) {
+        out[ofs + i] = value >> (i * 8);
+    }
+}
+
+// Relocatable objects get a relocation against the section symbol. Executables are
+// final, so the address is written directly: the section's, or 0 for the debug sections.
+void push_debug_address(std::vector<uint8_t>& out, std::vector<DebugReloc>& relocs, uint32_t type, int section, int64_t addend = 0) {
+    int size = type == R_AARCH64_ABS64 ? 8 : 4;
+    if (emit_exec) {
+        push_bytes(out, (section >= 0 ? sections[section].addr : 0) + addend, size);
+        return;
+    }
+    relocs.push_back(DebugReloc { out.size(), type, section, addend });
+    push_bytes(out, 0, size);
+}
+
+// executable sections with code, in code order
+std::vector<int> debug_code_sections() {
+    std::vector<int> ids;
+    for (int id : section_order()) {
+        if ((sections[id].flags & SHF_EXECINSTR) && sections[id].size > 0) {
+            ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
+void generate_debug_line(std::string file_path, std::string comp_dir) {
+    std::vector<uint8_t>& out = debug_line;
+
+    push_bytes(out, 0, 4); // unit_length
+    push_bytes(out, 5, 2); // version
+    out.push_back(8); // address_size
+    out.push_back(0); // segment_selector_size
+    size_t header_length_ofs = out.size();
+    push_bytes(out, 0, 4); // header_length
+    out.push_back(4); // minimum_instruction_length
+    out.push_back(1); // maximum_operations_per_instruction
+    out.push_back(1); // default_is_stmt
+    out.push_back((uint8_t)LINE_BASE);
+    out.push_back(LINE_RANGE);
+    out.push_back(OPCODE_BASE);
+    for (uint8_t len : { 0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1 }) { // standard_opcode_lengths
+        out.push_back(len);
+    }
+
+    // directories: the compilation directory only
+    out.push_back(1);
+    out.push_back(DW_LNCT_path);
+    out.push_back(DW_FORM_string);
+    push_uleb(out, 1);
+    push_string(out, comp_dir);
+
+    // files: entry 0 is the primary source file, entry 1 repeats it for the default file register
+    out.push_back(2);
+    out.push_back(DW_LNCT_path);
+    out.push_back(DW_FORM_string);
+    out.push_back(DW_LNCT_directory_index);
+    out.push_back(DW_FORM_udata);
+    push_uleb(out, 2);
+    for (int i = 0; i < 2; i++) {
+        push_string(out, file_path);
+        push_uleb(out, 0);
+    }
+    patch_bytes(out, header_length_ofs, out.size() - header_length_ofs - 4, 4);
+
+    // every line map entry becomes one row, preferably as a single special opcode
+    size_t addr;
+    int64_t line;
+    auto add_row = [&](size_t row_addr, int64_t row_line) {
+        uint64_t addr_advance = row_addr - addr;
+        int64_t line_advance = row_line - line;
+        if (line_advance < LINE_BASE || line_advance >= LINE_BASE + LINE_RANGE) {
+            out.push_back(DW_LNS_advance_line);
+            push_sleb(out, line_advance);
+            line_advance = 0;
+        }
+        uint64_t opcode = (line_advance - LINE_BASE) + LINE_RANGE * addr_advance + OPCODE_BASE;
+        if (opcode > 255) {
+            out.push_back(DW_LNS_advance_pc);
+            push_uleb(out, addr_advance);
+            addr_advance = 0;
+            opcode = (line_advance - LINE_BASE) + OPCODE_BASE;
+        }
+        out.push_back(opcode);
+        addr = row_addr;
+        line = row_line;
+    };
+
+    const uint8_t* p = line_map.bytes.data();
+    const uint8_t* end = p + line_map.bytes.size();
+    size_t next_idx = 0;
+    int64_t next_line = 0;
+    bool has_next = false;
+    auto next_entry = [&]() {
+        has_next = p < end;
+        if (has_next) {
+            next_idx += read_uleb(p);
+            next_line += read_sleb(p);
+        }
+    };
+    next_entry();
+
+    int64_t map_line = 0;
+    for (int id : debug_code_sections()) {
+        Section& sec = sections[id];
+        // entries before the section only give the line it starts with
+        while (has_next && next_idx <= sec.code_idx) {
+            map_line = next_line;
+            next_entry();
+        }
+
+        out.push_back(0);
+        push_uleb(out, 9);
+        out.push_back(DW_LNE_set_address);
+        push_debug_address(out, debug_line_relocs, R_AARCH64_ABS64, id);
+
+        addr = 0;
+        line = 1;
+        add_row(0, map_line);
+        while (has_next && next_idx < sec.code_idx + sec.size) {
+            map_line = next_line;
+            add_row(next_idx - sec.code_idx, map_line);
+            next_entry();
+        }
+
+        out.push_back(DW_LNS_advance_pc);
+        push_uleb(out, sec.size - addr);
+        out.push_back(0);
+        push_uleb(out, 1);
+        out.push_back(DW_LNE_end_sequence);
+    }
+
+    patch_bytes(out, 0, out.size() - 4, 4);
+}
+
+// one DW_RLE_start_length entry per executable section
+void generate_debug_rnglists(std::vector<int>& ids) {
+    std::vector<uint8_t>& out = debug_rnglists;
+    push_bytes(out, 0, 4); // unit_length
+    push_bytes(out, 5, 2); // version
+    out.push_back(8); // address_size
+    out.push_back(0); // segment_selector_size
+    push_bytes(out, 0, 4); // offset_entry_count
+
+    for (int id : ids) {
+        out.push_back(DW_RLE_start_length);
+        push_debug_address(out, debug_rnglists_relocs, R_AARCH64_ABS64, id);
+        push_uleb(out, sections[id].size * 4);
+    }
+    out.push_back(DW_RLE_end_of_list);
+
+    patch_bytes(out, 0, out.size() - 4, 4);
+}
+
+void generate_debug_info(std::string file_path) {
+    char cwd[4096];
+    std::string comp_dir = getcwd(cwd, sizeof(cwd)) ? cwd : ".";
+
+    std::vector<int> ids = debug_code_sections();
+    debug_ranges = ids.size() > 1;
+    int low_pc_section = ids.empty() ? 0 : ids[0];
+
+    uint8_t abbrev[] = {
+        1, DW_TAG_compile_unit, DW_CHILDREN_no,
+        DW_AT_stmt_list, DW_FORM_sec_offset,
+        DW_AT_low_pc, DW_FORM_addr,
+        (uint8_t)(debug_ranges ? DW_AT_ranges : DW_AT_high_pc), (uint8_t)(debug_ranges ? DW_FORM_sec_offset : DW_FORM_data8),
+        DW_AT_name, DW_FORM_string,
+        DW_AT_comp_dir, DW_FORM_string,
+        DW_AT_producer, DW_FORM_string,
+        DW_AT_language, DW_FORM_data2,
+        0, 0,
+        0,
+    };
+    debug_abbrev.assign(abbrev, abbrev + sizeof(abbrev));
+
+    std::vector<uint8_t>& out = debug_info;
+    push_bytes(out, 0, 4); // unit_length
+    push_bytes(out, 5, 2); // version
+    out.push_back(DW_UT_compile);
+    out.push_back(8); // address_size
+    push_debug_address(out, debug_info_relocs, R_AARCH64_ABS32, DEBUG_ABBREV); // debug_abbrev_offset
+
+    push_uleb(out, 1);
+    push_debug_address(out, debug_info_relocs, R_AARCH64_ABS32, DEBUG_LINE);
+    if (debug_ranges) {
+        // the range list follows the 12 byte .debug_rnglists header
+        push_bytes(out, 0, 8);
+        push_debug_address(out, debug_info_relocs, R_AARCH64_ABS32, DEBUG_RNGLISTS, 12);
+        generate_debug_rnglists(ids);
+    } else {
+        push_debug_address(out, debug_info_relocs, R_AARCH64_ABS64, low_pc_section);
+        push_bytes(out, sections[low_pc_section].size * 4, 8);
+    }
+    push_string(out, file_path);
+    push_string(out, comp_dir);
+    push_string(out, "ias");
+    push_bytes(out, DW_LANG_Mips_Assembler, 2);
+
+    patch_bytes(out, 0, out.size() - 4, 4);
+
+    generate_debug_line(file_path, comp_dir);
+}
+
+// --------------------------------------------------------------------
+// Branches
+// --------------------------------------------------------------------
+
+std::vector<BranchFixup> branch_fixups;
+
+// b/bl take imm26, tbz/tbnz imm14 and b.cond/cbz/cbnz imm19, all in words
+void patch_branch(int file, size_t code_idx, int64_t target, int line, std::string name) {
+    uint32_t& instr = code[code_idx];
+    int bits = 19, b = 5;
+    if ((instr & 0b01111100000000000000000000000000) == 0b00010100000000000000000000000000) {
+        bits = 26; b = 0;
+    } else if ((instr & 0b01111110000000000000000000000000) == 0b00110110000000000000000000000000) {
+        bits = 14;
+    }
+
+    int64_t delta = target - (int64_t)code_idx;
+    if (delta < -(1ll << (bits - 1)) || delta >= (1ll << (bits - 1))) {
+        encode_error(source_path(file), line, "branch target `" + name + "` out of range");
+    }
+    instr |= (uint32_t)(delta & ((1ll << bits) - 1)) << b;
+}
+
+// relocation for the branch encoded in instr
+uint32_t branch_reloc_type(uint32_t instr) {
+    if ((instr & 0b01111100000000000000000000000000) == 0b00010100000000000000000000000000) {
+        return instr >> 31 ? R_AARCH64_CALL26 : R_AARCH64_JUMP26;
+    }
+    if ((instr & 0b01111110000000000000000000000000) == 0b00110110000000000000000000000000) {
+        return R_AARCH64_TSTBR14;
+    }
+    return R_AARCH64_CONDBR19;
+}
+
+// A branch into another section is left to the linker, which may move or drop sections.
+// Executables are final and their executable sections contiguous, so it is patched directly.
+// A branch to an undefined .globl symbol, a function of another object, is left to the linker.
+void resolve_branches() {
+    for (BranchFixup& fixup : branch_fixups) {
+        Symbol& target = symbols[fixup.label];
+        if (!target.defined && target.global && !emit_exec) {
+            code_relocs.push_back(CodeReloc { fixup.code_idx, fixup.section, branch_reloc_type(code[fixup.code_idx]), -1 - fixup.label, 0 });
+            continue;
+        }
+        if (!target.defined) {
+            encode_error(source_files[fixup.file].path, fixup.line, "undefined label `" + label_name(fixup.label) + "`");
+        }
+        if (target.section != fixup.section) {
+            if (!emit_exec) {
+                code_relocs.push_back(CodeReloc { fixup.code_idx, fixup.section, branch_reloc_type(code[fixup.code_idx]), target.section,
+                                                  (target.offset - (int64_t)sections[target.section].code_idx) * 4 });
+                continue;
+            }
+            if (!(sections[target.section].flags & SHF_EXECINSTR)) {
+                encode_error(source_files[fixup.file].path, fixup.line, "branch into the non-executable section `" + sections[target.section].name + "`");
+            }
+        }
+        patch_branch(fixup.file, fixup.code_idx, symbols[fixup.label].offset, fixup.line, label_name(fixup.label));
+    }
+
+    for (size_t n = 0; n < numeric_labels.size(); n++) {
+        if (!numeric_labels[n].pending.empty()) {
+            BranchFixup& fixup = numeric_labels[n].pending[0];
+            encode_error(source_files[fixup.file].path, fixup.line, "undefined local label `" + std::to_string(n) + "f`");
+        }
+    }
+}
+
+// `1b` is patched right away, `1f` waits for the next `1:`
+void numeric_label_ref(Operand* label, size_t code_idx, int line, int file) {
+    NumericLabel& nl = numeric_label_slot(label->imm);
+    if (label->val == LABEL_FORWARD) {
+        nl.pending.push_back(BranchFixup { code_idx, current_section, (int)label->imm, line, file });
+        return;
+    }
+    if (nl.offset < 0) {
+        encode_error(source_path(file), line, "undefined local label `" + std::to_string(label->imm) + "b`");
+    }
+    if (nl.offset < (int64_t)sections[current_section].code_idx) {
+        encode_error(source_path(file), line, "local label `" + std::to_string(label->imm) + "b` is in another section");
+    }
+    patch_branch(file, code_idx, nl.offset, line, std::to_string(label->imm) + "b");
+}
+
+void define_numeric_label(int n) {
+    NumericLabel& nl = numeric_label_slot(n);
+    nl.offset = code.size();
+    for (BranchFixup& fixup : nl.pending) {
+        if (fixup.section != current_section) {
+            encode_error(source_path(fixup.file), fixup.line, "local label `" + std::to_string(n) + "f` is in another section");
+        }
+        patch_branch(fixup.file, fixup.code_idx, nl.offset, fixup.line, std::to_string(n) + "f");
+    }
+    nl.pending.clear();
+}
+
+// instrs[instr_idx] was encoded to code[code_idx] with 0 for its unresolved expressions
+struct ExprFixup {
+    size_t code_idx;
+    size_t instr_idx;
+    uint32_t placeholder;
+};
+
+std::vector<ExprFixup> expr_fixups;
+
+// #imm and [base, #imm] may carry an expression
+Operand* expr_operand(Operand* op) {
+    if (op->kind == IMM) {
+        return op;
+    }
+    if (op->kind == MEM_OP_IMM_OFFSET || op->kind == MEM_OP_IMM_OFFSET_PRE || op->kind == MEM_OP_VL_OFFSET) {
+        return op->offset;
+    }
+    return nullptr;
+}
+
+bool has_unresolved_expr(Instr& in) {
+    for (int i = 0; i < in.operand_length; i++) {
+        Operand* imm = expr_operand(in.operands[i]);
+        if (imm && imm->expr) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Labels evaluate to their code offset in bytes. `labels` counts the labels added minus the
+// ones subtracted; only 0, a label difference within one section, does not depend on where
+// the sections are loaded.
+struct ExprValue {
+    int64_t value;
+    int labels;
+    int section; // of the labels, -1 without any
+};
+
+ExprValue eval_expr(std::string file_path, int line, Expr* e) {
+    switch (e->kind) {
+        case EXPR_NUM:
+            return { e->value, 0, -1 };
+        case EXPR_LABEL:
+            if (symbols[e->value].offset < 0) {
+                encode_error(file_path, line, "undefined symbol `" + label_name(e->value) + "`");
+            }
+            return { symbols[e->value].offset * 4, 1, symbols[e->value].section };
+        case EXPR_UNARY: {
+            ExprValue operand = eval_expr(file_path, line, e->lhs);
+            if (operand.labels != 0 && e->op != '+') {
+                encode_error(file_path, line, "expression is not constant, only label differences are");
+            }
+            return { apply_unary(e->op, operand.value), operand.labels, operand.section };
+        }
+        case EXPR_BINARY: {
+            ExprValue lhs = eval_expr(file_path, line, e->lhs);
+            ExprValue rhs = eval_expr(file_path, line, e->rhs);
+            int labels = 0;
+            if (e->op == '+') {
+                labels = lhs.labels + rhs.labels;
+            } else if (e->op == '-') {
+                labels = lhs.labels - rhs.labels;
+            } else if (lhs.labels != 0 || rhs.labels != 0) {
+                encode_error(file_path, line, "expression is not constant, only label differences are");
+            }
+            if (lhs.section >= 0 && rhs.section >= 0 && lhs.section != rhs.section) {
+                encode_error(file_path, line, "labels of different sections in an expression");
+            }
+            int64_t value;
+            if (!apply_binary(e->op, lhs.value, rhs.value, &value)) {
+                encode_error(file_path, line, "division by zero");
+            }
+            return { value, labels, lhs.section >= 0 ? lhs.section : rhs.section };
+        }
+    }
+    unreachable();
+}
+
+// the instr_table entry of the instruction, operand_error reports at its file:line
+uint32_t encode_instr(Instr& in) {
+    auto it = instr_table.find(in.name);
+    if (it == instr_table.end()) {
+        encode_error(source_path(in.file), in.line, "unknown instruction `" + in.name + "`");
+    }
+    encoding_instr = &in;
+    uint32_t word = it->second(in.operands, in.operand_length);
+    encoding_instr = nullptr;
+    return word;
+}
+
+// Re-encodes every instruction with an expression now that all labels are placed.
+// Branch offsets already patched into the word are kept.
+void resolve_exprs() {
+    for (ExprFixup& fixup : expr_fixups) {
+        Instr& in = instrs[fixup.instr_idx];
+        std::string& file_path = source_files[in.file].path;
+        for (int i = 0; i < in.operand_length; i++) {
+            Operand* imm = expr_operand(in.operands[i]);
+            if (imm && imm->expr) {
+                ExprValue v = eval_expr(file_path, in.line, imm->expr);
+                if (v.labels != 0) {
+                    encode_error(file_path, in.line, "expression is not constant, only label differences are");
+                }
+                imm->imm = v.value;
+            }
+        }
+        code[fixup.code_idx] = encode_instr(in) | (code[fixup.code_idx] ^ fixup.placeholder);
     }
+}
 
-    // .shstrtab
-    write(1, reinterpret_cast<char*>(&shstrtab), sizeof(shstrtab));
+// ends the current section with its literal pool and starts the next one at its alignment
+void begin_section(int id) {
+    emit_literal_pool();
+    sections[current_section].size = code.size() - sections[current_section].code_idx;
 
-    // section headers
-    for (int i = 0; i < sizeof(section_headers)/sizeof(Elf64_Shdr); i++) {
-        write(1, reinterpret_cast<char*>(&(section_headers[i])), sizeof(Elf64_Shdr));
-    }
+    size_t align = sections[id].align / 4;
+    code.resize((code.size() + align - 1) / align * align, 0);
+    sections[id].code_idx = code.size();
+    sections[id].code_end = code.size();
+    current_section = id;
 }
 
-struct Parser {
-    int idx;
-    int line;
-    std::string file_path;
-    std::string program;
+// --pipeline places instructions while the parser may still add symbols, so .label and
+// .size are recorded and applied after parsing
+bool defer_symbols = false;
+
+struct SymbolEvent {
+    size_t instr_idx;
+    size_t code_idx;
 };
 
-Parser* new_parser(std::string file_path, std::string program) {
-    Parser *p = new Parser;
-    p->program = program;
-    p->file_path = file_path;
-    p->idx = 0;
-    p->line = 1;
-    return p;
-}
+std::vector<SymbolEvent> symbol_events;
 
-[[noreturn]] void syntax_error(Parser* p, std::string msg) {
-    std::cerr << "\u001b[1m" << p->file_path << ":" << p->line << ": \x1b[91merror:\x1b[0m\u001b[1m " << msg << "\033[0m" << std::endl;
-    exit(1);
+void place_symbol(Instr& in, size_t code_idx) {
+    int id = in.operands[0]->imm;
+    if (in.name == ".label") {
+        symbols[id].offset = code_idx;
+        symbols[id].section = current_section;
+        return;
+    }
+    if (symbols[id].offset < 0) {
+        encode_error(source_files[in.file].path, in.line, "`" + label_name(id) + "` must be defined before its .size");
+    }
+    symbols[id].size = (code_idx - symbols[id].offset) * 4;
 }
 
-inline bool at_eof(Parser *p) {
-    return p->idx >= p->program.size();
+// the instruction word before labels and expressions are resolved, 0 for directives
+uint32_t encode_word(Instr& in) {
+    if (in.name[0] == '.') {
+        return 0;
+    }
+    operand_checks = !has_unresolved_expr(in);
+    uint32_t word = encode_instr(in);
+    operand_checks = true;
+    return word;
 }
 
-inline void parser_advance(Parser *p, int n) {
-    p->idx += n;
+void begin_encoding() {
+    current_section = 0;
+    sections[0].code_idx = code.size();
+    sections[0].code_end = code.size();
 }
 
-void skip_white_space(Parser *p) {
-    while (!at_eof(p)) {
-        char c = p->program[p->idx];
-        if (c == ' ' || c == '\t') {
-            parser_advance(p, 1);
+// in is instrs[instr_idx] and word its encode_word
+void place_instr(Instr& in, size_t instr_idx, uint32_t word) {
+    // the line map only covers the input file
+    if (track_lines) {
+        line_map_add(code.size(), in.file == 0 ? in.line : 0);
+    }
+
+    if (in.name == ".label" || in.name == ".size") {
+        if (defer_symbols) {
+            symbol_events.push_back(SymbolEvent { instr_idx, code.size() });
         } else {
-            break;
+            place_symbol(in, code.size());
         }
+        return;
     }
-}
 
-std::string read_ident(Parser* p) {
-    skip_white_space(p);
-
-    int start = p->idx;
-    while (std::isalpha(p->program[p->idx]) || std::isdigit(p->program[p->idx])) {
-        parser_advance(p, 1);
+    if (in.name == ".nlabel") {
+        define_numeric_label(in.operands[0]->imm);
+        return;
     }
 
-    std::string str = p->program.substr(start, p->idx-start);
+    if (in.name == ".section") {
+        begin_section(in.operands[0]->imm);
+        return;
+    }
 
-    skip_white_space(p);
+    if (in.name == ".ltorg") {
+        emit_literal_pool();
+        return;
+    }
 
-    return str;
-}
+    if (in.name == ".align") {
+        emit_align_padding(in.operands[0]->imm, in.operands[1]->imm);
+        return;
+    }
 
-int read_number(Parser* p) {
-    skip_white_space(p);
+    if (in.operand_length == 2 && in.operands[1]->kind == LITERAL) {
+        int size = in.operands[0]->kind == XR || in.operands[0]->kind == DR ? 8 : 4;
+        int64_t imm = in.operands[1]->imm;
+        if (size == 4 && (imm < INT32_MIN || imm > UINT32_MAX)) {
+            encode_error(source_path(in.file), in.line, "immediate out of range for a 32bit register");
+        }
+        pending_literals.push_back(LiteralRef { code.size(), in.line, in.file, size, (uint64_t)imm });
+    }
 
-    int imm_val = 0;
-    while (std::isdigit(p->program[p->idx])) {
-        imm_val = imm_val * 10 + p->program[p->idx] - '0';
-        parser_advance(p, 1);
+    Operand* label = in.operand_length > 0 && in.operands[in.operand_length - 1]->kind == LABEL ? in.operands[in.operand_length - 1] : nullptr;
+    if (label && label->val == LABEL_SYMBOL) {
+        branch_fixups.push_back(BranchFixup { code.size(), current_section, (int)label->imm, in.line, in.file });
     }
 
-    skip_white_space(p);
+    code.push_back(word);
+    sections[current_section].code_end = code.size();
 
-    return imm_val;
-}
+    if (has_unresolved_expr(in)) {
+        expr_fixups.push_back(ExprFixup { code.size() - 1, instr_idx, word });
+    }
 
-inline Operand* parse_register(Parser* p) {
+    if (label && label->val != LABEL_SYMBOL) {
+        numeric_label_ref(label, code.size() - 1, in.line, in.file);
+    }
+}
 
-    std::string ident = read_ident(p);
-    if (registers.find(ident) != registers.end()) {
-        skip_white_space(p);
-        return registers[ident];
+void finish_encoding() {
+    if (track_lines) {
+        line_map_add(code.size(), 0);
     }
+    emit_literal_pool();
+    sections[current_section].size = code.size() - sections[current_section].code_idx;
+    if (track_lines && line_map.pending_idx < code.size()) {
+        line_map_flush();
+    }
+    resolve_branches();
+    resolve_exprs();
+    layout_sections();
+}
 
-    syntax_error(p, "expected register operand");
+void encode_program() {
+    begin_encoding();
+    for (size_t i = 0; i < instrs.size(); i++) {
+        place_instr(instrs[i], i, encode_word(instrs[i]));
+    }
+    finish_encoding();
 }
 
-inline Operand* parse_extend(Parser* p) {
-    std::string ident = read_ident(p);
+// --------------------------------------------------------------------
+// Listing (--listing file)
+// --------------------------------------------------------------------
 
-    if (extend_types.find(ident) != extend_types.end()) {
-        int extend_amout = 0;
-        if (p->program[p->idx] == '#') {
-            parser_advance(p, 1);
-            extend_amout = read_number(p);
-        }
-        return new_extend(extend_types[ident], extend_amout);
+// line number, .text offset, encoding and source text of every emitted word
+void write_listing(std::string listing_path, std::string& source) {
+    std::ofstream out(listing_path);
+    if (!out.is_open()) {
+        std::cerr << "error: failed to open file: " << listing_path << std::endl;
+        exit(1);
     }
 
-    syntax_error(p, "expected extend operand");
-}
+    std::vector<size_t> line_starts = { 0 };
+    for (const char* c = source.data(); (c = (const char*)memchr(c, '\n', source.data() + source.size() - c)) != nullptr; c++) {
+        line_starts.push_back(c - source.data() + 1);
+    }
 
-inline Operand* parse_shift(Parser* p) {
-    std::string ident = read_ident(p);
+    std::string buf;
+    char head[40];
+    LineMapCursor cursor = line_map_cursor();
+    for (int id : section_order()) {
+        // offsets are relative to the section, named when there are several
+        Section& sec = sections[id];
+        if (sections.size() > 1) {
+            buf += sec.name + ":\n";
+        }
 
-    if (shift_types.find(ident) != shift_types.end()) {
-        int shift_amout = 0;
-        if (p->program[p->idx] == '#') {
-            parser_advance(p, 1);
-            shift_amout = read_number(p);
+        for (size_t i = sec.code_idx; i < sec.code_idx + sec.size; i++) {
+            bool first = line_map_seek(cursor, i);
+            int line = cursor.line;
+
+            if (line > 0) {
+                snprintf(head, sizeof(head), "%6d %08zx %08x ", line, (i - sec.code_idx) * 4, code[i]);
+            } else {
+                snprintf(head, sizeof(head), "%6s %08zx %08x ", "", (i - sec.code_idx) * 4, code[i]);
+            }
+            buf += head;
+
+            // the source is printed with the first word of each line
+            if (first && line > 0 && (size_t)line <= line_starts.size()) {
+                size_t start = line_starts[line - 1];
+                size_t end = source.find('\n', start);
+                buf.append(source, start, (end == std::string::npos ? source.size() : end) - start);
+            }
+            buf += '\n';
+
+            if (buf.size() > (1 << 16)) {
+                out << buf;
+                buf.clear();
+            }
         }
-        return new_shift(shift_types[ident], shift_amout);
     }
-
-    syntax_error(p, "expected shift operand");
+    out << buf;
 }
 
-/*
-    MEM_OP_BASE            -> [ register ]
+// --------------------------------------------------------------------
+// Pipeline (--pipeline)
+// --------------------------------------------------------------------
 
-    MEM_OP_IMM_OFFSET      -> [ register, immediate ]
+// Reading, parsing, encoding and writing run as stages on their own threads, so that they
+// overlap on several cores instead of following each other:
+//
+//   read    the input in blocks, into the buffer the parser works on
+//   parse   every line once it has been read completely, handing on batches of instructions
+//   encode  the instr_table word of every instruction in a batch
+//   write   places the words in code as they come, on the main thread, then resolves the
+//           program and writes the debug info, the listing and the ELF
+//
+// Batches pass through bounded single-producer/single-consumer rings, so a slow stage holds
+// back the ones before it instead of letting them queue the whole program. Instructions
+// outside .text come after it in code, they are kept until parsing is done and placed then.
+// How busy each stage was goes to stderr: the CPU time of its thread outside of waiting for
+// its neighbours, as a share of the run, which also holds when stages share a core.
+
+bool pipeline = false;
+
+#define PIPELINE_BLOCK (1 << 20) // bytes per read
+#define PIPELINE_BATCH 4096      // instructions per batch
+#define RING_SIZE 16             // batches between two stages, a power of two
+
+struct Batch {
+    std::vector<Instr> instrs;
+    std::vector<uint32_t> words; // encode_word, set by the encode stage
+};
 
-    MEM_OP_IMM_OFFSET_PRE  -> [ register, immediate ]!
+// one thread pushes, another pops, nullptr ends the stream
+struct Ring {
+    Batch* slots[RING_SIZE];
+    std::atomic<size_t> head { 0 }; // next to pop, written by the consumer
+    std::atomic<size_t> tail { 0 }; // next to push, written by the producer
+};
 
-    MEM_OP_REGI_OFFSET     -> [ register, register ]
-    MEM_OP_REGI_OFFSET     -> [ register, register, LSL #0 ]
-*/
+Ring parsed_batches;
+Ring encoded_batches;
 
-Operand* parse_operand(Parser* p) {
-    skip_white_space(p);
+// CPU time of the stage's thread
+struct Stage {
+    const char* name;
+    double start;
+    double end;
+    double waited;
+};
 
-    if (p->program[p->idx] == '#') {
-        parser_advance(p, 1);
+enum { READ_STAGE, PARSE_STAGE, ENCODE_STAGE, WRITE_STAGE, STAGE_COUNT };
 
-        int imm_val = read_number(p);
+Stage stages[STAGE_COUNT] = { { "read" }, { "parse" }, { "encode" }, { "write" } };
 
-        return new_imm(imm_val);
-    }
+double pipeline_start; // wall clock
 
-    if (p->program[p->idx] == '[') {
-        Operand* mem_op = new Operand;
-        parser_advance(p, 1); // skip `[`
-        mem_op->base_register = parse_register(p);
-        switch (p->program[p->idx]) {
-            case ']':
-                mem_op->kind = MEM_OP_BASE;
-                break;
-            case ',':
-                parser_advance(p, 1); // skip `,`
-                skip_white_space(p);
-                if (p->program[p->idx] == '#') { // imm offset
-                    mem_op->kind = MEM_OP_IMM_OFFSET;
-                    parser_advance(p, 1); // skip `#`
-                    int imm_offset_val = read_number(p);
-                    mem_op->offset = new_imm(imm_offset_val);
-                } else { // register offset
-                    mem_op->kind = MEM_OP_REGI_OFFSET;
-                    mem_op->offset = parse_register(p);
-                    if (p->program[p->idx] == ',') {
-                        parser_advance(p, 1); // skip `,`
-                        mem_op->extend_offset = parse_extend(p);
-                    } else {
-                        mem_op->extend_offset = new_extend((ExtendType)0, 0);
-                    }
-                }
-                break;
-        }
-        if (p->program[p->idx] != ']') {
-            syntax_error(p, "expected `]`");
+double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double thread_time() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void ring_push(Ring& ring, Batch* batch, Stage& stage) {
+    size_t tail = ring.tail.load(std::memory_order_relaxed);
+    if (tail - ring.head.load(std::memory_order_acquire) == RING_SIZE) {
+        double start = thread_time();
+        while (tail - ring.head.load(std::memory_order_acquire) == RING_SIZE) {
+            std::this_thread::yield();
         }
-        parser_advance(p, 1); // skip `]`
-        skip_white_space(p);
-        if (p->program[p->idx] == '!') {
-            switch (mem_op->kind) {
-                case MEM_OP_BASE:
-                    mem_op->kind = MEM_OP_BASE_PRE;
-                    break;
-                case MEM_OP_IMM_OFFSET:
-                    mem_op->kind = MEM_OP_IMM_OFFSET_PRE;
-                    break;
-                default:
-                    syntax_error(p, "expected `!`");
-            }
-            parser_advance(p, 1); // skip `!`
+        stage.waited += thread_time() - start;
+    }
+    ring.slots[tail % RING_SIZE] = batch;
+    ring.tail.store(tail + 1, std::memory_order_release);
+}
+
+Batch* ring_pop(Ring& ring, Stage& stage) {
+    size_t head = ring.head.load(std::memory_order_relaxed);
+    if (ring.tail.load(std::memory_order_acquire) == head) {
+        double start = thread_time();
+        while (ring.tail.load(std::memory_order_acquire) == head) {
+            std::this_thread::yield();
         }
-        return mem_op;
+        stage.waited += thread_time() - start;
     }
+    Batch* batch = ring.slots[head % RING_SIZE];
+    ring.head.store(head + 1, std::memory_order_release);
+    return batch;
+}
 
-    std::string ident = read_ident(p);
+// the input file, read into the parser's program while the parser works on it
+struct SourceStream {
+    int fd;
+    std::string path;
+    char* data;
+    size_t size;
+    std::atomic<size_t> read { 0 }; // bytes in data so far
+    size_t lines_end = 0;           // parse stage: data before it is complete lines, and readable one byte past
+};
 
-    if (registers.find(ident) != registers.end()) {
-        return registers[ident];
+void read_stage(SourceStream* s) {
+    stages[READ_STAGE].start = thread_time();
+    size_t read_so_far = 0;
+    while (read_so_far < s->size) {
+        ssize_t n = read(s->fd, s->data + read_so_far, std::min<size_t>(PIPELINE_BLOCK, s->size - read_so_far));
+        if (n <= 0) {
+            std::cerr << "error: failed to read file: " << s->path << std::endl;
+            _exit(1);
+        }
+        read_so_far += n;
+        s->read.store(read_so_far, std::memory_order_release);
     }
+    close(s->fd);
+    stages[READ_STAGE].end = thread_time();
+}
 
-    if (shift_types.find(ident) != shift_types.end()) {
-        int shift_amout = 0;
-        if (p->program[p->idx] == '#') {
-            parser_advance(p, 1);
-            shift_amout = read_number(p);
-        }
-        return new_shift(shift_types[ident], shift_amout);
+void push_parsed_batch() {
+    Batch* batch = new Batch;
+    batch->instrs.swap(instrs);
+    instrs.reserve(PIPELINE_BATCH + 16);
+    ring_push(parsed_batches, batch, stages[PARSE_STAGE]);
+}
+
+// Called by parse_program before every line of the input file, not of included files, so a
+// batch never ends inside an .include.
+void pipeline_next_line(Parser* p) {
+    if (instrs.size() >= PIPELINE_BATCH) {
+        push_parsed_batch();
     }
 
-    if (extend_types.find(ident) != extend_types.end()) {
-        int extend_amout = 0;
-        if (p->program[p->idx] == '#') {
-            parser_advance(p, 1);
-            extend_amout = read_number(p);
+    SourceStream* s = p->stream;
+    if ((size_t)p->idx < s->lines_end) {
+        return;
+    }
+    double start = thread_time();
+    while (true) {
+        size_t read = s->read.load(std::memory_order_acquire);
+        if (read == s->size) {
+            s->lines_end = read;
+            break;
         }
-        return new_extend(extend_types[ident], extend_amout);
+        // the byte after a newline is read as well, two character operators look at it
+        const char* newline = read > (size_t)p->idx + 1 ? (const char*)memrchr(s->data + p->idx, '\n', read - 1 - p->idx) : nullptr;
+        if (newline != nullptr) {
+            s->lines_end = newline + 1 - s->data;
+            break;
+        }
+        std::this_thread::yield();
     }
+    stages[PARSE_STAGE].waited += thread_time() - start;
+}
 
-    syntax_error(p, "unkown operand found");
+// for the directives that look past the current line
+void pipeline_read_all(Parser* p) {
+    SourceStream* s = p->stream;
+    double start = thread_time();
+    while (s->read.load(std::memory_order_acquire) < s->size) {
+        std::this_thread::yield();
+    }
+    s->lines_end = s->size;
+    stages[PARSE_STAGE].waited += thread_time() - start;
 }
 
-void parse_program(Parser* p) {
-    while (!at_eof(p)) {
-        skip_white_space(p);
+void parse_stage(Parser* p) {
+    stages[PARSE_STAGE].start = thread_time();
+    parse_program(p);
+    if (!instrs.empty()) {
+        push_parsed_batch();
+    }
+    ring_push(parsed_batches, nullptr, stages[PARSE_STAGE]);
+    stages[PARSE_STAGE].end = thread_time();
+}
 
-        if (p->program[p->idx] == '\n') {
-            parser_advance(p, 1);
-            p->line++;
-            continue;
+void encode_stage() {
+    stages[ENCODE_STAGE].start = thread_time();
+    while (Batch* batch = ring_pop(parsed_batches, stages[ENCODE_STAGE])) {
+        batch->words.resize(batch->instrs.size());
+        for (size_t i = 0; i < batch->instrs.size(); i++) {
+            batch->words[i] = encode_word(batch->instrs[i]);
         }
+        ring_push(encoded_batches, batch, stages[ENCODE_STAGE]);
+    }
+    ring_push(encoded_batches, nullptr, stages[ENCODE_STAGE]);
+    stages[ENCODE_STAGE].end = thread_time();
+}
 
-        std::string instr_name = read_ident(p);
-
-        Operand** operands = new Operand*[5];
+// Replaces load_source, parse_program, group_sections and encode_program; the write stage
+// goes on in main and ends with report_pipeline.
+void run_pipeline(std::string file_path) {
+    int fd = open(file_path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        std::cerr << "error: failed to open file: " << file_path << std::endl;
+        exit(1);
+    }
 
-        int operand_length = 0;
-        while (true) {
-            if (operand_length > 4) {
-                break;
+    char real_path[PATH_MAX];
+    source_files.push_back(SourceFile { file_path, "", false, "" });
+    source_ids[realpath(file_path.c_str(), real_path) != nullptr ? real_path : file_path] = 0;
+
+    Parser* p = new_parser(file_path, "");
+    p->program.resize(st.st_size);
+    SourceStream stream;
+    stream.fd = fd;
+    stream.path = file_path;
+    stream.data = &p->program[0];
+    stream.size = p->program.size();
+    p->stream = &stream;
+
+    // the parser adds sections while .text is placed
+    sections.reserve(SECTION_MAX);
+
+    pipeline_start = now();
+    stages[WRITE_STAGE].start = thread_time();
+    std::thread reader(read_stage, &stream);
+    std::thread parser(parse_stage, p);
+    std::thread encoder(encode_stage);
+
+    begin_encoding();
+    defer_symbols = true;
+
+    std::vector<Instr> placed;
+    std::vector<Instr> rest; // outside .text, with their .section
+    int section = 0;
+    while (Batch* batch = ring_pop(encoded_batches, stages[WRITE_STAGE])) {
+        for (size_t i = 0; i < batch->instrs.size(); i++) {
+            Instr& in = batch->instrs[i];
+            if (in.name == ".section") {
+                section = in.operands[0]->imm;
+                if (section != 0) {
+                    rest.push_back(std::move(in));
+                }
+                continue;
             }
-
-            operands[operand_length++] = parse_operand(p);
-            skip_white_space(p);
-            if (p->program[p->idx] == ',') {
-                parser_advance(p, 1);
-            } else {
-                break;
+            if (section != 0) {
+                rest.push_back(std::move(in));
+                continue;
             }
+            sections[0].align = std::max(sections[0].align, section_align(in));
+            placed.push_back(std::move(in));
+            place_instr(placed.back(), placed.size() - 1, batch->words[i]);
         }
+        delete batch;
+    }
 
-        char c = p->program[p->idx];
+    reader.join();
+    parser.join();
+    encoder.join();
+    p->stream = nullptr;
+    source_files[0].content = std::move(p->program);
 
-        if (c == '\n' || c == '\0') {
-            parser_advance(p, 1);
-            p->line++;
-        } else {
-            syntax_error(p, "expected a new line or EOF");
-        }
+    defer_symbols = false;
+    for (SymbolEvent& event : symbol_events) {
+        place_symbol(placed[event.instr_idx], event.code_idx);
+    }
+
+    instrs = std::move(rest);
+    group_sections();
+    for (Instr& in : instrs) {
+        placed.push_back(std::move(in));
+        place_instr(placed.back(), placed.size() - 1, encode_word(placed.back()));
+    }
+    instrs = std::move(placed);
+    finish_encoding();
+}
+
+double busy_time(Stage& stage) {
+    return stage.end - stage.start - stage.waited;
+}
 
-        code.push_back(instr_table[instr_name](operands, operand_length));
+// pipeline: 1.234 s, busy read 2% parse 71% encode 9% write 30%, bottleneck parse
+void report_pipeline() {
+    stages[WRITE_STAGE].end = thread_time();
+    double total = now() - pipeline_start;
+
+    char buf[64];
+    snprintf(buf, sizeof(buf), "pipeline: %.3f s, busy", total);
+    std::string report = buf;
+    int bottleneck = 0;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        snprintf(buf, sizeof(buf), " %s %.0f%%", stages[i].name, busy_time(stages[i]) / total * 100);
+        report += buf;
+        if (busy_time(stages[i]) > busy_time(stages[bottleneck])) {
+            bottleneck = i;
+        }
     }
+    std::cerr << report << ", bottleneck " << stages[bottleneck].name << std::endl;
 }
 
-std::string read_file(char* file_path) {
+std::string read_file(std::string file_path) {
     std::ifstream input_file(file_path);
 
     if (!input_file.is_open()) {
@@ -2206,21 +8869,122 @@ std::string read_file(char* file_path) {
 }
 
 int main(int argc, char** argv) {
-    if (argc < 1) {
+    char* file_path = nullptr;
+    std::string schedule_core;
+    std::string listing_path;
+    std::string analyze_core;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-O") == 0) {
+            optimize = true;
+        } else if (strncmp(argv[i], "--schedule=", 11) == 0) {
+            schedule_core = argv[i] + 11;
+            if (core_models.find(schedule_core) == core_models.end()) {
+                std::cerr << "error: unknown core: " << schedule_core << std::endl;
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--analyze=", 10) == 0) {
+            analyze_core = argv[i] + 10;
+            if (micro_archs.find(analyze_core) == micro_archs.end()) {
+                std::cerr << "error: unknown core: " << analyze_core << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--emit-ir") == 0) {
+            emit_ir = true;
+        } else if (strcmp(argv[i], "--function-sections") == 0) {
+            function_sections = true;
+        } else if (strcmp(argv[i], "--pipeline") == 0) {
+            pipeline = true;
+        } else if (strcmp(argv[i], "--exec") == 0) {
+            emit_exec = true;
+        } else if (strcmp(argv[i], "-g") == 0) {
+            emit_debug = true;
+            track_lines = true;
+        } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
+            include_dirs.push_back(argv[++i]);
+        } else if (strncmp(argv[i], "-I", 2) == 0) {
+            include_dirs.push_back(argv[i] + 2);
+        } else if (strcmp(argv[i], "--listing") == 0 && i + 1 < argc) {
+            listing_path = argv[++i];
+            track_lines = true;
+        } else {
+            file_path = argv[i];
+        }
+    }
+
+    if (file_path == nullptr) {
         std::cerr << "error: no input file" << std::endl;
         return 1;
     }
 
-    char* file_path = argv[1];
-
-    std::string file_content = read_file(file_path);
+    // a file written by --emit-ir replaces reading and parsing the source
+    bool from_ir = is_ir_file(file_path);
+    if (pipeline && (from_ir || emit_ir || optimize || !schedule_core.empty() || function_sections)) {
+        std::cerr << "error: --pipeline takes a source file and no --emit-ir, -O, --schedule or --function-sections" << std::endl;
+        return 1;
+    }
 
     code.reserve(5000000);
 
-    Parser* p = new_parser(file_path, file_content);
-    parse_program(p);
+    if (pipeline) {
+        run_pipeline(file_path);
+    } else if (from_ir) {
+        load_ir(file_path);
+    } else {
+        char real_path[PATH_MAX];
+        load_source(file_path, realpath(file_path, real_path) != nullptr ? real_path : file_path);
+
+        Parser* p = new_parser(file_path, source_files[0].content);
+        parse_program(p);
+    }
+
+    if (emit_ir) {
+        write_ir();
+        return 0;
+    }
+
+    // the pipeline has encoded the program while parsing it
+    if (!pipeline) {
+        if (function_sections) {
+            split_function_sections();
+        }
+        group_sections();
+
+        if (optimize) {
+            peephole();
+        }
+
+        if (!schedule_core.empty()) {
+            schedule(schedule_core, core_models[schedule_core]);
+        }
+
+        encode_program();
+    }
+
+    // the report replaces the object file
+    if (!analyze_core.empty()) {
+        analyze(analyze_core, micro_archs[analyze_core]);
+        if (pipeline) {
+            report_pipeline();
+        }
+        return 0;
+    }
+
+    // paths and lines are those of the source, also when assembling an IR
+    if (emit_debug) {
+        generate_debug_info(source_files[0].path);
+    }
+
+    if (!listing_path.empty()) {
+        if (from_ir) {
+            source_files[0].content = read_file(source_files[0].path);
+        }
+        write_listing(listing_path, source_files[0].content);
+    }
 
     generate_elf();
+    if (pipeline) {
+        report_pipeline();
+    }
     return 0;
 }
 
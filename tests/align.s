@@ -0,0 +1,16 @@
+    ret
+    .p2align 5
+    ret
+    .balign 8
+
+    .section .text.pool, "ax"
+    ldr x0, =1
+    ret
+
+    .section .text.plain, "ax"
+    ret
+
+    .section .rodata
+    .balign 64
+    ret
+    .p2align 3
@@ -0,0 +1,29 @@
+.globl sum
+sum:
+loop:
+    ldr x2, [x0], #8
+    add x3, x3, x2
+    mul x4, x4, x2
+    subs x1, x1, #1
+    b.ne loop
+    ret
+
+.globl dot
+dot:
+    ld1 {v0.4s}, [x0], #16
+    ld1 {v1.4s}, [x1], #16
+    fmla v2.4s, v0.4s, v1.4s
+    subs x2, x2, #4
+    b.ne dot
+    ret
+
+.globl wide
+wide:
+    add x3, x3, #1
+    add x4, x4, #1
+    add x5, x5, #1
+    add x6, x6, #1
+    add x7, x7, #1
+    add x8, x8, #1
+    subs x2, x2, #1
+    b.ne wide
@@ -0,0 +1,15 @@
+.globl _start
+_start:
+    mov x0, #0x12345678
+    bl f
+    ret
+
+f:
+    ldr x1, =42
+
+    add x0, x0, x1
+    ret
+
+    .section .text.cold, "ax"
+cold:
+    b f
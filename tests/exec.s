@@ -0,0 +1,17 @@
+.globl _start
+_start:
+    mov x0, #42
+    bl exit
+    ldr x1, =0x1122334455667788
+
+    .section .rodata
+    nop
+
+    .section .data
+    nop
+    nop
+
+    .text
+exit:
+    mov x8, #93
+    svc #0
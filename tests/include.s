@@ -0,0 +1,9 @@
+.include "once.s"
+.include "guard.s"
+_start:
+    mov x0, #ONCE
+.include "once.s"
+.include "guard.s"
+.include "which.s"
+.include "nested.s"
+    ret
@@ -0,0 +1,4 @@
+.ifndef GUARD
+.equ GUARD, 1
+    add x1, x1, #GUARD
+.endif
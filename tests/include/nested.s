@@ -0,0 +1,3 @@
+.include "once.s"
+.include "guard.s"
+    mov x2, #ONCE + GUARD
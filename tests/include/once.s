@@ -0,0 +1,3 @@
+.pragma once
+.equ ONCE, 3
+    nop
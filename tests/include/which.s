@@ -0,0 +1 @@
+    mov x9, #2
@@ -0,0 +1,12 @@
+.globl add_one
+.globl done
+.type add_one, %function
+add_one:
+    add x0, x0, #1
+    ret
+loop:
+    b loop
+.type done, %function
+done:
+    mov x8, #93
+    svc #0
@@ -0,0 +1,12 @@
+.globl _start
+.globl add_one
+.globl done
+_start:
+    mov x0, #1
+loop:
+    bl add_one
+    cmp x0, #4
+    b.ne loop
+    cbz x0, done
+    tbz x0, #3, done
+    b done
@@ -0,0 +1,13 @@
+.globl _start
+_start:
+    ldr x0, =0x1122334455667788
+    mov x1, #0x12345678
+    cbz x0, done
+    .p2align 5
+done:
+    ret
+
+    .section .text.cold, "ax"
+cold:
+    ldr w2, =7
+    b done
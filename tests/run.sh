@@ -0,0 +1,81 @@
+#!/bin/sh
+# usage: run.sh <ias> encodings <file>     every `<word> <instruction>` line must encode to word
+#        run.sh <ias> errors <file>        every line must be rejected with a file:line error, \n separates
+#                                          the lines of a test and a leading `@<n> ` expects the error at line n
+#        run.sh <ias> output <file> <cmd>  cmd runs in an empty directory with $IAS and $TESTS set, its
+#                                          output, with that directory shown as $TMP, must equal file
+#        run.sh <ias> programs <file> <option>...
+#                                          every `<word>,<word>... <program>` line assembled with the
+#                                          options must emit those words, \n separates the lines of a
+#                                          program and `#` starts a comment line
+ias=$1
+mode=$2
+file=$3
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+fail=0
+
+case $mode in
+encodings)
+    cut -d' ' -f2- "$file" > "$tmp/t.s"
+    cut -d' ' -f1 "$file" > "$tmp/expected"
+    "$ias" --listing "$tmp/t.lst" "$tmp/t.s" > "$tmp/t.o" || exit 1
+    awk '{ print $3 }' "$tmp/t.lst" > "$tmp/actual"
+    paste -d' ' "$tmp/expected" "$tmp/actual" "$tmp/t.s" |
+        awk '$1 != $2 { print "expected " $1 ", got " $2 ":", substr($0, 19); bad = 1 } END { exit bad }' || fail=1
+    ;;
+errors)
+    while IFS= read -r line; do
+        at="[0-9]*"
+        case $line in
+        @*)
+            at=${line%% *}
+            at=${at#@}
+            line=${line#* }
+            ;;
+        esac
+        printf '%b\n' "$line" > "$tmp/e.s"
+        if "$ias" "$tmp/e.s" > /dev/null 2> "$tmp/err"; then
+            echo "accepted: $line"
+            fail=1
+        elif ! sed "s/\x1b\[[0-9;]*m//g" "$tmp/err" | grep -q "e.s:$at: error: "; then
+            echo "no diagnostic for: $line"
+            cat "$tmp/err"
+            fail=1
+        fi
+    done < "$file"
+    ;;
+output)
+    (cd "$tmp" && IAS=$ias TESTS=$(dirname "$file") sh -c "$4") > "$tmp/actual" 2>&1 || fail=1
+    sed "s|$tmp|\$TMP|g" "$tmp/actual" | diff -u "$file" - || fail=1
+    ;;
+programs)
+    shift 3
+    while IFS= read -r line; do
+        case $line in
+        '' | '#'*)
+            continue
+            ;;
+        esac
+        expected=${line%% *}
+        printf '%b\n' "${line#* }" > "$tmp/p.s"
+        if ! "$ias" "$@" --listing "$tmp/p.lst" "$tmp/p.s" > "$tmp/p.o" 2> "$tmp/err"; then
+            printf 'rejected: %s\n' "$line"
+            cat "$tmp/err"
+            fail=1
+            continue
+        fi
+        # the word is the third column of every listing row, whose line number may be blank
+        actual=$(grep -E '^[ 0-9]{6} [0-9a-f]{8} [0-9a-f]{8}' "$tmp/p.lst" | cut -c17-24 | paste -sd, -)
+        if [ "$actual" != "$expected" ]; then
+            printf 'expected %s, got %s: %s\n' "$expected" "$actual" "${line#* }"
+            fail=1
+        fi
+    done < "$file"
+    ;;
+*)
+    echo "unknown mode $mode"
+    exit 1
+    ;;
+esac
+exit $fail
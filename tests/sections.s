@@ -0,0 +1,30 @@
+.globl _start
+.type _start, %function
+_start:
+    bl helper
+    b.ne cold
+    ret
+.type helper, %function
+helper:
+    ldr x0, =0x1122334455667788
+    ret
+.data
+    nop
+.section .text.cold, "ax"
+cold:
+    cbz x0, _start
+    ret
+.rodata
+    nop
+    nop
+.section .mine, "aw", @progbits
+    nop
+.text
+.type tail, %function
+tail:
+    tbz w0, #1, cold
+    b helper
+.section .data
+    nop
+.section .ro, "a"
+    nop
@@ -0,0 +1,27 @@
+.globl f
+.type f, %function
+f:
+    ldr x0, =0x123456789
+    ret
+.type g, %function
+g:
+    nop
+    nop
+.globl h
+h:
+    nop
+.Lskip:
+    nop
+.type sized, %function
+sized:
+    nop
+    nop
+.size sized, 4
+.type last, %function
+last:
+    ldr x1, =0x55
+    ret
+.data
+.type counter, %object
+counter:
+    nop